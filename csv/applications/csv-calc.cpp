@@ -22,18 +22,34 @@
 #include <io.h>
 #endif
 
+#include <string.h>
+#include <cmath>
+#include <deque>
 #include <iostream>
+#include <limits>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/unordered_map.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <comma/application/signal_flag.h>
 #include <comma/base/exception.h>
+#include <comma/csv/columns.h>
 #include <comma/csv/format.h>
 #include <comma/csv/options.h>
+#include <comma/csv/impl/ascii_parallel_reader.h>
+#include <comma/csv/impl/ascii_tokenizer.h>
+#include <comma/csv/impl/epoch.h>
+#include <comma/csv/impl/iso_time.h>
+#include <comma/csv/impl/parse.h>
+#include <comma/io/mapped_file.h>
+#include <comma/math/digest.h>
 #include <comma/string/string.h>
 
 static void usage()
@@ -55,6 +71,12 @@ static void usage()
     std::cerr << "    var: variance" << std::endl;
     std::cerr << "    stddev: standard deviation" << std::endl;
     std::cerr << "    size: number of values" << std::endl;
+    std::cerr << "    median: median value, same as percentile=0.5" << std::endl;
+    std::cerr << "    percentile=<p>: percentile value, <p> between 0 and 1, e.g. percentile=0.9" << std::endl;
+    std::cerr << "    iqr: interquartile range, i.e. 75th percentile - 25th percentile" << std::endl;
+    std::cerr << "        median, percentile and iqr are interpolated linearly between values and are exact for up to" << std::endl;
+    std::cerr << "        --compression values per id; for more values, they are approximated with a bounded-size" << std::endl;
+    std::cerr << "        sketch (t-digest) per id, typically within 0.3% of rank for compression 100" << std::endl;
     std::cerr << std::endl;
     std::cerr << "<options>" << std::endl;
     std::cerr << "    --delimiter,-d <delimiter> : default ','" << std::endl;
@@ -63,8 +85,22 @@ static void usage()
     std::cerr << "                 if 'id' field present, calculate by id" << std::endl;
     std::cerr << "                 if 'block' and 'id' fields present, calculate by id in each block" << std::endl;
     std::cerr << "                 block and id fields will be appended to the output" << std::endl;
+    std::cerr << "                 ids are output in the order of their first appearance in the input (or block)" << std::endl;
     std::cerr << "    --format: in ascii mode: format hint string containing the types of the csv data, default: double or time" << std::endl;
     std::cerr << "    --binary,-b: in binary mode: format string of the csv data types" << std::endl;
+    std::cerr << "    --compression=<n>: accuracy of median, percentile and iqr: memory per id and operation is" << std::endl;
+    std::cerr << "                       about 2 * <n> * 16 bytes, no matter how many values; default: 100" << std::endl;
+    std::cerr << "    --window-size=<n>: for each record, calculate on the last <n> records of its id, including the record itself," << std::endl;
+    std::cerr << "                       and append the results to the record; if 'block' field present, windows start anew in each block" << std::endl;
+    std::cerr << "    --window-time=<seconds>: same as --window-size, but on the records of its id no older than <seconds>" << std::endl;
+    std::cerr << "                             than the record; the timestamp is field 't', e.g. --fields=t,x,y,id" << std::endl;
+    std::cerr << "                             if both --window-size and --window-time given, windows are limited by both" << std::endl;
+    std::cerr << "        median, percentile and iqr are not supported on windows; --threads then only sets parsing threads" << std::endl;
+    std::cerr << "    --flush: with --window-size or --window-time, flush output after each record; default: flush at the end of each block" << std::endl;
+    std::cerr << "    --threads=<n>: aggregate in n threads; in ascii mode, also parse lines in n threads" << std::endl;
+    std::cerr << "                   if 'id' field present, ids are partitioned between the threads, otherwise" << std::endl;
+    std::cerr << "                   batches of records are aggregated in turn and the results merged at the end of block" << std::endl;
+    std::cerr << "                   default: aggregate and parse in the main thread" << std::endl;
     std::cerr << comma::csv::format::usage() << std::endl;
     std::cerr << std::endl;
     std::cerr << "examples" << std::endl;
@@ -76,9 +112,11 @@ static void usage()
 class Values
 {
     public:
-        Values( const comma::csv::options& csv, const comma::csv::format& input_format )
+        /// @param has_time if true, field t is the timestamp, e.g. for --window-time, rather than a value to calculate on
+        Values( const comma::csv::options& csv, const comma::csv::format& input_format, bool has_time = false )
             : csv_( csv )
             , input_format_( input_format )
+            , has_time_( has_time )
             , block_( 0 )
             , id_( 0 )
         {
@@ -86,8 +124,9 @@ class Values
             init_format_();
         }
         
-        Values( const comma::csv::options& csv, const std::string& hint )
+        Values( const comma::csv::options& csv, const std::string& hint, bool has_time = false )
             : csv_( csv )
+            , has_time_( has_time )
             , block_( 0 )
             , id_( 0 )
         {
@@ -96,6 +135,7 @@ class Values
             for( unsigned int i = 0; i < v.size(); ++i )
             {
                 if( ( block_index_ && *block_index_ == i ) || ( id_index_ && *id_index_ == i ) ) { input_format_ += "ui"; continue; }
+                if( time_index_ && *time_index_ == i ) { input_format_ += "t"; continue; }
                 try { boost::posix_time::from_iso_string( v[i] ); input_format_ += "t"; }
                 catch( ... ) { input_format_ += "d"; }
             }
@@ -111,22 +151,41 @@ class Values
             }
             if( block_index_ ) { block_ = block_from_bin_( buf + block_element_.offset ); }
             if( id_index_ ) { id_ = id_from_bin_( buf + id_element_.offset ); }
+            if( time_index_ ) { time_ = time_element_.type == comma::csv::format::long_time ? comma::csv::format::traits< boost::posix_time::ptime, comma::csv::format::long_time >::from_bin( buf + time_element_.offset ) : comma::csv::format::traits< boost::posix_time::ptime >::from_bin( buf + time_element_.offset ); }
         }
         
-        void set( const std::string& line ) // quick and dirty, probably very slow
+        /// set from fields of a line, parsing the selected fields straight into the buffer
+        void set( const std::vector< comma::csv::impl::ascii_field >& v ) { parse_( &buffer_[0], fields_, block_, id_, time_, v ); }
+        
+        /// values parsed from a line, e.g. in a worker thread
+        struct parsed
+        {
+            std::vector< char > buffer;
+            comma::uint32 block;
+            comma::uint32 id;
+            boost::posix_time::ptime time;
+            std::vector< comma::csv::impl::ascii_field > fields;
+            parsed() : block( 0 ), id( 0 ) {}
+        };
+        
+        void parse( parsed& p, const std::vector< comma::csv::impl::ascii_field >& v ) const // thread-safe
         {
-            std::vector< std::string > v = comma::split( line, csv_.delimiter );
-            std::vector< std::string > w( indices_.size() );
-            for( unsigned int i = 0; i < indices_.size(); ++i ) { w[i] = v[indices_[i]]; }
-            const std::string& s = format_.csv_to_bin( w );
-            ::memcpy( &buffer_[0], &s[0], buffer_.size() );
-            if( block_index_ ) { block_ = boost::lexical_cast< unsigned int >( v[ *block_index_ ] ); }
-            if( id_index_ ) { id_ = boost::lexical_cast< unsigned int >( v[ *id_index_ ] ); }
+            p.buffer.resize( format_.size() );
+            parse_( &p.buffer[0], p.fields, p.block, p.id, p.time, v );
+        }
+        
+        void set( const parsed& p )
+        {
+            ::memcpy( &buffer_[0], &p.buffer[0], buffer_.size() );
+            block_ = p.block;
+            id_ = p.id;
+            time_ = p.time;
         }
         
         const comma::csv::format& format() const { return format_; }
         unsigned int block() const { return block_; }
         unsigned int id() const { return id_; }
+        const boost::posix_time::ptime& time() const { return time_; }
         const char* buffer() const { return &buffer_[0]; }
         
     private:
@@ -137,16 +196,33 @@ class Values
         std::vector< comma::csv::format::element > input_elements_;
         std::vector< comma::csv::format::element > elements_;
         std::vector< char > buffer_;
+        std::vector< comma::csv::impl::ascii_field > fields_; // selected fields of the current line
         boost::optional< unsigned int > block_index_;
         boost::optional< unsigned int > id_index_;
+        bool has_time_;
+        boost::optional< unsigned int > time_index_;
         comma::csv::format::element block_element_;
         comma::csv::format::element id_element_;
+        comma::csv::format::element time_element_;
         unsigned int block_;
         unsigned int id_;
+        boost::posix_time::ptime time_;
+        unsigned int minimum_size_;
         boost::function< comma::uint32( const char* ) > block_from_bin_;
         boost::function< comma::uint32( const char* ) > id_from_bin_;
         template < typename T > static comma::uint32 from_bin_( const char* buf ) { return comma::csv::format::traits< T >::from_bin( buf ); }
         
+        void parse_( char* buffer, std::vector< comma::csv::impl::ascii_field >& fields, comma::uint32& block, comma::uint32& id, boost::posix_time::ptime& time, const std::vector< comma::csv::impl::ascii_field >& v ) const
+        {
+            if( v.size() < minimum_size_ ) { COMMA_THROW( comma::exception, "expected at least " << minimum_size_ << " fields, got " << v.size() ); }
+            fields.resize( indices_.size() );
+            for( unsigned int i = 0; i < indices_.size(); ++i ) { fields[i] = v[indices_[i]]; }
+            format_.csv_to_bin( buffer, fields );
+            if( block_index_ ) { block = comma::csv::impl::parse< unsigned int >( v[ *block_index_ ].data, v[ *block_index_ ].size ); }
+            if( id_index_ ) { id = comma::csv::impl::parse< unsigned int >( v[ *id_index_ ].data, v[ *id_index_ ].size ); }
+            if( time_index_ ) { time = comma::csv::impl::from_iso_string( v[ *time_index_ ].data, v[ *time_index_ ].size ); }
+        }
+        
         void init_indices_()
         {
             std::vector< std::string > v = comma::split( csv_.fields, ',' );
@@ -154,8 +230,10 @@ class Values
             {
                 if( v[i] == "block" ) { block_index_ = i; }
                 else if( v[i] == "id" ) { id_index_ = i; }
+                else if( v[i] == "t" && has_time_ ) { time_index_ = i; }
                 else if( v[i] != "" ) { indices_.push_back( i ); }
             }
+            if( has_time_ && !time_index_ ) { COMMA_THROW( comma::exception, "expected field t for timestamp, got fields \"" << csv_.fields << "\"" ); }
         }
         void init_format_()
         {
@@ -165,6 +243,7 @@ class Values
                 {
                     if( block_index_ && *block_index_ == i ) { continue; }
                     if( id_index_ && *id_index_ == i ) { continue; }
+                    if( time_index_ && *time_index_ == i ) { continue; }
                     indices_.push_back( i );
                 }
             }
@@ -178,6 +257,16 @@ class Values
                 input_elements_.push_back( input_format_.offset( indices_[i] ) );
             }
             buffer_.resize( format_.size() );
+            minimum_size_ = 0;
+            for( unsigned int i = 0; i < indices_.size(); ++i ) { if( indices_[i] >= minimum_size_ ) { minimum_size_ = indices_[i] + 1; } }
+            if( block_index_ && *block_index_ >= minimum_size_ ) { minimum_size_ = *block_index_ + 1; }
+            if( id_index_ && *id_index_ >= minimum_size_ ) { minimum_size_ = *id_index_ + 1; }
+            if( time_index_ && *time_index_ >= minimum_size_ ) { minimum_size_ = *time_index_ + 1; }
+            if( time_index_ )
+            {
+                time_element_ = input_format_.offset( *time_index_ );
+                if( time_element_.type != comma::csv::format::time && time_element_.type != comma::csv::format::long_time ) { COMMA_THROW( comma::exception, "expected time for field t, got format " << input_format_.string() ); }
+            }
             if( block_index_ )
             {
                 block_element_ = input_format_.offset( *block_index_ );
@@ -218,46 +307,97 @@ class Values
 class asciiInput
 {
     public:
-        asciiInput( const comma::csv::options& csv, const boost::optional< comma::csv::format >& format ) : csv_( csv )
+        asciiInput( const comma::csv::options& csv, const boost::optional< comma::csv::format >& format, unsigned int threads = 0, bool has_time = false ) : csv_( csv ), threads_( threads ), has_time_( has_time ), tokenizer_( csv.delimiter )
         {
-            if( format ) { values_.reset( new Values( csv, *format ) ); }
+            if( format ) { values_.reset( new Values( csv, *format, has_time ) ); }
         }
         
         const Values* read()
         {
-            std::string line;
-            std::getline( std::cin, line );
-            if( line == "" ) { return NULL; }
-            if( !values_ ) { values_.reset( new Values( csv_, line ) ); }
-            values_->set( line );
+            if( parallel_ )
+            {
+                const Values::parsed* p = parallel_->read( std::cin );
+                if( !p ) { return NULL; }
+                values_->set( *p );
+                return values_.get();
+            }
+            if( threads_ > 0 && values_ ) // format is known, start parsing threads
+            {
+                parallel_.reset( new comma::csv::impl::ascii_parallel_reader< Values::parsed >( csv_.delimiter, threads_, boost::bind( &Values::parse, values_.get(), _1, _2 ) ) );
+                return read();
+            }
+            if( threads_ > 0 ) // guess format from the first line without reading ahead, since the rest of input goes to the parsing threads
+            {
+                while( std::cin.good() && first_.empty() )
+                {
+                    std::getline( std::cin, first_ );
+                    if( !first_.empty() && first_[ first_.size() - 1 ] == '\r' ) { first_.erase( first_.size() - 1 ); }
+                }
+                if( first_.empty() ) { return NULL; }
+                values_.reset( new Values( csv_, first_, has_time_ ) );
+                comma::csv::impl::split_fields( first_.data(), first_.data() + first_.size(), csv_.delimiter, fields_ );
+                values_->set( fields_ );
+                line_ = comma::csv::impl::ascii_field( first_.data(), first_.size() );
+                return values_.get();
+            }
+            if( !tokenizer_.read( std::cin ) ) { return NULL; }
+            if( !values_ ) { values_.reset( new Values( csv_, std::string( tokenizer_.line().data, tokenizer_.line().size ), has_time_ ) ); }
+            values_->set( tokenizer_.fields() );
+            line_ = tokenizer_.line();
             return values_.get();
         }
         
+        /// return the last line read
+        comma::csv::impl::ascii_field line() const { return parallel_ ? parallel_->line() : line_; }
+        
     private:
         comma::csv::options csv_;
+        unsigned int threads_;
+        bool has_time_;
+        comma::csv::impl::ascii_tokenizer tokenizer_;
+        std::string first_;
+        std::vector< comma::csv::impl::ascii_field > fields_;
+        comma::csv::impl::ascii_field line_;
         boost::scoped_ptr< Values > values_;
+        boost::scoped_ptr< comma::csv::impl::ascii_parallel_reader< Values::parsed > > parallel_;
 };
 
 class binaryInput
 {
     public:
-        binaryInput( const comma::csv::options& csv )
+        binaryInput( const comma::csv::options& csv, bool has_time = false )
             : csv_( csv )
-            , values_( csv, csv.format() )
+            , values_( csv, csv.format(), has_time )
             , buffer_( csv.format().size() > 65536 ? csv.format().size() : 65536 / csv.format().size() * csv.format().size() )
             , cur_( &buffer_[0] )
             , end_( &buffer_[0] + buffer_.size() )
             , offset_( 0 )
+            , record_( NULL )
         {
+            #ifndef WIN32
+            if( !comma::io::mapped_file::regular( 0 ) ) { return; }
+            off_t offset = ::lseek( 0, 0, SEEK_CUR );
+            if( offset >= 0 ) { mapped_.reset( new comma::io::mapped_streambuf( 0, offset ) ); } // stdin redirected from file: read records straight from the mapping
+            #endif
         }
         
         const Values* read()
         {
+            if( mapped_ )
+            {
+                if( mapped_->available() < csv_.format().size() ) { mapped_->update(); } // the file may have grown
+                if( mapped_->available() < csv_.format().size() ) { return NULL; }
+                record_ = mapped_->data();
+                values_.set( record_ );
+                mapped_->consume( csv_.format().size() );
+                return &values_;
+            }
             while( true )
             {
                 if( offset_ >= csv_.format().size() )
                 {
-                    values_.set( cur_ );
+                    record_ = cur_;
+                    values_.set( record_ );
                     cur_ += csv_.format().size();
                     offset_ -= csv_.format().size();
                     if( cur_ == end_ ) { cur_ = &buffer_[0]; offset_ = 0; }
@@ -269,6 +409,9 @@ class binaryInput
             }
         }
         
+        /// return the last record read, valid till the next read
+        const char* record() const { return record_; }
+        
     private:
         comma::csv::options csv_;
         Values values_;
@@ -276,210 +419,221 @@ class binaryInput
         char* cur_;
         const char* end_;
         unsigned int offset_;
+        const char* record_;
+        boost::scoped_ptr< comma::io::mapped_streambuf > mapped_;
 };
 
+/// operations on a single column of a given type
+///
+/// each operation keeps its state for an id in a plain value
+/// and updates it in an inline, non-virtual push(); merge() combines
+/// the states of two disjoint sets of values, e.g. accumulated in
+/// different threads
 namespace Operations
 {
-    struct base
+    template < typename T > struct Extents
     {
-        virtual ~base() {}
-        virtual void push( const char* ) = 0;
-        virtual void calculate( char* ) = 0;
-        virtual base* clone() const = 0;
+        T min;
+        T max;
+        bool set;
+        Extents() : set( false ) {}
+        void push( const T& t )
+        {
+            if( !set ) { min = max = t; set = true; return; }
+            if( t < min ) { min = t; }
+            if( t > max ) { max = t; }
+        }
+        void merge( const Extents& rhs )
+        {
+            if( !rhs.set ) { return; }
+            if( !set ) { *this = rhs; return; }
+            if( rhs.min < min ) { min = rhs.min; }
+            if( rhs.max > max ) { max = rhs.max; }
+        }
     };
 
-    template < typename T, comma::csv::format::types_enum F > class Centre;
-    template < typename T, comma::csv::format::types_enum F > class Radius;
-    template < typename T, comma::csv::format::types_enum F > class Diameter;
-
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Min : public base
+    struct Min
     {
-        public:
-            void push( const char* buf )
-            {
-                const T& t = comma::csv::format::traits< T, F >::from_bin( buf );
-                if( !min_ || t < *min_ ) { min_ = t; }
-            }
-            void calculate( char* buf ) { if( min_ ) { comma::csv::format::traits< T, F >::to_bin( *min_, buf ); } }
-            base* clone() const { return new Min< T, F >( *this ); }
-        private:
-            friend class Centre< T, F >;
-            friend class Diameter< T, F >;
-            friend class Radius< T, F >;
-            boost::optional< T > min_;
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { if( !v.set || t < v.min ) { v.min = t; v.set = true; } }
+        static void merge( value& lhs, const value& rhs ) { if( rhs.set ) { push( lhs, rhs.min ); } }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< T, F >::to_bin( v.min, buf ); } }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Max : public base
+    struct Max
     {
-        public:
-            void push( const char* buf )
-            {
-                T t = comma::csv::format::traits< T, F >::from_bin( buf );
-                if( !max_ || t > *max_ ) { max_ = t; }
-            }
-            void calculate( char* buf ) { if( max_ ) { comma::csv::format::traits< T, F >::to_bin( *max_, buf ); } }
-            base* clone() const { return new Max< T, F >( *this ); }
-        private:
-            friend class Centre< T, F >;
-            friend class Diameter< T, F >;
-            friend class Radius< T, F >;
-            boost::optional< T > max_;
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { if( !v.set || t > v.max ) { v.max = t; v.set = true; } }
+        static void merge( value& lhs, const value& rhs ) { if( rhs.set ) { push( lhs, rhs.max ); } }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< T, F >::to_bin( v.max, buf ); } }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Sum : public base
+    struct Sum
     {
-        public:
-            void push( const char* buf )
-            {
-                T t = comma::csv::format::traits< T, F >::from_bin( buf );
-                sum_ = sum_ ? *sum_ + t : t; 
-            }
-            void calculate( char* buf ) { if( sum_ ) { comma::csv::format::traits< T, F >::to_bin( *sum_, buf ); } }
-            base* clone() const { return new Sum< T, F >( *this ); }
-        private:
-            boost::optional< T > sum_;
+        struct value { T sum; bool set; value() : set( false ) {} };
+        static void push( value& v, const T& t ) { v.sum = v.set ? v.sum + t : t; v.set = true; }
+        static void merge( value& lhs, const value& rhs ) { if( rhs.set ) { push( lhs, rhs.sum ); } }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< T, F >::to_bin( v.sum, buf ); } }
     };
-    
+
     template < comma::csv::format::types_enum F >
-    class Sum< boost::posix_time::ptime, F > : public base
+    struct Sum< boost::posix_time::ptime, F >
     {
-        void push( const char* ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
-        void calculate( char* ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
-        base* clone() const { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+        static void merge( value&, const value& ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Centre : public base
+    struct Centre
     {
-        public:
-            void push( const char* buf ) { min_.push( buf ); max_.push( buf ); }
-            void calculate( char* buf ) { if( min_.min_ ) { comma::csv::format::traits< T, F >::to_bin( *min_.min_ + ( *max_.max_ - *min_.min_ ) / 2, buf ); } }
-            base* clone() const { return new Centre< T, F >( *this ); }
-        private:
-            Min< T, F > min_;
-            Max< T, F > max_;
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void merge( value& lhs, const value& rhs ) { lhs.merge( rhs ); }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< T, F >::to_bin( v.min + ( v.max - v.min ) / 2, buf ); } }
     };
 
-    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Mean : public base
+    template < typename T > struct Diff
+    { 
+        typedef T Type;
+        static Type subtract( T lhs, T rhs ) { return lhs - rhs; }
+    };
+
+    template <> struct Diff< boost::posix_time::ptime >
     {
-        public:
-            Mean() : count_( 0 ) {}
-            void push( const char* buf )
-            {
-                T t = comma::csv::format::traits< T, F >::from_bin( buf );
-                ++count_;
-                mean_ = mean_ ? *mean_ + ( t - *mean_ ) / count_ : t ;
-            }
-            void calculate( char* buf ) { if( count_ > 0 ) { comma::csv::format::traits< T, F >::to_bin( *mean_, buf ); } }
-            base* clone() const { return new Mean< T, F >( *this ); }
-        private:
-            boost::optional< T > mean_;
-            std::size_t count_;
+        typedef double Type;
+        static double subtract( boost::posix_time::ptime lhs, boost::posix_time::ptime rhs ) { return double( ( lhs - rhs ).total_microseconds() ) / 1e6; }
     };
-    
-    template < typename T, comma::csv::format::types_enum F > class Stddev;
-    
+
+    /// conversion of values to and from double, as kept in running moments and quantile sketches
+    template < typename T > struct Real
+    {
+        static double from( T t ) { return static_cast< double >( t ); }
+        static T to( double d ) { return static_cast< T >( std::numeric_limits< T >::is_integer ? std::floor( d + 0.5 ) : d ); }
+        static typename Diff< T >::Type difference( double lhs, double rhs ) { return to( lhs - rhs ); }
+    };
+
+    template <> struct Real< boost::posix_time::ptime > // microseconds since epoch
+    {
+        static double from( const boost::posix_time::ptime& t ) { return double( ( t - boost::posix_time::ptime( comma::csv::impl::epoch ) ).total_microseconds() ); }
+        static boost::posix_time::ptime to( double d ) { return boost::posix_time::ptime( comma::csv::impl::epoch ) + boost::posix_time::microseconds( static_cast< comma::int64 >( std::floor( d + 0.5 ) ) ); }
+        static double difference( double lhs, double rhs ) { return ( lhs - rhs ) / 1e6; }
+    };
+
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Variance : public base // todo: generalise for kth moment
+    struct Mean
     {
-        public:
-            Variance() : count_( 0 ) {}
-            void push( const char* buf )
-            {
-                T t = comma::csv::format::traits< T, F >::from_bin( buf );
-                ++count_;
-                mean_ = mean_ ? *mean_ + ( t - *mean_ ) / count_ : t;
-                squares_ = squares_ ? *squares_ + ( t * t - *squares_ ) / count_ : t * t;
-            }
-            void calculate( char* buf ) { if( count_ > 0 ) { comma::csv::format::traits< T, F >::to_bin( *squares_ - *mean_ * *mean_, buf ); } }
-            base* clone() const { return new Variance< T, F >( *this ); }
-        private:
-            friend class Stddev< T, F >;
-            boost::optional< T > mean_;
-            boost::optional< T > squares_;
-            std::size_t count_;
+        struct value { double mean; std::size_t count; value() : mean( 0 ), count( 0 ) {} };
+        static void push( value& v, const T& t )
+        {
+            ++v.count;
+            v.mean += ( Real< T >::from( t ) - v.mean ) / v.count;
+        }
+        static void merge( value& lhs, const value& rhs )
+        {
+            if( rhs.count == 0 ) { return; }
+            lhs.count += rhs.count;
+            lhs.mean += ( rhs.mean - lhs.mean ) * rhs.count / lhs.count;
+        }
+        static void calculate( const value& v, char* buf ) { if( v.count > 0 ) { comma::csv::format::traits< T, F >::to_bin( Real< T >::to( v.mean ), buf ); } }
     };
-    
-    template < comma::csv::format::types_enum F >
-    class Variance< boost::posix_time::ptime, F > : public base
+
+    /// mean and sum of squared differences from the mean, updated by welford's algorithm, merged by its parallel form
+    /// kept in double, since differences of integer values would wrap or truncate
+    template < typename T > struct Moments // todo: generalise for kth moment
     {
-        void push( const char* ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
-        void calculate( char* ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
-        base* clone() const { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+        double mean;
+        double m2;
+        std::size_t count;
+        Moments() : mean( 0 ), m2( 0 ), count( 0 ) {}
+        void push( const T& t )
+        {
+            double r = Real< T >::from( t );
+            ++count;
+            double d = r - mean;
+            mean += d / count;
+            m2 += d * ( r - mean );
+        }
+        void merge( const Moments& rhs )
+        {
+            if( rhs.count == 0 ) { return; }
+            std::size_t n = count + rhs.count;
+            double d = rhs.mean - mean;
+            mean += d * rhs.count / n;
+            m2 += rhs.m2 + d * d * count * rhs.count / n;
+            count = n;
+        }
+        double variance() const { return m2 / count; }
     };
-    
+
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Stddev : public base
+    struct Variance
     {
-        public:
-            void push( const char* buf ) { variance_.push( buf ); }
-            void calculate( char* buf ) { if( variance_.count_ > 0 ) { comma::csv::format::traits< T, F >::to_bin( static_cast< T >( std::sqrt( static_cast< long double >( *variance_.squares_ - *variance_.mean_ * *variance_.mean_ ) ) ), buf ); } }
-            base* clone() const { return new Stddev< T, F >( *this ); }
-        private:
-            Variance< T, F > variance_;
+        typedef Moments< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void merge( value& lhs, const value& rhs ) { lhs.merge( rhs ); }
+        static void calculate( const value& v, char* buf ) { if( v.count > 0 ) { comma::csv::format::traits< T, F >::to_bin( Real< T >::to( v.variance() ), buf ); } }
     };
-    
+
     template < comma::csv::format::types_enum F >
-    class Stddev< boost::posix_time::ptime, F > : public base
+    struct Variance< boost::posix_time::ptime, F >
     {
-        void push( const char* ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
-        void calculate( char* ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
-        base* clone() const { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+        static void merge( value&, const value& ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
     };
-    
-    template < typename T > struct Diff
-    { 
-        typedef T Type;
-        static Type subtract( T lhs, T rhs ) { return lhs - rhs; }
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Stddev
+    {
+        typedef Moments< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void merge( value& lhs, const value& rhs ) { lhs.merge( rhs ); }
+        static void calculate( const value& v, char* buf ) { if( v.count > 0 ) { comma::csv::format::traits< T, F >::to_bin( Real< T >::to( std::sqrt( v.variance() ) ), buf ); } }
     };
 
-    template <> struct Diff< boost::posix_time::ptime >
+    template < comma::csv::format::types_enum F >
+    struct Stddev< boost::posix_time::ptime, F >
     {
-        typedef double Type;
-        static double subtract( boost::posix_time::ptime lhs, boost::posix_time::ptime rhs ) { return double( ( lhs - rhs ).total_microseconds() ) / 1e6; }
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+        static void merge( value&, const value& ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Diameter : public base
+    struct Diameter
     {
-        public:
-            void push( const char* buf ) { min_.push( buf ); max_.push( buf ); }
-            void calculate( char* buf ) { if( min_.min_ ) { comma::csv::format::traits< typename Diff< T >::Type >::to_bin( Diff< T >::subtract( *max_.max_, *min_.min_ ), buf ); } }
-            base* clone() const { return new Diameter< T, F >( *this ); }
-        private:
-            Min< T, F > min_;
-            Max< T, F > max_;
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void merge( value& lhs, const value& rhs ) { lhs.merge( rhs ); }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< typename Diff< T >::Type >::to_bin( Diff< T >::subtract( v.max, v.min ), buf ); } }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Radius : public base
+    struct Radius
     {
-        public:
-            void push( const char* buf ) { min_.push( buf ); max_.push( buf ); }
-            void calculate( char* buf ) { if( min_.min_ ) { comma::csv::format::traits< typename Diff< T >::Type >::to_bin( Diff< T >::subtract( *max_.max_, *min_.min_ ) / 2, buf ); } }
-            base* clone() const { return new Radius< T, F >( *this ); }
-        private:
-            Min< T, F > min_;
-            Max< T, F > max_;
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void merge( value& lhs, const value& rhs ) { lhs.merge( rhs ); }
+        static void calculate( const value& v, char* buf ) { if( v.set ) { comma::csv::format::traits< typename Diff< T >::Type >::to_bin( Diff< T >::subtract( v.max, v.min ) / 2, buf ); } }
     };
 
     template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
-    class Size : public base
+    struct Size
     {
-        public:
-            Size() : count_( 0 ) {}
-            void push( const char* ) { ++count_; }
-            void calculate( char* buf ) { comma::csv::format::traits< comma::uint32 >::to_bin( count_, buf ); }
-            base* clone() const { return new Size< T, F >( *this ); }
-        private:
-            std::size_t count_;
+        struct value { std::size_t count; value() : count( 0 ) {} };
+        static void push( value& v, const T& ) { ++v.count; }
+        static void merge( value& lhs, const value& rhs ) { lhs.count += rhs.count; }
+        static void calculate( const value& v, char* buf ) { comma::csv::format::traits< comma::uint32 >::to_bin( v.count, buf ); }
     };
     
-    struct Enum { enum Values { min, max, centre, mean, sum, size, radius, diameter, variance, stddev }; };
+    struct Enum { enum Values { min, max, centre, mean, sum, size, radius, diameter, variance, stddev, median, percentile, iqr }; };
     
     static Enum::Values from_name( const std::string& name )
     {
@@ -493,9 +647,39 @@ namespace Operations
         else if( name == "var" ) { return Enum::variance; }
         else if( name == "stddev" ) { return Enum::stddev; }
         else if( name == "size" ) { return Enum::size; }
+        else if( name == "median" ) { return Enum::median; }
+        else if( name == "percentile" ) { return Enum::percentile; }
+        else if( name == "iqr" ) { return Enum::iqr; }
         else { COMMA_THROW( comma::exception, "expected operation name, got " << name ); }
     }
-    
+
+    /// operation with its parameters
+    struct Description
+    {
+        Enum::Values type;
+        double percentile;
+        std::size_t compression;
+        Description() : type( Enum::min ), percentile( 0.5 ), compression( 100 ) {}
+    };
+
+    /// parse operation, e.g. "mean" or "percentile=0.9"
+    static Description from_string( const std::string& s, std::size_t compression )
+    {
+        std::vector< std::string > v = comma::split( s, '=' );
+        Description d;
+        d.type = from_name( v[0] );
+        d.compression = compression;
+        if( d.type != Enum::percentile )
+        {
+            if( v.size() > 1 ) { COMMA_THROW( comma::exception, "operation " << v[0] << " takes no parameters, got " << s ); }
+            return d;
+        }
+        if( v.size() != 2 || v[1].empty() ) { COMMA_THROW( comma::exception, "expected percentile=<p>, got " << s ); }
+        d.percentile = boost::lexical_cast< double >( v[1] );
+        if( !( d.percentile >= 0 && d.percentile <= 1 ) ) { COMMA_THROW( comma::exception, "expected percentile between 0 and 1, got " << s ); }
+        return d;
+    }
+
     template < Enum::Values E > struct traits {};
     template <> struct traits< Enum::min > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Min< T, F > Type; }; };
     template <> struct traits< Enum::max > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Max< T, F > Type; }; };
@@ -507,155 +691,901 @@ namespace Operations
     template <> struct traits< Enum::diameter > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Diameter< T, F > Type; }; };
     template <> struct traits< Enum::variance > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Variance< T, F > Type; }; };
     template <> struct traits< Enum::stddev > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Stddev< T, F > Type; }; };
+
+    /// return output type of operation on values of a given type
+    static comma::csv::format::types_enum output_type( Enum::Values operation, comma::csv::format::types_enum type )
+    {
+        switch( operation )
+        {
+            case Enum::radius:
+            case Enum::diameter:
+            case Enum::iqr:
+                return type == comma::csv::format::time || type == comma::csv::format::long_time ? comma::csv::format::double_t : type;
+            case Enum::size:
+                return comma::csv::format::uint32;
+            default:
+                return type;
+        }
+    }
 } // namespace Operations
 
-class Operationbase
+/// operations on a sliding window of values of a single column, e.g. the last n values of an id
+///
+/// same as in Operations, but values also get popped, oldest first, and
+/// push(), pop() and calculate() take amortised constant time
+namespace Windows
+{
+    /// circular buffer, growing as needed; unlike std::deque, does not allocate while empty
+    template < typename T > class Ring
+    {
+        public:
+            Ring() : first_( 0 ), size_( 0 ) {}
+            std::size_t size() const { return size_; }
+            bool empty() const { return size_ == 0; }
+            const T& front() const { return values_[first_]; }
+            const T& back() const { return values_[ index_( size_ - 1 ) ]; }
+            void push_back( const T& t ) { if( size_ == values_.size() ) { grow_(); } values_[ index_( size_++ ) ] = t; }
+            void pop_front() { first_ = index_( 1 ); --size_; }
+            void pop_back() { --size_; }
+        private:
+            std::vector< T > values_;
+            std::size_t first_;
+            std::size_t size_;
+            std::size_t index_( std::size_t i ) const { i += first_; return i < values_.size() ? i : i - values_.size(); }
+            void grow_()
+            {
+                std::vector< T > v( values_.empty() ? 4 : values_.size() * 2 );
+                for( std::size_t i = 0; i < size_; ++i ) { v[i] = values_[ index_( i ) ]; }
+                values_.swap( v );
+                first_ = 0;
+            }
+    };
+
+    /// values in the window that still may become its minimum (or maximum with Less = std::greater), oldest first
+    template < typename T, typename Less > struct Monotonic
+    {
+        Ring< std::pair< comma::uint64, T > > values; // with sequence numbers
+        comma::uint64 pushed;
+        comma::uint64 popped;
+        Monotonic() : pushed( 0 ), popped( 0 ) {}
+        void push( const T& t )
+        {
+            while( !values.empty() && !Less()( values.back().second, t ) ) { values.pop_back(); }
+            values.push_back( std::make_pair( pushed++, t ) );
+        }
+        void pop() { if( !values.empty() && values.front().first == popped ) { values.pop_front(); } ++popped; }
+        bool empty() const { return values.empty(); }
+        const T& front() const { return values.front().second; }
+    };
+
+    template < typename T > struct Extents
+    {
+        Monotonic< T, std::less< T > > min;
+        Monotonic< T, std::greater< T > > max;
+        void push( const T& t ) { min.push( t ); max.push( t ); }
+        void pop() { min.pop(); max.pop(); }
+        bool empty() const { return min.empty(); }
+    };
+
+    /// sum with compensated (kahan) addition, thus rounding errors do not accumulate, when values are subtracted
+    struct Kahan
+    {
+        double sum;
+        double compensation;
+        Kahan() : sum( 0 ), compensation( 0 ) {}
+        void add( double x ) { double y = x - compensation; double t = sum + y; compensation = ( t - sum ) - y; sum = t; }
+    };
+
+    /// running sums of values and their squares, shifted by the first value in the window to avoid cancellation
+    template < typename T > struct Sums
+    {
+        Ring< double > values; // shifted
+        double shift;
+        Kahan sum;
+        Kahan squares;
+        Sums() : shift( 0 ) {}
+        void push( const T& t )
+        {
+            double d = Operations::Real< T >::from( t );
+            if( values.empty() ) { shift = d; sum = Kahan(); squares = Kahan(); }
+            d -= shift;
+            values.push_back( d );
+            sum.add( d );
+            squares.add( d * d );
+        }
+        void pop()
+        {
+            double d = values.front();
+            values.pop_front();
+            sum.add( -d );
+            squares.add( -d * d );
+        }
+        bool empty() const { return values.empty(); }
+        double total() const { return shift * values.size() + sum.sum; }
+        double mean() const { return shift + sum.sum / values.size(); }
+        double variance() const { double m = sum.sum / values.size(); double v = squares.sum / values.size() - m * m; return v > 0 ? v : 0; }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Min
+    {
+        typedef Monotonic< T, std::less< T > > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( v.front(), buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Max
+    {
+        typedef Monotonic< T, std::greater< T > > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( v.front(), buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Centre
+    {
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( v.min.front() + ( v.max.front() - v.min.front() ) / 2, buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Diameter
+    {
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< typename Operations::Diff< T >::Type >::to_bin( Operations::Diff< T >::subtract( v.max.front(), v.min.front() ), buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Radius
+    {
+        typedef Extents< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< typename Operations::Diff< T >::Type >::to_bin( Operations::Diff< T >::subtract( v.max.front(), v.min.front() ) / 2, buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Sum
+    {
+        typedef Sums< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( Operations::Real< T >::to( v.total() ), buf ); } }
+    };
+
+    template < comma::csv::format::types_enum F >
+    struct Sum< boost::posix_time::ptime, F >
+    {
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+        static void pop( value& ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "sum not defined for time" ); }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Mean
+    {
+        typedef Sums< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( Operations::Real< T >::to( v.mean() ), buf ); } }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Variance
+    {
+        typedef Sums< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( Operations::Real< T >::to( v.variance() ), buf ); } }
+    };
+
+    template < comma::csv::format::types_enum F >
+    struct Variance< boost::posix_time::ptime, F >
+    {
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+        static void pop( value& ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "variance not implemented for time, todo" ); }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Stddev
+    {
+        typedef Sums< T > value;
+        static void push( value& v, const T& t ) { v.push( t ); }
+        static void pop( value& v ) { v.pop(); }
+        static void calculate( const value& v, char* buf ) { if( !v.empty() ) { comma::csv::format::traits< T, F >::to_bin( Operations::Real< T >::to( std::sqrt( v.variance() ) ), buf ); } }
+    };
+
+    template < comma::csv::format::types_enum F >
+    struct Stddev< boost::posix_time::ptime, F >
+    {
+        struct value {};
+        static void push( value&, const boost::posix_time::ptime& ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+        static void pop( value& ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+        static void calculate( const value&, char* ) { COMMA_THROW( comma::exception, "standard deviation not implemented for time, todo" ); }
+    };
+
+    template < typename T, comma::csv::format::types_enum F = comma::csv::format::type_to_enum< T >::value >
+    struct Size
+    {
+        struct value { std::size_t count; value() : count( 0 ) {} };
+        static void push( value& v, const T& ) { ++v.count; }
+        static void pop( value& v ) { --v.count; }
+        static void calculate( const value& v, char* buf ) { comma::csv::format::traits< comma::uint32 >::to_bin( v.count, buf ); }
+    };
+
+    template < Operations::Enum::Values E > struct traits {};
+    template <> struct traits< Operations::Enum::min > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Min< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::max > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Max< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::centre > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Centre< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::mean > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Mean< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::sum > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Sum< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::size > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Size< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::radius > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Radius< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::diameter > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Diameter< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::variance > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Variance< T, F > Type; }; };
+    template <> struct traits< Operations::Enum::stddev > { template < typename T, comma::csv::format::types_enum F > struct FromEnum { typedef Stddev< T, F > Type; }; };
+} // namespace Windows
+
+/// open addressing hash table of ids: maps each id to a slot, i.e. its index
+/// in the accumulator arrays, slots being allocated in the order of ids appearance
+class Ids
 {
     public:
-        virtual ~Operationbase() {}
-        virtual void push( const char* buf ) = 0;
-        virtual void calculate() = 0;
-        virtual Operationbase* clone() const = 0;
-        const comma::csv::format& output_format() const { return output_format_; }
-        const char* buffer() const { return &buffer_[0]; }
-        
-    protected:
-        boost::ptr_vector< Operations::base > operations_;
-        comma::csv::format input_format_;
-        std::vector< comma::csv::format::element > input_elements_;
-        comma::csv::format output_format_;
-        std::vector< comma::csv::format::element > output_elements_;
-        std::vector< char > buffer_;
-        
-        Operationbase* deep_copy_to_( Operationbase* lhs ) const
+        Ids() { rehash_( 10 ); }
+
+        /// return number of ids
+        std::size_t size() const { return ids_.size(); }
+
+        /// return id in a given slot
+        comma::uint32 operator[]( std::size_t slot ) const { return ids_[slot]; }
+
+        /// return slot of an id, add id, if new
+        std::size_t insert( comma::uint32 id )
+        {
+            std::size_t i = hash_( id );
+            for( ; table_[i].slot > 0; i = ( i + 1 ) & mask_ ) { if( table_[i].id == id ) { return table_[i].slot - 1; } }
+            if( ( ids_.size() + 1 ) * 2 > table_.size() ) { rehash_( bits_ + 1 ); return insert( id ); } // keep load factor under 0.5
+            ids_.push_back( id );
+            positions_.push_back( i );
+            table_[i].id = id;
+            table_[i].slot = ids_.size();
+            return ids_.size() - 1;
+        }
+
+        /// remove all ids, keep the table allocated
+        void clear()
+        {
+            for( std::size_t i = 0; i < positions_.size(); ++i ) { table_[ positions_[i] ].slot = 0; }
+            ids_.clear();
+            positions_.clear();
+        }
+
+    private:
+        struct entry { comma::uint32 id; comma::uint32 slot; entry() : id( 0 ), slot( 0 ) {} }; // slot + 1, 0 if empty
+        std::vector< entry > table_;
+        std::vector< comma::uint32 > ids_;
+        std::vector< std::size_t > positions_; // position in table by slot
+        unsigned int bits_;
+        std::size_t mask_;
+        std::size_t hash_( comma::uint32 id ) const { return ( id * 2654435769u ) >> ( 32 - bits_ ); } // fibonacci hashing, thus consecutive ids are spread over the table
+        void rehash_( unsigned int bits )
+        {
+            bits_ = bits;
+            table_.assign( std::size_t( 1 ) << bits_, entry() );
+            mask_ = table_.size() - 1;
+            for( std::size_t s = 0; s < ids_.size(); ++s )
+            {
+                std::size_t i = hash_( ids_[s] );
+                while( table_[i].slot > 0 ) { i = ( i + 1 ) & mask_; }
+                table_[i].id = ids_[s];
+                table_[i].slot = s + 1;
+                positions_[s] = i;
+            }
+        }
+};
+
+/// values of an operation on a column for all the ids
+struct Accumulator
+{
+    virtual ~Accumulator() {}
+    virtual void resize( std::size_t size ) = 0;
+    virtual void clear() = 0;
+    /// update ids in given slots with a column of count values
+    virtual void update( const comma::uint32* slots, const char* column, std::size_t count ) = 0;
+    /// merge values of the same operation on the same column, slot by slot
+    virtual void merge( const Accumulator& rhs ) = 0;
+    virtual void calculate( std::size_t slot, char* buf ) const = 0;
+};
+
+/// contiguous array of operation values, one per id, updated a column at a time in a type-specialised loop
+template < typename Operation, typename T, comma::csv::format::types_enum F >
+class AccumulatorOf : public Accumulator
+{
+    public:
+        AccumulatorOf( std::size_t size ) : size_( size ) {}
+        void resize( std::size_t size ) { values_.resize( size ); }
+        void clear() { values_.clear(); }
+        void update( const comma::uint32* slots, const char* column, std::size_t count )
+        {
+            for( std::size_t k = 0; k < count; ++k, column += size_ ) { Operation::push( values_[ slots[k] ], comma::csv::format::traits< T, F >::from_bin( column ) ); }
+        }
+        void merge( const Accumulator& rhs )
         {
-            lhs->input_format_ = input_format_;
-            lhs->input_elements_ = input_elements_;
-            lhs->output_format_ = output_format_;
-            lhs->output_elements_ = output_elements_;
-            lhs->buffer_ = buffer_;
-            for( std::size_t i = 0; i < operations_.size(); ++i ) { lhs->operations_.push_back( operations_[i].clone() ); }
-            return lhs;
+            const std::vector< typename Operation::value >& values = static_cast< const AccumulatorOf& >( rhs ).values_;
+            if( values.size() > values_.size() ) { values_.resize( values.size() ); }
+            for( std::size_t k = 0; k < values.size(); ++k ) { Operation::merge( values_[k], values[k] ); }
         }
+        void calculate( std::size_t slot, char* buf ) const { Operation::calculate( values_[slot], buf ); }
+    private:
+        std::size_t size_;
+        std::vector< typename Operation::value > values_;
 };
 
-template < Operations::Enum::Values E >
-struct Operation : public Operationbase
+/// median, percentile or iqr of a column for all the ids, each id with a bounded-size sketch
+template < typename T, comma::csv::format::types_enum F >
+class QuantileOf : public Accumulator
 {
-    Operation() {}
-    Operation( const comma::csv::format& format )
+    public:
+        QuantileOf( std::size_t size, const Operations::Description& description ) : size_( size ), description_( description ), empty_( description.compression ) {}
+        void resize( std::size_t size ) { values_.resize( size, empty_ ); }
+        void clear() { values_.clear(); }
+        void update( const comma::uint32* slots, const char* column, std::size_t count )
+        {
+            for( std::size_t k = 0; k < count; ++k, column += size_ ) { values_[ slots[k] ].push( Operations::Real< T >::from( comma::csv::format::traits< T, F >::from_bin( column ) ) ); }
+        }
+        void merge( const Accumulator& rhs )
+        {
+            const std::vector< comma::math::digest >& values = static_cast< const QuantileOf& >( rhs ).values_;
+            if( values.size() > values_.size() ) { values_.resize( values.size(), empty_ ); }
+            for( std::size_t k = 0; k < values.size(); ++k ) { values_[k].merge( values[k] ); }
+        }
+        void calculate( std::size_t slot, char* buf ) const
+        {
+            const comma::math::digest& d = values_[slot];
+            if( d.empty() ) { return; }
+            if( description_.type == Operations::Enum::iqr ) { comma::csv::format::traits< typename Operations::Diff< T >::Type >::to_bin( Operations::Real< T >::difference( d.quantile( 0.75 ), d.quantile( 0.25 ) ), buf ); }
+            else { comma::csv::format::traits< T, F >::to_bin( Operations::Real< T >::to( d.quantile( description_.type == Operations::Enum::median ? 0.5 : description_.percentile ) ), buf ); }
+        }
+    private:
+        std::size_t size_;
+        Operations::Description description_;
+        comma::math::digest empty_;
+        std::vector< comma::math::digest > values_;
+};
+
+/// make accumulator of operation E on values of type T; specialised for operations with parameters
+template < Operations::Enum::Values E, typename T, comma::csv::format::types_enum F >
+struct Accumulators { static Accumulator* make( std::size_t size, const Operations::Description& ) { return new AccumulatorOf< typename Operations::traits< E >::template FromEnum< T, F >::Type, T, F >( size ); } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct Accumulators< Operations::Enum::median, T, F > { static Accumulator* make( std::size_t size, const Operations::Description& d ) { return new QuantileOf< T, F >( size, d ); } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct Accumulators< Operations::Enum::percentile, T, F > { static Accumulator* make( std::size_t size, const Operations::Description& d ) { return new QuantileOf< T, F >( size, d ); } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct Accumulators< Operations::Enum::iqr, T, F > { static Accumulator* make( std::size_t size, const Operations::Description& d ) { return new QuantileOf< T, F >( size, d ); } };
+
+/// make accumulator with a factory like Accumulators for operation E on values of an element; return NULL, if not defined
+template < template < Operations::Enum::Values, typename, comma::csv::format::types_enum > class Factory, typename Result, Operations::Enum::Values E >
+static Result* make_typed_accumulator( const Operations::Description& d, const comma::csv::format::element& e )
+{
+    switch( e.type )
     {
-        input_format_ = format;
-        input_elements_.reserve( input_format_.count() );
-        for( std::size_t i = 0; i < input_format_.count(); ++i ) { input_elements_.push_back( input_format_.offset( i ) ); }
-        operations_.reserve( input_elements_.size() );
-        for( std::size_t i = 0; i < input_elements_.size(); ++i )
+        case comma::csv::format::char_t: return Factory< E, char, comma::csv::format::char_t >::make( e.size, d );
+        case comma::csv::format::int8: return Factory< E, char, comma::csv::format::int8 >::make( e.size, d );
+        case comma::csv::format::uint8: return Factory< E, unsigned char, comma::csv::format::uint8 >::make( e.size, d );
+        case comma::csv::format::int16: return Factory< E, comma::int16, comma::csv::format::int16 >::make( e.size, d );
+        case comma::csv::format::uint16: return Factory< E, comma::uint16, comma::csv::format::uint16 >::make( e.size, d );
+        case comma::csv::format::int32: return Factory< E, comma::int32, comma::csv::format::int32 >::make( e.size, d );
+        case comma::csv::format::uint32: return Factory< E, comma::uint32, comma::csv::format::uint32 >::make( e.size, d );
+        case comma::csv::format::int64: return Factory< E, comma::int64, comma::csv::format::int64 >::make( e.size, d );
+        case comma::csv::format::uint64: return Factory< E, comma::uint64, comma::csv::format::uint64 >::make( e.size, d );
+        case comma::csv::format::float_t: return Factory< E, float, comma::csv::format::float_t >::make( e.size, d );
+        case comma::csv::format::double_t: return Factory< E, double, comma::csv::format::double_t >::make( e.size, d );
+        case comma::csv::format::time: return Factory< E, boost::posix_time::ptime, comma::csv::format::time >::make( e.size, d );
+        case comma::csv::format::long_time: return Factory< E, boost::posix_time::ptime, comma::csv::format::long_time >::make( e.size, d );
+        default: return NULL;
+    }
+}
+
+/// make accumulator with a factory like Accumulators for an operation on values of an element; return NULL, if not defined
+template < template < Operations::Enum::Values, typename, comma::csv::format::types_enum > class Factory, typename Result >
+static Result* make_accumulator( const Operations::Description& d, const comma::csv::format::element& e )
+{
+    switch( d.type )
+    {
+        case Operations::Enum::min: return make_typed_accumulator< Factory, Result, Operations::Enum::min >( d, e );
+        case Operations::Enum::max: return make_typed_accumulator< Factory, Result, Operations::Enum::max >( d, e );
+        case Operations::Enum::centre: return make_typed_accumulator< Factory, Result, Operations::Enum::centre >( d, e );
+        case Operations::Enum::mean: return make_typed_accumulator< Factory, Result, Operations::Enum::mean >( d, e );
+        case Operations::Enum::radius: return make_typed_accumulator< Factory, Result, Operations::Enum::radius >( d, e );
+        case Operations::Enum::diameter: return make_typed_accumulator< Factory, Result, Operations::Enum::diameter >( d, e );
+        case Operations::Enum::variance: return make_typed_accumulator< Factory, Result, Operations::Enum::variance >( d, e );
+        case Operations::Enum::stddev: return make_typed_accumulator< Factory, Result, Operations::Enum::stddev >( d, e );
+        case Operations::Enum::sum: return make_typed_accumulator< Factory, Result, Operations::Enum::sum >( d, e );
+        case Operations::Enum::size: return make_typed_accumulator< Factory, Result, Operations::Enum::size >( d, e );
+        case Operations::Enum::median: return make_typed_accumulator< Factory, Result, Operations::Enum::median >( d, e );
+        case Operations::Enum::percentile: return make_typed_accumulator< Factory, Result, Operations::Enum::percentile >( d, e );
+        case Operations::Enum::iqr: return make_typed_accumulator< Factory, Result, Operations::Enum::iqr >( d, e );
+    }
+    return NULL;
+}
+
+/// aggregation of records by slot
+///
+/// records are pushed into a batch, the batch is decoded into columns
+/// and each accumulator is updated with its column in a single loop,
+/// thus virtual dispatch happens once per batch, not once per record
+class Aggregator
+{
+    public:
+        Aggregator( const std::vector< Operations::Description >& operations, const comma::csv::format& format, std::size_t capacity = 4096 )
+            : columns_( format, capacity )
+            , records_( format.size() * capacity )
+            , slots_( capacity )
+            , count_( 0 )
+            , size_( 0 )
+            , output_formats_( operations.size() )
+            , output_elements_( operations.size() )
+            , buffers_( operations.size() )
         {
-            comma::csv::format::types_enum output_type = input_elements_[i].type;
-            switch( E ) // quick and dirty, implement in operations::traits, just no time
+            for( std::size_t i = 0; i < operations.size(); ++i )
             {
-                case Operations::Enum::radius:
-                case Operations::Enum::diameter:
-                    if( input_elements_[i].type == comma::csv::format::time || input_elements_[i].type == comma::csv::format::long_time ) { output_type = comma::csv::format::double_t; }
-                    break;
-                case Operations::Enum::size:
-                    output_type = comma::csv::format::uint32;
-                    break;
-                default:
-                    break;
+                for( std::size_t j = 0; j < columns_.count(); ++j )
+                {
+                    const comma::csv::format::element& e = columns_.element( j );
+                    Accumulator* a = make_accumulator< Accumulators, Accumulator >( operations[i], e );
+                    if( !a ) { COMMA_THROW( comma::exception, "operations for " << j << "th element in " << columns_.format().string() << " not defined" ); }
+                    accumulators_.push_back( a );
+                    output_formats_[i] += comma::csv::format::to_format( Operations::output_type( operations[i].type, e.type ) );
+                }
+                for( std::size_t j = 0; j < columns_.count(); ++j ) { output_elements_[i].push_back( output_formats_[i].offset( j ) ); }
+                buffers_[i].resize( output_formats_[i].size() );
             }
-            switch( input_elements_[i].type )
+        }
+
+        /// push record for a given slot
+        void push( comma::uint32 slot, const char* record )
+        {
+            slots_[count_] = slot;
+            ::memcpy( &records_[ count_ * columns_.format().size() ], record, columns_.format().size() );
+            if( ++count_ == slots_.size() ) { flush_(); }
+        }
+
+        /// update with a batch of count packed records (count not greater than capacity) for given slots
+        void update( const char* records, const comma::uint32* slots, std::size_t count )
+        {
+            if( count == 0 ) { return; }
+            for( std::size_t k = 0; k < count; ++k ) { if( slots[k] >= size_ ) { size_ = slots[k] + 1; } }
+            columns_.decode( records, count );
+            for( std::size_t i = 0; i < accumulators_.size(); ++i )
             {
-                case comma::csv::format::char_t: operations_.push_back( new typename Operations::traits< E >::template FromEnum< char, comma::csv::format::char_t >::Type ); break;
-                case comma::csv::format::int8: operations_.push_back( new typename Operations::traits< E >::template FromEnum< char, comma::csv::format::int8 >::Type ); break;
-                case comma::csv::format::uint8: operations_.push_back( new typename Operations::traits< E >::template FromEnum< unsigned char, comma::csv::format::uint8 >::Type ); break;
-                case comma::csv::format::int16: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::int16, comma::csv::format::int16 >::Type ); break;
-                case comma::csv::format::uint16: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::uint16, comma::csv::format::uint16 >::Type ); break;
-                case comma::csv::format::int32: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::int32, comma::csv::format::int32 >::Type ); break;
-                case comma::csv::format::uint32: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::uint32, comma::csv::format::uint32 >::Type ); break;
-                case comma::csv::format::int64: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::int64, comma::csv::format::int64 >::Type ); break;
-                case comma::csv::format::uint64: operations_.push_back( new typename Operations::traits< E >::template FromEnum< comma::uint64, comma::csv::format::uint64 >::Type ); break;
-                case comma::csv::format::float_t: operations_.push_back( new typename Operations::traits< E >::template FromEnum< float, comma::csv::format::float_t >::Type ); break;
-                case comma::csv::format::double_t: operations_.push_back( new typename Operations::traits< E >::template FromEnum< double, comma::csv::format::double_t >::Type ); break;
-                case comma::csv::format::time: operations_.push_back( new typename Operations::traits< E >::template FromEnum< boost::posix_time::ptime, comma::csv::format::time >::Type ); break;
-                case comma::csv::format::long_time: operations_.push_back( new typename Operations::traits< E >::template FromEnum< boost::posix_time::ptime, comma::csv::format::long_time >::Type ); break;
-                default: COMMA_THROW( comma::exception, "operations for " << i << "th element in " << format.string() << " not defined" );
+                accumulators_[i].resize( size_ );
+                accumulators_[i].update( slots, columns_.data( i % columns_.count() ), count );
             }
-            output_format_ += comma::csv::format::to_format( output_type );
         }
-        for( std::size_t i = 0; i < input_elements_.size(); ++i ) { output_elements_.push_back( output_format_.offset( i ) ); }
-        buffer_.resize( output_format_.size() );
-    }
-    
-    void push( const char* buf )
-    {
-        for( std::size_t i = 0; i < operations_.size(); ++i ) { operations_[i].push( buf + input_elements_[i].offset ); }
-    }
-    
-    void calculate()
-    {
-        for( std::size_t i = 0; i < operations_.size(); ++i ) { operations_[i].calculate( &buffer_[0] + output_elements_[i].offset ); }
-    }
-    
-    Operationbase* clone() const { Operation< E >* op = new Operation< E >; return deep_copy_to_( op ); }
+
+        /// merge values of another aggregator with the same operations and format, slot by slot
+        void merge( Aggregator& rhs )
+        {
+            if( count_ > 0 ) { flush_(); }
+            if( rhs.count_ > 0 ) { rhs.flush_(); }
+            for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].merge( rhs.accumulators_[i] ); }
+            if( rhs.size_ > size_ ) { size_ = rhs.size_; }
+        }
+
+        /// return number of slots
+        std::size_t size() const { return size_; }
+
+        /// return number of operations
+        std::size_t operations() const { return output_formats_.size(); }
+
+        /// return output format of an operation
+        const comma::csv::format& output_format( std::size_t operation ) const { return output_formats_[operation]; }
+
+        /// calculate operation for id in a given slot, return output buffer
+        const char* calculate( std::size_t slot, std::size_t operation )
+        {
+            if( count_ > 0 ) { flush_(); }
+            std::size_t n = columns_.count();
+            for( std::size_t j = 0; j < n; ++j ) { accumulators_[ operation * n + j ].calculate( slot, &buffers_[operation][0] + output_elements_[operation][j].offset ); }
+            return &buffers_[operation][0];
+        }
+
+        /// remove all values, e.g. at the end of block
+        void clear()
+        {
+            count_ = 0;
+            size_ = 0;
+            for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].clear(); }
+        }
+
+    private:
+        comma::csv::columns columns_;
+        std::vector< char > records_;
+        std::vector< comma::uint32 > slots_;
+        std::size_t count_;
+        std::size_t size_;
+        std::vector< comma::csv::format > output_formats_;
+        std::vector< std::vector< comma::csv::format::element > > output_elements_;
+        std::vector< std::vector< char > > buffers_;
+        boost::ptr_vector< Accumulator > accumulators_; // by operation, then by column
+
+        void flush_() { update( &records_[0], &slots_[0], count_ ); count_ = 0; }
 };
 
-typedef boost::unordered_map< comma::uint32, boost::ptr_vector< Operationbase >* > OperationsMap;
+/// aggregator updated in its own thread with batches of records
+class Worker : public boost::noncopyable
+{
+    public:
+        Worker( const std::vector< Operations::Description >& operations, const comma::csv::format& format, std::size_t capacity = 4096, std::size_t batches = 4 )
+            : aggregator_( operations, format, capacity )
+            , record_size_( format.size() )
+            , capacity_( capacity )
+            , busy_( false )
+            , shutdown_( false )
+        {
+            for( std::size_t i = 0; i < batches; ++i ) { free_.push_back( batch_ptr( new batch( record_size_, capacity_ ) ) ); }
+            thread_.reset( new boost::thread( boost::bind( &Worker::work_, this ) ) );
+        }
+
+        ~Worker()
+        {
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                shutdown_ = true;
+            }
+            queued_.notify_all();
+            thread_->join();
+        }
 
-static void init_operations( boost::ptr_vector< Operationbase >& operations
-                           , const std::vector< Operations::Enum::Values >& operation_ids
-                           , const comma::csv::format& format )
+        /// push record for a given slot; return true, if it completed a batch, which got queued for aggregation
+        bool push( comma::uint32 slot, const char* record )
+        {
+            if( !current_ )
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                while( free_.empty() ) { freed_.wait( lock ); }
+                current_ = free_.back();
+                free_.pop_back();
+                current_->count = 0;
+            }
+            current_->slots[ current_->count ] = slot;
+            ::memcpy( &current_->records[ current_->count * record_size_ ], record, record_size_ );
+            if( ++current_->count < capacity_ ) { return false; }
+            submit_();
+            return true;
+        }
+
+        /// wait until all the pushed records are aggregated; rethrow aggregation error, if any
+        void sync()
+        {
+            if( current_ ) { submit_(); }
+            boost::mutex::scoped_lock lock( mutex_ );
+            while( busy_ || !queue_.empty() ) { freed_.wait( lock ); }
+            if( !error_.empty() ) { COMMA_THROW( comma::exception, error_ ); }
+        }
+
+        /// return aggregator; access only after sync()
+        Aggregator& aggregator() { return aggregator_; }
+        const Aggregator& aggregator() const { return aggregator_; }
+
+    private:
+        struct batch
+        {
+            std::vector< char > records;
+            std::vector< comma::uint32 > slots;
+            std::size_t count;
+            batch( std::size_t record_size, std::size_t capacity ) : records( record_size * capacity ), slots( capacity ), count( 0 ) {}
+        };
+        typedef boost::shared_ptr< batch > batch_ptr;
+        Aggregator aggregator_;
+        std::size_t record_size_;
+        std::size_t capacity_;
+        batch_ptr current_;
+        std::deque< batch_ptr > queue_;
+        std::vector< batch_ptr > free_;
+        boost::mutex mutex_;
+        boost::condition_variable queued_;
+        boost::condition_variable freed_;
+        bool busy_;
+        bool shutdown_;
+        std::string error_;
+        boost::scoped_ptr< boost::thread > thread_;
+
+        void submit_()
+        {
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                queue_.push_back( current_ );
+            }
+            current_.reset();
+            queued_.notify_one();
+        }
+
+        void work_()
+        {
+            while( true )
+            {
+                batch_ptr b;
+                {
+                    boost::mutex::scoped_lock lock( mutex_ );
+                    while( !shutdown_ && queue_.empty() ) { queued_.wait( lock ); }
+                    if( shutdown_ ) { return; }
+                    b = queue_.front();
+                    queue_.pop_front();
+                    busy_ = true;
+                }
+                std::string error;
+                try { aggregator_.update( &b->records[0], &b->slots[0], b->count ); } // after an error, keep consuming batches, so that push() does not block
+                catch( std::exception& ex ) { error = ex.what(); }
+                catch( ... ) { error = "unknown exception"; }
+                {
+                    boost::mutex::scoped_lock lock( mutex_ );
+                    if( error_.empty() ) { error_ = error; }
+                    free_.push_back( b );
+                    busy_ = false;
+                }
+                freed_.notify_all();
+            }
+        }
+};
+
+/// hash aggregation of records by id, in the main thread or in a number of worker threads
+///
+/// each id gets a slot in the order of its first appearance;
+/// with partitioning, the ids are spread between the workers by slot,
+/// each id aggregated by only one worker in the order of input, thus the output
+/// is the same as when aggregating in the main thread; without partitioning
+/// (e.g. no id field), whole batches are dealt to the workers in turn and
+/// the workers' values are merged at the end of block
+class Aggregation
 {
-    static boost::ptr_vector< Operationbase > sample;
-    if( sample.empty() )
-    {
-        sample.reserve( operation_ids.size() );
-        for( std::size_t i = 0; i < operation_ids.size(); ++i )
-        { 
-            switch( operation_ids[i] )
+    public:
+        Aggregation( const std::vector< Operations::Description >& operations, const comma::csv::format& format, unsigned int threads, bool partition )
+            : partition_( partition )
+            , current_( 0 )
+            , synced_( false )
+        {
+            if( threads == 0 ) { aggregator_.reset( new Aggregator( operations, format ) ); return; }
+            for( unsigned int i = 0; i < threads; ++i ) { workers_.push_back( new Worker( operations, format ) ); }
+        }
+
+        /// push record of a given id
+        void push( comma::uint32 id, const char* record )
+        {
+            synced_ = false;
+            std::size_t slot = ids_.insert( id );
+            if( aggregator_ ) { aggregator_->push( slot, record ); }
+            else if( partition_ ) { workers_[ slot % workers_.size() ].push( slot / workers_.size(), record ); }
+            else if( workers_[ current_ ].push( slot, record ) ) { current_ = ( current_ + 1 ) % workers_.size(); }
+        }
+
+        /// return number of ids
+        std::size_t size() const { return ids_.size(); }
+
+        /// return id in a given slot
+        comma::uint32 id( std::size_t slot ) const { return ids_[slot]; }
+
+        /// return number of operations
+        std::size_t operations() const { return at_( 0 ).operations(); }
+
+        /// return output format of an operation
+        const comma::csv::format& output_format( std::size_t operation ) const { return at_( 0 ).output_format( operation ); }
+
+        /// calculate operation for id in a given slot, return output buffer
+        const char* calculate( std::size_t slot, std::size_t operation )
+        {
+            if( !synced_ ) { sync_(); }
+            if( aggregator_ || !partition_ ) { return at_( 0 ).calculate( slot, operation ); }
+            return at_( slot % workers_.size() ).calculate( slot / workers_.size(), operation );
+        }
+
+        /// remove all ids and their values, e.g. at the end of block
+        void clear()
+        {
+            if( !synced_ ) { sync_(); }
+            ids_.clear();
+            current_ = 0;
+            if( aggregator_ ) { aggregator_->clear(); }
+            for( std::size_t i = 0; i < workers_.size(); ++i ) { workers_[i].aggregator().clear(); }
+        }
+
+    private:
+        bool partition_;
+        Ids ids_;
+        boost::scoped_ptr< Aggregator > aggregator_;
+        boost::ptr_vector< Worker > workers_;
+        std::size_t current_;
+        bool synced_;
+
+        Aggregator& at_( std::size_t i ) { return aggregator_ ? *aggregator_ : workers_[i].aggregator(); }
+        const Aggregator& at_( std::size_t i ) const { return aggregator_ ? *aggregator_ : workers_[i].aggregator(); }
+
+        void sync_()
+        {
+            for( std::size_t i = 0; i < workers_.size(); ++i ) { workers_[i].sync(); }
+            if( !partition_ ) { for( std::size_t i = 1; i < workers_.size(); ++i ) { workers_[0].aggregator().merge( workers_[i].aggregator() ); workers_[i].aggregator().clear(); } }
+            synced_ = true;
+        }
+};
+
+/// values of an operation on a column in sliding windows for all the ids
+struct WindowAccumulator
+{
+    virtual ~WindowAccumulator() {}
+    virtual void resize( std::size_t size ) = 0;
+    virtual void clear() = 0;
+    /// add value to the window of id in given slot
+    virtual void push( std::size_t slot, const char* value ) = 0;
+    /// remove oldest value from the window of id in given slot
+    virtual void pop( std::size_t slot ) = 0;
+    virtual void calculate( std::size_t slot, char* buf ) const = 0;
+};
+
+template < typename Operation, typename T, comma::csv::format::types_enum F >
+class WindowAccumulatorOf : public WindowAccumulator
+{
+    public:
+        void resize( std::size_t size ) { values_.resize( size ); }
+        void clear() { values_.clear(); }
+        void push( std::size_t slot, const char* value ) { Operation::push( values_[slot], comma::csv::format::traits< T, F >::from_bin( value ) ); }
+        void pop( std::size_t slot ) { Operation::pop( values_[slot] ); }
+        void calculate( std::size_t slot, char* buf ) const { Operation::calculate( values_[slot], buf ); }
+    private:
+        std::vector< typename Operation::value > values_;
+};
+
+/// make window accumulator of operation E on values of type T; quantiles are not supported on windows
+template < Operations::Enum::Values E, typename T, comma::csv::format::types_enum F >
+struct WindowAccumulators { static WindowAccumulator* make( std::size_t, const Operations::Description& ) { return new WindowAccumulatorOf< typename Windows::traits< E >::template FromEnum< T, F >::Type, T, F >; } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct WindowAccumulators< Operations::Enum::median, T, F > { static WindowAccumulator* make( std::size_t, const Operations::Description& ) { return NULL; } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct WindowAccumulators< Operations::Enum::percentile, T, F > { static WindowAccumulator* make( std::size_t, const Operations::Description& ) { return NULL; } };
+
+template < typename T, comma::csv::format::types_enum F >
+struct WindowAccumulators< Operations::Enum::iqr, T, F > { static WindowAccumulator* make( std::size_t, const Operations::Description& ) { return NULL; } };
+
+/// operations on sliding windows of records by id: the last n records of an id and/or
+/// its records no older than a given duration than its latest record
+///
+/// each record is added to the window of its id once, and removed once,
+/// thus the statistics are updated in amortised constant time per record
+class Rolling
+{
+    public:
+        /// @param size window size in records, 0: unlimited
+        /// @param duration window duration, none: unlimited
+        Rolling( const std::vector< Operations::Description >& operations, const comma::csv::format& format, std::size_t size, const boost::optional< boost::posix_time::time_duration >& duration )
+            : size_( size )
+            , duration_( duration )
+            , output_formats_( operations.size() )
+            , output_elements_( operations.size() )
+            , buffers_( operations.size() )
+        {
+            for( std::size_t j = 0; j < format.count(); ++j ) { elements_.push_back( format.offset( j ) ); }
+            for( std::size_t i = 0; i < operations.size(); ++i )
             {
-                case Operations::Enum::min: sample.push_back( new Operation< Operations::Enum::min >( format ) ); break;
-                case Operations::Enum::max: sample.push_back( new Operation< Operations::Enum::max >( format ) ); break;
-                case Operations::Enum::centre: sample.push_back( new Operation< Operations::Enum::centre >( format ) ); break;
-                case Operations::Enum::mean: sample.push_back( new Operation< Operations::Enum::mean >( format ) ); break;
-                case Operations::Enum::radius: sample.push_back( new Operation< Operations::Enum::radius >( format ) ); break;
-                case Operations::Enum::diameter: sample.push_back( new Operation< Operations::Enum::diameter >( format ) ); break;
-                case Operations::Enum::variance: sample.push_back( new Operation< Operations::Enum::variance >( format ) ); break;
-                case Operations::Enum::stddev: sample.push_back( new Operation< Operations::Enum::stddev >( format ) ); break;
-                case Operations::Enum::sum: sample.push_back( new Operation< Operations::Enum::sum >( format ) ); break;
-                case Operations::Enum::size: sample.push_back( new Operation< Operations::Enum::size >( format ) ); break;
+                for( std::size_t j = 0; j < elements_.size(); ++j )
+                {
+                    WindowAccumulator* a = make_accumulator< WindowAccumulators, WindowAccumulator >( operations[i], elements_[j] );
+                    if( !a ) { COMMA_THROW( comma::exception, "operation " << i << " on " << j << "th element in " << format.string() << " not defined for sliding windows" ); }
+                    accumulators_.push_back( a );
+                    output_formats_[i] += comma::csv::format::to_format( Operations::output_type( operations[i].type, elements_[j].type ) );
+                }
+                for( std::size_t j = 0; j < elements_.size(); ++j ) { output_elements_[i].push_back( output_formats_[i].offset( j ) ); }
+                buffers_[i].resize( output_formats_[i].size() );
             }
         }
+
+        /// push record of an id with given timestamp, after removing the records that fall out of its window; return slot of the id
+        std::size_t push( comma::uint32 id, const char* record, const boost::posix_time::ptime& t )
+        {
+            std::size_t slot = ids_.insert( id );
+            if( slot == windows_.size() )
+            {
+                windows_.push_back( Windows::Ring< boost::posix_time::ptime >() );
+                for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].resize( windows_.size() ); }
+            }
+            Windows::Ring< boost::posix_time::ptime >& w = windows_[slot];
+            while( !w.empty() && ( ( size_ > 0 && w.size() >= size_ ) || ( duration_ && t - w.front() > *duration_ ) ) )
+            {
+                for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].pop( slot ); }
+                w.pop_front();
+            }
+            for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].push( slot, record + elements_[ i % elements_.size() ].offset ); }
+            w.push_back( t );
+            return slot;
+        }
+
+        /// return number of operations
+        std::size_t operations() const { return output_formats_.size(); }
+
+        /// return output format of an operation
+        const comma::csv::format& output_format( std::size_t operation ) const { return output_formats_[operation]; }
+
+        /// calculate operation on the window of id in a given slot, return output buffer
+        const char* calculate( std::size_t slot, std::size_t operation )
+        {
+            std::size_t n = elements_.size();
+            for( std::size_t j = 0; j < n; ++j ) { accumulators_[ operation * n + j ].calculate( slot, &buffers_[operation][0] + output_elements_[operation][j].offset ); }
+            return &buffers_[operation][0];
+        }
+
+        /// remove all ids and their windows, e.g. at the end of block
+        void clear()
+        {
+            ids_.clear();
+            windows_.clear();
+            for( std::size_t i = 0; i < accumulators_.size(); ++i ) { accumulators_[i].clear(); }
+        }
+
+    private:
+        std::size_t size_;
+        boost::optional< boost::posix_time::time_duration > duration_;
+        Ids ids_;
+        std::vector< Windows::Ring< boost::posix_time::ptime > > windows_; // timestamps of records in the window, by slot
+        std::vector< comma::csv::format::element > elements_;
+        std::vector< comma::csv::format > output_formats_;
+        std::vector< std::vector< comma::csv::format::element > > output_elements_;
+        std::vector< std::vector< char > > buffers_;
+        boost::ptr_vector< WindowAccumulator > accumulators_; // by operation, then by column
+};
+
+/// output input record followed by the results of operations on the window of its id
+static void calculate_and_output( const comma::csv::options& csv, Rolling& rolling, std::size_t slot, const char* record, const comma::csv::impl::ascii_field& line, bool flush )
+{
+    if( csv.binary() ) { std::cout.write( record, csv.format().size() ); }
+    else { std::cout.write( line.data, line.size ); }
+    for( std::size_t i = 0; i < rolling.operations(); ++i )
+    {
+        const char* buffer = rolling.calculate( slot, i );
+        if( csv.binary() ) { std::cout.write( buffer, rolling.output_format( i ).size() ); }
+        else { std::cout << csv.delimiter << rolling.output_format( i ).bin_to_csv( buffer, csv.delimiter, 12 ); }
     }
-    operations.clear();
-    for( std::size_t i = 0; i < sample.size(); ++i ) { operations.push_back( sample[i].clone() ); }
+    if( !csv.binary() ) { std::cout << '\n'; }
+    if( flush ) { std::cout.flush(); }
 }
 
-static void calculate_and_output( const comma::csv::options& csv, OperationsMap& operations, boost::optional< comma::uint32 > block, bool has_block, bool has_id )
+static void calculate_and_output( const comma::csv::options& csv, Aggregation& aggregator, boost::optional< comma::uint32 > block, bool has_block, bool has_id )
 {
-    for( OperationsMap::iterator it = operations.begin(); it != operations.end(); ++it )
+    for( std::size_t slot = 0; slot < aggregator.size(); ++slot )
     {
-        for( std::size_t i = 0; i < it->second->size(); ++i )
+        for( std::size_t i = 0; i < aggregator.operations(); ++i )
         {
-            ( *it->second )[i].calculate();
-            if( csv.binary() ) { std::cout.write( ( *it->second )[i].buffer(), ( *it->second )[i].output_format().size() ); }
-            else { if( i > 0 ) { std::cout << csv.delimiter; } std::cout << ( *it->second )[i].output_format().bin_to_csv( ( *it->second )[i].buffer(), csv.delimiter, 12 ); }
+            const char* buffer = aggregator.calculate( slot, i );
+            if( csv.binary() ) { std::cout.write( buffer, aggregator.output_format( i ).size() ); }
+            else { if( i > 0 ) { std::cout << csv.delimiter; } std::cout << aggregator.output_format( i ).bin_to_csv( buffer, csv.delimiter, 12 ); }
         }
+        comma::uint32 id = aggregator.id( slot );
         if( csv.binary() )
         {
-            if( has_id )  { std::cout.write( reinterpret_cast< const char* >( &it->first ), sizeof( comma::uint32 ) ); } // quick and dirty
+            if( has_id )  { std::cout.write( reinterpret_cast< const char* >( &id ), sizeof( comma::uint32 ) ); } // quick and dirty
             if( has_block ) { std::cout.write( reinterpret_cast< const char* >( &( *block ) ), sizeof( comma::uint32 ) ); } // quick and dirty        
             std::cout.flush();
         }
         else
         {
-            if( has_id ) { std::cout << csv.delimiter << it->first; }
+            if( has_id ) { std::cout << csv.delimiter << id; }
             if( has_block ) { std::cout << csv.delimiter << *block; }
             std::cout << std::endl;
         }
     }
-    for( OperationsMap::iterator it = operations.begin(); it != operations.end(); ++it ) { delete it->second; } // quick and dirty
-    operations.clear();
+    aggregator.clear();
 }
 
 int main( int ac, char** av )
@@ -664,45 +1594,72 @@ int main( int ac, char** av )
     {
         comma::command_line_options options( ac, av );
         if( options.exists( "--help,-h" ) ) { usage(); }
-        std::vector< std::string > unnamed = options.unnamed( "", "--binary,-b,--delimiter,-d,--format,--fields,-f" );
+        std::ios_base::sync_with_stdio( false ); // otherwise std::cin is unbuffered and the lines get read one character at a time
+        std::vector< std::string > unnamed = options.unnamed( "--flush", "--binary,-b,--delimiter,-d,--format,--fields,-f,--threads,--compression,--window-size,--window-time" );
         comma::csv::options csv( options );
         #ifdef WIN32
         if( csv.binary() ) { _setmode( _fileno( stdin ), _O_BINARY ); _setmode( _fileno( stdout ), _O_BINARY ); }
         #endif
         if( unnamed.empty() ) { std::cerr << "csv-calc: please specify operations" << std::endl; exit( 1 ); }
         std::vector< std::string > v = comma::split( unnamed[0], ',' );
-        std::vector< Operations::Enum::Values > operation_ids( v.size() );
-        for( std::size_t i = 0; i < v.size(); ++i ) { operation_ids[i] = Operations::from_name( v[i] ); }
+        std::size_t compression = options.value( "--compression", 100u );
+        std::vector< Operations::Description > operation_ids( v.size() );
+        for( std::size_t i = 0; i < v.size(); ++i ) { operation_ids[i] = Operations::from_string( v[i], compression ); }
+        unsigned int threads = options.value( "--threads", 0u );
+        std::size_t window_size = options.value( "--window-size", 0u );
+        if( options.exists( "--window-size" ) && window_size == 0 ) { std::cerr << "csv-calc: expected positive --window-size" << std::endl; return 1; }
+        boost::optional< boost::posix_time::time_duration > window_time;
+        if( options.exists( "--window-time" ) )
+        {
+            double seconds = options.value< double >( "--window-time" );
+            if( seconds < 0 ) { std::cerr << "csv-calc: expected non-negative --window-time, got " << seconds << std::endl; return 1; }
+            window_time = boost::posix_time::microseconds( static_cast< comma::int64 >( seconds * 1e6 ) );
+        }
+        bool window = window_size > 0 || window_time;
+        bool flush = options.exists( "--flush" );
+        for( std::size_t i = 0; window && i < operation_ids.size(); ++i )
+        {
+            switch( operation_ids[i].type )
+            {
+                case Operations::Enum::median: case Operations::Enum::percentile: case Operations::Enum::iqr:
+                    std::cerr << "csv-calc: " << v[i] << " not supported with --window-size or --window-time" << std::endl; return 1;
+                default: break;
+            }
+        }
         boost::optional< comma::csv::format > format;
         if( csv.binary() ) { format = csv.format(); }
         else if( options.exists( "--format" ) ) { format = comma::csv::format( options.value< std::string >( "--format" ) ); }
         boost::scoped_ptr< asciiInput > ascii;
         boost::scoped_ptr< binaryInput > binary;
-        if( csv.binary() ) { binary.reset( new binaryInput( csv ) ); }
-        else { ascii.reset( new asciiInput( csv, format ) ); }
-        OperationsMap operations;
+        if( csv.binary() ) { binary.reset( new binaryInput( csv, bool( window_time ) ) ); }
+        else { ascii.reset( new asciiInput( csv, format, threads, bool( window_time ) ) ); }
+        boost::scoped_ptr< Aggregation > aggregator;
+        boost::scoped_ptr< Rolling > rolling;
         boost::optional< comma::uint32 > block;
         bool has_block = csv.has_field( "block" );
         bool has_id = csv.has_field( "id" );
         comma::signal_flag is_shutdown;
-        while( !is_shutdown && std::cin.good() && !std::cin.eof() )
+        while( !is_shutdown ) // parsing threads may read ahead to the end of stdin, thus do not check std::cin state
         { 
             const Values* v = csv.binary() ? binary->read() : ascii->read();
             if( v == NULL ) { break; }
             if( has_block )
             {
-                if( block && *block != v->block() ) { calculate_and_output( csv, operations, block, has_block, has_id ); }
+                if( block && *block != v->block() ) { if( rolling ) { rolling->clear(); std::cout.flush(); } else { calculate_and_output( csv, *aggregator, block, has_block, has_id ); } }
                 block = v->block();
             }
-            OperationsMap::iterator it = operations.find( v->id() );
-            if( it == operations.end() )
+            if( window )
             {
-                it = operations.insert( std::make_pair( v->id(), new boost::ptr_vector< Operationbase > ) ).first;
-                init_operations( *it->second, operation_ids, v->format() );
+                if( !rolling ) { rolling.reset( new Rolling( operation_ids, v->format(), window_size, window_time ) ); }
+                std::size_t slot = rolling->push( v->id(), v->buffer(), v->time() );
+                calculate_and_output( csv, *rolling, slot, csv.binary() ? binary->record() : NULL, csv.binary() ? comma::csv::impl::ascii_field() : ascii->line(), flush );
+                continue;
             }
-            for( std::size_t i = 0; i < it->second->size(); ++i ) { ( *it->second )[i].push( v->buffer() ); }
+            if( !aggregator ) { aggregator.reset( new Aggregation( operation_ids, v->format(), threads, has_id ) ); }
+            aggregator->push( v->id(), v->buffer() );
         }
-        calculate_and_output( csv, operations, block, has_block, has_id );
+        if( aggregator ) { calculate_and_output( csv, *aggregator, block, has_block, has_id ); }
+        std::cout.flush();
         return 0;
     }
     catch( std::exception& ex ) { std::cerr << "csv-calc: " << ex.what() << std::endl; }
@@ -28,6 +28,7 @@
 #include <comma/application/signal_flag.h>
 #include <comma/base/exception.h>
 #include <comma/csv/format.h>
+#include <comma/csv/options.h>
 #include <comma/string/string.h>
 
 using namespace comma;
@@ -38,6 +39,7 @@ static void usage()
     std::cerr << "Usage: cat blah.bin | csv-from-bin <format> --precision <precision> > blah.csv" << std::endl;
     std::cerr << std::endl;
     std::cerr << "--precision: set precision (number of mantissa digits) for floating point types" << std::endl;
+    std::cerr << "             default: 6 for float, 16 for double; shortest: shortest exact representation" << std::endl;
     std::cerr << csv::format::usage() << std::endl;
     std::cerr << std::endl;
     exit( -1 );
@@ -55,17 +57,20 @@ int main( int ac, char** av )
         if( ac < 2 || options.exists( "--help" ) || options.exists( "-h" ) ) { usage(); }
         char delimiter = options.value( "--delimiter", ',' );
         boost::optional< unsigned int > precision;
-        if( options.exists( "--precision" ) ) { precision = options.value< unsigned int >( "--precision" ); }
+        if( options.exists( "--precision" ) ) { precision = comma::csv::impl::precision( options.value< std::string >( "--precision" ) ); }
         comma::csv::format format( av[1] );
         std::vector< char > w( format.size() ); //char buf[ format.size() ]; // stupid windows
         char* buf = &w[0];
+        std::string line;
         while( std::cin.good() && !std::cin.eof() )
         {
             if( shutdownFlag ) { std::cerr << "csv-from-bin: interrupted by signal" << std::endl; return -1; }
             std::cin.read( buf, format.size() );
             if( std::cin.gcount() == 0 ) { break; }
             if( std::cin.gcount() < static_cast< int >( format.size() ) ) { COMMA_THROW( comma::exception, "expected " << format.size() << " bytes, got only " << std::cin.gcount() ); }
-            std::cout << format.bin_to_csv( buf, delimiter, precision ) << std::endl;
+            format.bin_to_csv( buf, line, delimiter, precision );
+            std::cout.write( line.c_str(), line.size() );
+            std::cout << std::endl;
         }
         return 0;
     }
@@ -0,0 +1,105 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <iostream>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <comma/application/command_line_options.h>
+#include <comma/base/exception.h>
+#include <comma/csv/index.h>
+#include <comma/csv/options.h>
+#include <comma/io/stream.h>
+#include <comma/string/string.h>
+
+static void usage()
+{
+    std::cerr << std::endl;
+    std::cerr << "build a sparse index of a binary csv file by time or an integer key (e.g. block)," << std::endl;
+    std::cerr << "to seek to a given time or block without reading the file from the beginning" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "the index is saved in a sidecar file <file>.<key field>.index, e.g. points.bin.t.index," << std::endl;
+    std::cerr << "where csv-play (--from) and csv-join (block-wise) pick it up" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "each index entry is offset of a record and the greatest key of the records before it" << std::endl;
+    std::cerr << "as binary l,ul; the file does not have to be strictly sorted by the key" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "usage: csv-index <file> --binary=<format> --fields=<fields> [<options>]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "<fields>: exactly one key field, time or integer, e.g. --fields=t or --fields=,,block" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "options" << std::endl;
+    std::cerr << "    --output,-o=<filename>: output index to a given file, '-' for stdout; default: sidecar file" << std::endl;
+    std::cerr << "    --step=<n>: add an entry every n records; default: 1024" << std::endl;
+    std::cerr << "                for integer keys, an entry is also added wherever the key changes" << std::endl;
+    std::cerr << "    --seek=<key>: do not build index, read it from the sidecar file and output" << std::endl;
+    std::cerr << "                  offset before which all the records have keys less than <key>" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "examples" << std::endl;
+    std::cerr << "    csv-index points.bin --binary=t,3d --fields=t" << std::endl;
+    std::cerr << "    csv-play \"points.bin;binary=t,3d\" --from 20140101T030000" << std::endl;
+    std::cerr << "    tail -c +$(( $( csv-index points.bin --binary=t,3d --fields=t --seek=20140101T030000 ) + 1 )) points.bin | ..." << std::endl;
+    std::cerr << std::endl;
+    exit( -1 );
+}
+
+int main( int ac, char** av )
+{
+    try
+    {
+        comma::command_line_options options( ac, av );
+        if( options.exists( "--help,-h" ) ) { usage(); }
+        std::vector< std::string > unnamed = options.unnamed( "", "--binary,-b,--fields,-f,--output,-o,--step,--seek" );
+        if( unnamed.size() != 1 ) { std::cerr << "csv-index: expected one file, got " << unnamed.size() << std::endl; return 1; }
+        comma::csv::options csv( options );
+        if( !csv.binary() ) { std::cerr << "csv-index: please specify --binary" << std::endl; return 1; }
+        std::vector< std::string > fields = comma::split( csv.fields, ',' );
+        std::size_t field = fields.size();
+        for( std::size_t i = 0; i < fields.size(); ++i )
+        {
+            if( fields[i].empty() ) { continue; }
+            if( field < fields.size() ) { std::cerr << "csv-index: expected one key field, got " << csv.fields << std::endl; return 1; }
+            field = i;
+        }
+        if( field == fields.size() ) { std::cerr << "csv-index: please specify key field, e.g. --fields=t" << std::endl; return 1; }
+        if( field >= csv.format().count() ) { std::cerr << "csv-index: expected key field within format " << csv.format().string() << ", got " << csv.fields << std::endl; return 1; }
+        std::string output = options.value< std::string >( "--output,-o", unnamed[0] == "-" ? "-" : comma::csv::index::sidecar( unnamed[0], fields[field] ) );
+        if( options.exists( "--seek" ) )
+        {
+            std::ifstream ifs( output.c_str(), std::ios::binary );
+            if( !ifs.is_open() ) { std::cerr << "csv-index: failed to open " << output << std::endl; return 1; }
+            comma::csv::index index( ifs );
+            comma::csv::format::element e = csv.format().offset( field );
+            std::string key = options.value< std::string >( "--seek" );
+            bool time = e.type == comma::csv::format::time || e.type == comma::csv::format::long_time;
+            std::cout << ( time ? index.seek( boost::posix_time::from_iso_string( key ) ) : index.seek( boost::lexical_cast< comma::int64 >( key ) ) ) << std::endl;
+            return 0;
+        }
+        comma::io::istream is( unnamed[0], comma::io::mode::binary );
+        if( !is() ) { std::cerr << "csv-index: failed to open " << unnamed[0] << std::endl; return 1; }
+        comma::csv::index index( *is, csv.format(), field, options.value< std::size_t >( "--step", 1024 ) );
+        if( output == "-" ) { index.write( std::cout ); return 0; }
+        std::ofstream ofs( output.c_str(), std::ios::binary );
+        if( !ofs.is_open() ) { std::cerr << "csv-index: failed to open " << output << std::endl; return 1; }
+        index.write( ofs );
+        return 0;
+    }
+    catch( std::exception& ex ) { std::cerr << "csv-index: " << ex.what() << std::endl; }
+    catch( ... ) { std::cerr << "csv-index: unknown exception" << std::endl; }
+    return 1;
+}
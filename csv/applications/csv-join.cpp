@@ -17,6 +17,7 @@
 // License along with comma. If not, see <http://www.gnu.org/licenses/>.
 
 #include <string.h>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -29,6 +30,7 @@
 #include <comma/application/command_line_options.h>
 #include <comma/application/signal_flag.h>
 #include <comma/base/types.h>
+#include <comma/csv/index.h>
 #include <comma/csv/stream.h>
 #include <comma/io/stream.h>
 #include <comma/name_value/parser.h>
@@ -46,9 +48,14 @@ static void usage( bool long_help = false )
     std::cerr << "        block: block number" << std::endl;
     std::cerr << "        any other field names: keys" << std::endl;
     std::cerr << std::endl;
+    std::cerr << "    if the second source is a binary file with a block index built by csv-index" << std::endl;
+    std::cerr << "    (e.g. csv-index something_else.bin --binary=... --fields=,,block), seek to blocks" << std::endl;
+    std::cerr << "    present on stdin, skipping blocks in between instead of reading them" << std::endl;
+    std::cerr << std::endl;
     std::cerr << "options:" << std::endl;
     //std::cerr << "    --long-help: more help" << std::endl;
     std::cerr << "    --first-matching: output only the first matching record (a bit of hack for now, but we needed it)" << std::endl;
+    std::cerr << "    --threads=<n>: ascii only: parse stdin in n threads, preserving the order of lines; default: parse in the main thread" << std::endl;
     std::cerr << "    --verbose,-v: more output to stderr" << std::endl;
     std::cerr << comma::csv::options::usage() << std::endl;
     std::cerr << std::endl;
@@ -108,6 +115,7 @@ static comma::signal_flag is_shutdown;
 static boost::scoped_ptr< comma::io::istream > filter_transport;
 static boost::scoped_ptr< comma::csv::input_stream< input > > stdin_stream;
 static boost::scoped_ptr< comma::csv::input_stream< input > > filter_stream;
+static boost::scoped_ptr< comma::csv::index > filter_index;
 static comma::csv::options stdin_csv;
 static comma::csv::options filter_csv;
 static bool first_matching;
@@ -126,12 +134,25 @@ struct input::Hash : public std::unary_function< input, std::size_t >
 typedef boost::unordered_map< input, std::vector< std::string >, input::Hash > FilterMap;
 FilterMap filter_map;
 static comma::uint32 block;
+static const input* last;
+
+static void seek_filter_block_( comma::uint32 b )
+{
+    if( !filter_index || !last || last->block >= b ) { return; }
+    comma::uint64 offset = filter_index->seek( comma::int64( b ) );
+    ( *filter_transport )->clear();
+    ( *filter_transport )->seekg( offset );
+    if( !( *filter_transport )->good() ) { COMMA_THROW( comma::exception, "failed to seek to offset " << offset << " in " << filter_csv.filename ); }
+    filter_stream.reset( new comma::csv::input_stream< input >( **filter_transport, filter_csv ) );
+    last = filter_stream->read();
+    if( verbose ) { std::cerr << "csv-join: skipped to block " << b << " at offset " << offset << std::endl; }
+}
 
 void read_filter_block_()
 {
-    static const input* last = filter_stream->read();
-    block = last->block;
     filter_map.clear();
+    if( !last ) { return; }
+    block = last->block;
     comma::uint64 count = 0;
     while( last->block == block && !is_shutdown && ( *filter_transport )->good() && !( *filter_transport )->eof() )
     {
@@ -144,7 +165,7 @@ void read_filter_block_()
         }
         else
         {
-            filter_map[ *last ].push_back( comma::join( filter_stream->ascii().last(), stdin_csv.delimiter ) );
+            filter_map[ *last ].push_back( filter_stream->ascii().last_line().to_string() );
         }
         
         if( verbose ) { ++count; if( count % 10000 == 0 ) { std::cerr << "csv-join: reading block " << block << "; loaded " << count << " point[s]; hash map size: " << filter_map.size() << std::endl; } }
@@ -163,7 +184,7 @@ int main( int ac, char** av )
         verbose = options.exists( "--verbose,-v" );
         first_matching = options.exists( "--first-matching" );
         stdin_csv = comma::csv::options( options );
-        std::vector< std::string > unnamed = options.unnamed( "--verbose,-v,--first-matching", "--binary,-b,--delimiter,-d,--fields,-f" );
+        std::vector< std::string > unnamed = options.unnamed( "--verbose,-v,--first-matching", "--binary,-b,--delimiter,-d,--fields,-f,--threads" );
         if( unnamed.empty() ) { std::cerr << "csv-join: please specify the second source" << std::endl; return 1; }
         if( unnamed.size() > 1 ) { std::cerr << "csv-join: expected one file or stream to join, got " << comma::join( unnamed, ' ' ) << std::endl; return 1; }
         comma::name_value::parser parser( "filename", ';', '=', false );
@@ -186,15 +207,28 @@ int main( int ac, char** av )
         stdin_csv.fields = comma::join( v, ',' );
         filter_csv.fields = comma::join( w, ',' );
         stdin_stream.reset( new comma::csv::input_stream< input >( std::cin, stdin_csv ) );
+        if( !stdin_csv.binary() && options.exists( "--threads" ) )
+        {
+            std::ios_base::sync_with_stdio( false ); // otherwise std::cin is unbuffered and the lines get read one character at a time
+            stdin_stream->ascii().threads( options.value< unsigned int >( "--threads" ) );
+        }
         filter_transport.reset( new comma::io::istream( filter_csv.filename, filter_csv.binary() ? comma::io::mode::binary : comma::io::mode::ascii ) );
+        filter_transport->map(); // regular files only; seeking to blocks works on the mapping
         filter_stream.reset( new comma::csv::input_stream< input >( **filter_transport, filter_csv ) );
+        if( filter_csv.binary() )
+        {
+            std::ifstream ifs( comma::csv::index::sidecar( filter_csv.filename, "block" ).c_str(), std::ios::binary );
+            if( ifs.is_open() ) { filter_index.reset( new comma::csv::index( ifs ) ); }
+        }
         std::size_t discarded = 0;
+        std::string line;
+        last = filter_stream->read();
         read_filter_block_();
-        while( !is_shutdown && std::cin.good() && !std::cin.eof() )
+        while( !is_shutdown ) // parsing threads may read ahead to the end of stdin, thus do not check std::cin state
         {
             const input* p = stdin_stream->read();
             if( !p ) { break; }
-            if( block != p->block ) { read_filter_block_(); }
+            if( block != p->block ) { seek_filter_block_( p->block ); read_filter_block_(); }
             if( filter_map.empty() ) { break; }
             FilterMap::const_iterator it = filter_map.find( *p );
             if( it == filter_map.end() || it->second.empty() ) { ++discarded; continue; }
@@ -210,9 +244,10 @@ int main( int ac, char** av )
             }
             else
             {
+                line.assign( stdin_stream->ascii().last_line().data, stdin_stream->ascii().last_line().size ) += stdin_csv.delimiter;
                 for( std::size_t i = 0; i < ( first_matching ? 1 : it->second.size() ); ++i )
                 {
-                    std::cout << comma::join( stdin_stream->ascii().last(), stdin_csv.delimiter ) << stdin_csv.delimiter << it->second[i] << std::endl;
+                    std::cout << line << it->second[i] << std::endl;
                 }
             }
             if( first_matching ) { filter_map.erase( it->first ); } // quick and dirty for now
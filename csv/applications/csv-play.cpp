@@ -21,16 +21,25 @@
 #include <fcntl.h>
 #include <io.h>
 #endif
+#ifndef WIN32
+#include <signal.h>
+#endif
 #include <iostream>
 
 #include <comma/application/command_line_options.h>
 #include <comma/application/signal_flag.h>
+#include <comma/csv/impl/iso_time.h>
 #include <comma/csv/options.h>
 #include <comma/csv/stream.h>
 #include <comma/name_value/parser.h>
 #include <comma/csv/applications/play/play.h>
 #include <comma/csv/applications/play/multiplay.h>
 
+#ifndef WIN32
+static volatile sig_atomic_t report_requested = 0;
+static void request_report( int ) { report_requested = 1; }
+#endif
+
 static void usage()
 {
     std::cerr << std::endl;
@@ -53,9 +62,22 @@ static void usage()
     std::cerr << "               csv-play file1;pipe;clients=1 file2;tcp:1234;clients=3" << std::endl;
     std::cerr << "    --no-flush : if present, do not flush the output stream ( use on high bandwidth sources )" << std::endl;
     std::cerr << "    --from <timestamp> : play back data starting at <timestamp> ( iso format )" << std::endl;
+    std::cerr << "                         if a binary file has an index built by csv-index (e.g. file.bin.t.index)," << std::endl;
+    std::cerr << "                         seek to <timestamp> using the index instead of reading from the beginning" << std::endl;
     std::cerr << "    --to <timestamp> : play back data up to <timestamp> ( iso format )" << std::endl;
+    std::cerr << "    --precise : sleep till absolute deadlines on monotonic clock and spin for the last 100 microseconds," << std::endl;
+    std::cerr << "                rather than sleeping for relative durations, e.g. for high-rate data" << std::endl;
+    std::cerr << "                --precision is then only used as the lag tolerance for warnings and statistics" << std::endl;
+    std::cerr << "    --no-wait : do not wait, output records merged by timestamp as fast as possible, e.g. for batch processing" << std::endl;
+    std::cerr << "    --statistics : output lateness statistics to stderr on exit" << std::endl;
+    std::cerr << "    --sorted : inputs are sorted by timestamp: stop reading an input once past --to;" << std::endl;
+    std::cerr << "               binary files without index are searched for --from by bisection" << std::endl;
     std::cerr << comma::csv::format::usage();
     std::cerr << std::endl;
+    std::cerr << "lateness statistics (number of records played later than --precision, max and mean lag)" << std::endl;
+    std::cerr << "    are output to stderr on exit, if --statistics, and on SIGUSR1, e.g. pkill -USR1 csv-play" << std::endl;
+    std::cerr << "    SIGUSR1 is answered after the next record is played, i.e. not while waiting for it" << std::endl;
+    std::cerr << std::endl;
     std::cerr << "output" << std::endl;
     std::cerr << "    -: write to stdout (default)" << std::endl;
     std::cerr << "    offset=<offset>: add <offset> seconds to the timestamp of this source" << std::endl;
@@ -97,7 +119,11 @@ int main( int argc, char** argv )
         std::string to = options.value< std::string>( "--to", "" );
         bool quiet =  options.exists( "--quiet" );
         bool flush =  !options.exists( "--no-flush" );
-        std::vector< std::string > configstrings = options.unnamed("--quiet,--no-flush","--slow,--slowdown,--speed,--precision,--binary,--fields,--clients,--from,--to");
+        bool sorted = options.exists( "--sorted" );
+        bool wait = !options.exists( "--no-wait" );
+        bool precise = options.exists( "--precise" );
+        bool statistics = options.exists( "--statistics" );
+        std::vector< std::string > configstrings = options.unnamed("--quiet,--no-flush,--sorted,--no-wait,--precise,--statistics","--slow,--slowdown,--speed,--precision,--binary,--fields,--clients,--from,--to");
         if( configstrings.empty() ) { configstrings.push_back( "-;-" ); }
         comma::csv::options csvoptions( argc, argv );
         comma::name_value::parser nameValue("filename,output", ';', '=', false );
@@ -110,19 +136,29 @@ int main( int argc, char** argv )
         boost::posix_time::ptime fromtime;
         if( !from.empty() )
         {
-            fromtime = boost::posix_time::from_iso_string( from );
+            fromtime = comma::csv::impl::from_iso_string( from );
         }
         boost::posix_time::ptime totime;
         if( !to.empty() )
         {
-            totime = boost::posix_time::from_iso_string( to );
+            totime = comma::csv::impl::from_iso_string( to );
         }
-        multiPlay.reset( new comma::Multiplay( sourceConfigs, 1.0 / speed, quiet, boost::posix_time::milliseconds(precision), fromtime, totime, flush ) );
+        #ifndef WIN32 // install before the reader threads start, since by default SIGUSR1 terminates the process
+        struct sigaction sa;
+        sa.sa_handler = request_report;
+        sigemptyset( &sa.sa_mask );
+        sa.sa_flags = SA_RESTART;
+        ::sigaction( SIGUSR1, &sa, NULL );
+        #endif
+        multiPlay.reset( new comma::Multiplay( sourceConfigs, 1.0 / speed, quiet, boost::posix_time::milliseconds(precision), fromtime, totime, flush, sorted, wait, precise ) );
         while( multiPlay->read() && !shutdownFlag && std::cout.good() && !std::cout.bad() &&!std::cout.eof() )
         {
-            
+            #ifndef WIN32
+            if( report_requested ) { report_requested = 0; multiPlay->report( std::cerr ); } // checked between records only
+            #endif
         }
         multiPlay->close();
+        if( statistics ) { multiPlay->report( std::cerr ); }
         if( shutdownFlag ) { std::cerr << "csv-play: interrupted by signal" << std::endl; return -1; }
         return 0;
     }
@@ -82,7 +82,7 @@ int main( int ac, char** av )
             Point q = *p;
             q.timestamp = p->timestamp + delay;
             if( csv.binary() ) { ostream.write( q, istream.binary().last() ); }
-            else { ostream.write( q, istream.ascii().last() ); }
+            else { ostream.ascii().write( q, istream.ascii().last_fields() ); }
         }
         if( is_shutdown ) { std::cerr << "csv-time-delay: interrupted by signal" << std::endl; }
         return 0;     
@@ -22,6 +22,7 @@
 #include <comma/application/command_line_options.h>
 #include <comma/application/signal_flag.h>
 #include <comma/base/types.h>
+#include <comma/csv/impl/iso_time.h>
 #include <comma/csv/stream.h>
 #include <comma/io/stream.h>
 #include <comma/name_value/parser.h>
@@ -127,14 +128,14 @@ int main( int ac, char** av )
             while( last_timestamp.first.is_not_a_date_time() || p->timestamp >= last_timestamp.second )
             {
                 last_timestamp.first = last_timestamp.second;
-                last.first = last.second;
+                last.first.swap( last.second ); // last.second gets overwritten below, reusing its buffer
                 const Point* q = istream.read();
                 if( !q ) { eof = true; break; }
                 last_timestamp.second = q->timestamp;
                 if( !timestamp_only )
                 {
-                    if( csv.binary() ) { last.second = std::string( istream.binary().last(), csv.format().size() ); }
-                    else { last.second = comma::join( istream.ascii().last(), stdin_csv.delimiter ); }
+                    if( csv.binary() ) { last.second.assign( istream.binary().last(), csv.format().size() ); }
+                    else { last.second.assign( istream.ascii().last_line().data, istream.ascii().last_line().size ); }
                 }
             }
             if( eof ) { break; }
@@ -161,9 +162,9 @@ int main( int ac, char** av )
             }
             else
             {
-                std::cout << comma::join( stdin_stream.ascii().last(), stdin_csv.delimiter );
+                std::cout << stdin_stream.ascii().last_line();
                 std::cout << stdin_csv.delimiter;
-                if( timestamp_only ) { std::cout << boost::posix_time::to_iso_string( t ) << std::endl; }
+                if( timestamp_only ) { std::cout << comma::csv::impl::to_iso_string( t ) << std::endl; }
                 else { std::cout << s << std::endl; }
             }
         }
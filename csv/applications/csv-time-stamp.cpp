@@ -29,6 +29,7 @@
 #include <comma/application/signal_flag.h>
 #include <comma/base/types.h>
 #include <comma/csv/format.h>
+#include <comma/csv/impl/iso_time.h>
 
 static void usage()
 {
@@ -103,7 +104,9 @@ int main( int ac, char** av )
                 std::getline( std::cin, line );
                 if( line.empty() ) { continue; }
                 boost::posix_time::ptime now = local ? boost::posix_time::microsec_clock::local_time() : boost::posix_time::microsec_clock::universal_time();
-                std::cout << boost::posix_time::to_iso_string( now ) << delimiter << line << std::endl;
+                char buf[ comma::csv::impl::iso_time_size ];
+                std::cout.write( buf, comma::csv::impl::to_iso_string( buf, now ) - buf );
+                std::cout << delimiter << line << std::endl;
             }
         }
         if( is_shutdown ) { std::cerr << "csv-time-stamp: interrupted by signal" << std::endl; }
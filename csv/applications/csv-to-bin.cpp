@@ -24,17 +24,27 @@
 
 #include <stdlib.h>
 #include <iostream>
+#include <vector>
+#include <boost/bind.hpp>
 #include <comma/application/command_line_options.h>
 #include <comma/application/signal_flag.h>
 #include <comma/csv/format.h>
+#include <comma/csv/impl/ascii_parallel_reader.h>
+#include <comma/string/split.h>
 #include <comma/string/string.h>
 
 using namespace comma;
 
+static void parse( const comma::csv::format* format, std::vector< char >& buf, const std::vector< comma::csv::impl::ascii_field >& fields ) { format->csv_to_bin( &buf[0], fields ); }
+
 static void usage()
 {
     std::cerr << std::endl;
-    std::cerr << "Usage: cat blah.csv | csv-to-bin <format> [--delimiter=<delimiter>] > blah.bin" << std::endl;
+    std::cerr << "Usage: cat blah.csv | csv-to-bin <format> [--delimiter=<delimiter>] [--threads=<n>] > blah.bin" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "options" << std::endl;
+    std::cerr << "    --delimiter=<delimiter>: default: ','" << std::endl;
+    std::cerr << "    --threads=<n>: parse lines in n threads, preserving their order; default: parse in the main thread" << std::endl;
     std::cerr << std::endl;
     std::cerr << csv::format::usage() << std::endl;
     std::cerr << std::endl;
@@ -53,14 +63,32 @@ int main( int ac, char** av )
         if( ac < 2 || options.exists( "--help" ) || options.exists( "-h" ) ) { usage(); }
         char delimiter = options.value( "--delimiter", ',' );
         comma::csv::format format( av[1] );
+        unsigned int threads = options.value( "--threads", 0u );
+        if( threads > 0 )
+        {
+            std::ios_base::sync_with_stdio( false ); // otherwise std::cin is unbuffered and the lines get read one character at a time
+            comma::csv::impl::ascii_parallel_reader< std::vector< char > > reader( delimiter, threads, boost::bind( &parse, &format, _1, _2 ), std::vector< char >( format.size() ) );
+            while( true )
+            {
+                if( shutdownFlag ) { std::cerr << "csv-to-bin: interrupted by signal" << std::endl; return -1; }
+                const std::vector< char >* buf = reader.read( std::cin );
+                if( !buf ) { break; }
+                std::cout.write( &( *buf )[0], buf->size() );
+                if( !reader.ready() ) { std::cout.flush(); }
+            }
+            return 0;
+        }
+        std::string line;
+        std::vector< comma::csv::impl::ascii_field > fields;
+        std::vector< char > buf( format.size() );
         while( std::cin.good() && !std::cin.eof() )
         {
             if( shutdownFlag ) { std::cerr << "csv-to-bin: interrupted by signal" << std::endl; return -1; }
-            std::string line;
             std::getline( std::cin, line );
-            if( !line.empty() && *line.rbegin() == '\r' ) { line = line.substr( 0, line.length() - 1 ); } // windows... sigh...
+            if( !line.empty() && *line.rbegin() == '\r' ) { line.resize( line.length() - 1 ); } // windows... sigh...
             if( line.length() == 0 ) { continue; }
-            format.csv_to_bin( std::cout, line, delimiter );
+            comma::split( line, delimiter, fields );
+            std::cout.write( format.csv_to_bin( &buf[0], fields ), format.size() );
         }
         return 0;
     }
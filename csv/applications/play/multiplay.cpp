@@ -16,13 +16,212 @@
 // You should have received a copy of the GNU Lesser General Public
 // License along with comma. If not, see <http://www.gnu.org/licenses/>.
 
+#include <fstream>
 #include <sstream>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <comma/csv/index.h>
 #include <comma/string/string.h>
 #include "./multiplay.h"
 
 namespace comma {
 
+namespace impl {
+    
+static std::string endl()
+{
+    std::ostringstream oss;
+    oss << std::endl;
+    return oss.str();
+}
+
+} // namespace impl {
+
+/// reads records of a source in time range in its own thread, thus a slow source
+/// or parsing a fat one does not hold back the other sources, and queues them in
+/// a bounded ring ready to publish, i.e. with timestamp offset applied and
+/// ascii line terminators appended
+///
+/// single producer, single consumer: the reading thread fills the entries at the
+/// tail, the playing thread publishes and pops the entry at the head; the lock
+/// guards only the ring indices, the entries are filled and published outside of it
+class Multiplay::reader : public boost::noncopyable
+{
+    public:
+        struct entry
+        {
+            boost::posix_time::ptime timestamp;
+            std::string data;
+        };
+
+        reader( const SourceConfig& config, boost::posix_time::ptime from, boost::posix_time::ptime to, bool sorted, std::size_t capacity = 1024 );
+
+        /// start reading thread
+        static void start( const boost::shared_ptr< reader >& r ) { r->thread_ = boost::thread( boost::bind( &reader::run_, r ) ); }
+
+        /// stop reading thread; if it is blocked on reading the source, detach it
+        void stop();
+
+        /// return oldest queued entry, block till there is one; return NULL, if source is exhausted
+        const entry* front();
+
+        /// remove oldest queued entry
+        void pop();
+
+    private:
+        SourceConfig config_;
+        boost::posix_time::ptime from_;
+        boost::posix_time::ptime to_;
+        bool sorted_;
+        std::string endl_;
+        boost::scoped_ptr< io::istream > istream_;
+        boost::scoped_ptr< csv::input_stream< time > > input_stream_;
+        boost::scoped_ptr< csv::ascii< time > > ascii_;
+        boost::scoped_ptr< csv::binary< time > > binary_;
+        std::vector< entry > entries_;
+        std::size_t head_;
+        std::size_t size_;
+        bool done_;
+        bool shutdown_;
+        std::string error_;
+        boost::mutex mutex_;
+        boost::condition_variable filled_;
+        boost::condition_variable freed_;
+        boost::thread thread_;
+        void run_();
+        bool read_( entry& e );
+};
+
+Multiplay::reader::reader( const SourceConfig& config, boost::posix_time::ptime from, boost::posix_time::ptime to, bool sorted, std::size_t capacity )
+    : config_( config )
+    , from_( from )
+    , to_( to )
+    , sorted_( sorted )
+    , endl_( impl::endl() ) // quick and dirty, since publisher is not std::stream
+    , entries_( capacity )
+    , head_( 0 )
+    , size_( 0 )
+    , done_( false )
+    , shutdown_( false )
+{
+    // todo: quick and dirty for now: blocking streams for named pipes
+    istream_.reset( new io::istream( config_.options.filename, config_.options.binary() ? io::mode::binary : io::mode::ascii, io::mode::blocking ) );
+    if( !( *istream_ )() ) { COMMA_THROW( comma::exception, "named pipe " << config_.options.filename << " is closed (todo: support closed named pipes)" ); }
+    istream_->map(); // recorded logs only, named pipes are read as before
+    if( config_.options.binary() && !from_.is_not_a_date_time() )
+    {
+        std::ifstream ifs( csv::index::sidecar( config_.options.filename, "t" ).c_str(), std::ios::binary );
+        if( ifs.is_open() ) { ( *istream_ )()->seekg( csv::index( ifs ).seek( from_ - config_.offset ) ); }
+        else if( sorted_ && boost::filesystem::is_regular_file( config_.options.filename ) )
+        {
+            std::vector< std::string > fields = split( config_.options.fields, ',' );
+            std::size_t field = 0;
+            for( std::size_t k = 0; k < fields.size(); ++k ) { if( fields[k] == "t" ) { field = k; break; } }
+            csv::index::bisect( *( *istream_ )(), config_.options.format(), field, csv::index::key( from_ - config_.offset ) );
+        }
+    }
+    input_stream_.reset( new csv::input_stream< time >( *( *istream_ )(), config_.options ) );
+    if( config_.offset.total_microseconds() != 0 )
+    {
+        if( config_.options.binary() ) { binary_.reset( new csv::binary< time >( config_.options.fields ) ); }
+        else { ascii_.reset( new csv::ascii< time >( config_.options.fields ) ); }
+    }
+}
+
+bool Multiplay::reader::read_( entry& e )
+{
+    while( true )
+    {
+        const time* time = input_stream_->read();
+        if( time == NULL ) { return false; }
+        boost::posix_time::ptime t = time->timestamp;
+        if( config_.offset.total_microseconds() != 0 )
+        {
+            t += config_.offset;
+        }
+        if( sorted_ && !to_.is_not_a_date_time() && t > to_ ) { return false; } // sorted: nothing more to play from this source
+        if( ( ( !from_.is_not_a_date_time() ) && ( t < from_ ) ) || ( ( !to_.is_not_a_date_time() ) && ( t > to_ ) ) ) { continue; }
+        e.timestamp = t;
+        if( config_.options.binary() )
+        {
+            e.data.assign( input_stream_->binary().last(), config_.options.format().size() );
+            if( binary_ ) { binary_->put( Multiplay::time( t ), &e.data[0] ); }
+        }
+        else
+        {
+            if( ascii_ ) { ascii_->put( Multiplay::time( t ), input_stream_->ascii().last_fields(), e.data ); }
+            else { e.data.assign( input_stream_->ascii().last_line().data, input_stream_->ascii().last_line().size ); }
+            e.data += endl_;
+        }
+        return true;
+    }
+}
+
+void Multiplay::reader::run_()
+{
+    try
+    {
+        while( true )
+        {
+            std::size_t tail;
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                while( !shutdown_ && size_ == entries_.size() ) { freed_.wait( lock ); }
+                if( shutdown_ ) { return; }
+                tail = ( head_ + size_ ) % entries_.size(); // not touched by consumer until filled
+            }
+            if( !read_( entries_[tail] ) ) { break; }
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                ++size_;
+            }
+            filled_.notify_one();
+        }
+    }
+    catch( std::exception& ex ) { boost::mutex::scoped_lock lock( mutex_ ); error_ = ex.what(); }
+    catch( ... ) { boost::mutex::scoped_lock lock( mutex_ ); error_ = "unknown exception"; }
+    {
+        boost::mutex::scoped_lock lock( mutex_ );
+        done_ = true;
+    }
+    filled_.notify_one();
+}
+
+const Multiplay::reader::entry* Multiplay::reader::front()
+{
+    boost::mutex::scoped_lock lock( mutex_ );
+    while( size_ == 0 && !done_ ) { filled_.wait( lock ); }
+    if( size_ > 0 ) { return &entries_[head_]; }
+    if( !error_.empty() ) { COMMA_THROW( comma::exception, config_.options.filename << ": " << error_ ); }
+    return NULL;
+}
+
+void Multiplay::reader::pop()
+{
+    {
+        boost::mutex::scoped_lock lock( mutex_ );
+        head_ = ( head_ + 1 ) % entries_.size();
+        --size_;
+    }
+    freed_.notify_one();
+}
+
+void Multiplay::reader::stop()
+{
+    {
+        boost::mutex::scoped_lock lock( mutex_ );
+        shutdown_ = true;
+    }
+    freed_.notify_one();
+    if( !thread_.joinable() ) { return; }
+    if( thread_.timed_join( boost::posix_time::milliseconds( 100 ) ) ) { istream_->close(); }
+    else { thread_.detach(); } // blocked on reading source: the thread keeps the reader till the read returns
+}
 
 /*!
     @brief Constructor
@@ -34,65 +233,39 @@ Multiplay::Multiplay( const std::vector< SourceConfig >& configs
                     , const boost::posix_time::time_duration& precision
                     , boost::posix_time::ptime from
                     , boost::posix_time::ptime to
-                    , bool flush )
+                    , bool flush
+                    , bool sorted
+                    , bool wait
+                    , bool precise )
     : m_configs( configs )
-    , istreams_( configs.size() )
-    , m_inputStreams( configs.size() )
+    , m_readers( configs.size() )
     , m_publishers( configs.size() )
-    , m_play( speed, quiet, precision )
-    , m_timestamps( configs.size() )
+    , m_play( speed, quiet, precision, precise )
     , m_started( false )
-    , m_from( from )
-    , m_to( to )
-    , ascii_( configs.size() )
-    , binary_( configs.size() )
+    , m_wait( wait )
 {
     for( unsigned int i = 0; i < configs.size(); i++ )
     {
-        // todo: quick and dirty for now: blocking streams for named pipes
-        istreams_[i].reset( new io::istream( configs[i].options.filename, m_configs[i].options.binary() ? io::mode::binary : io::mode::ascii, io::mode::blocking ) );
-        if( !( *istreams_[i] )() ) { COMMA_THROW( comma::exception, "named pipe " << configs[i].options.filename << " is closed (todo: support closed named pipes)" ); }
-        m_inputStreams[i].reset( new csv::input_stream< time >( *( *istreams_[i] )(), m_configs[i].options ) );
+        m_readers[i].reset( new reader( configs[i], from, to, sorted ) );
         unsigned int j;
         for( j = 0; j < i && configs[j].outputFileName != configs[i].outputFileName; ++j ); // quick and dirty: unique publishers
         if( j == i ) { m_publishers[i].reset( new io::publisher( configs[i].outputFileName, m_configs[i].options.binary() ? io::mode::binary : io::mode::ascii, true, flush ) ); }
         else { m_publishers[i] = m_publishers[j]; }
-        boost::posix_time::time_duration d;
-        if( configs[i].offset.total_microseconds() != 0 )
-        {
-            if( m_configs[i].options.binary() )
-            {
-                binary_[i].reset( new csv::binary< time >( m_configs[i].options.fields ) );
-                buf_fer.resize( m_configs[i].options.format().size() );
-            }
-            else
-            {
-                ascii_[i].reset( new csv::ascii< time >( m_configs[i].options.fields ) );
-            }
-        }
     }
+    for( unsigned int i = 0; i < m_readers.size(); ++i ) { reader::start( m_readers[i] ); }
 }
 
+Multiplay::~Multiplay() { close(); }
+
 void Multiplay::close()
 {
     for( unsigned int i = 0U; i < m_configs.size(); i++ )
     {
-        istreams_[i]->close();
-        m_publishers[i]->close();
+        if( m_readers[i] ) { m_readers[i]->stop(); m_readers[i].reset(); }
+        if( m_publishers[i] ) { m_publishers[i]->close(); m_publishers[i].reset(); }
     }
 }
 
-namespace impl {
-    
-static std::string endl()
-{
-    std::ostringstream oss;
-    oss << std::endl;
-    return oss.str();
-}
-
-} // namespace impl {
-
 bool Multiplay::ready() // quick and dirty; should not it be in io::Publisher?
 {
     if( m_started ) { return true; }
@@ -106,77 +279,35 @@ bool Multiplay::ready() // quick and dirty; should not it be in io::Publisher?
         }
     }
     m_started = true;
+    for( unsigned int i = 0; i < m_configs.size(); ++i ) { next_( i ); }
     return true;
 }
     
 /*!
-    @brief try to read from all files and write the oldest
-    @return true if at least one file could be read
+    @brief queue the next record from a given source, if any
+*/
+void Multiplay::next_( unsigned int i )
+{
+    const reader::entry* e = m_readers[i]->front();
+    if( e ) { m_queue.push( record( e->timestamp, i ) ); }
+}
+
+/*!
+    @brief write the oldest of the records queued from all sources and queue the next record from its source
+    @return true if at least one source has not been exhausted
 */
 bool Multiplay::read()
 {
     if( !ready() ) { return true; }
-    bool end = true;
-    for( unsigned int i = 0U; i < m_configs.size(); ++i )
-    {
-        if( !m_timestamps[i].is_not_a_date_time() ) { end = false; continue; }
-        const time* time = m_inputStreams[i]->read();
-        if( time == NULL ) { continue; }
-        boost::posix_time::ptime t = time->timestamp;
-        if( m_configs[i].offset.total_microseconds() != 0 )
-        {
-            t += m_configs[i].offset;
-        }
-        end = false;
-        if( ( ( !m_from.is_not_a_date_time() ) && ( t < m_from ) ) || ( ( !m_to.is_not_a_date_time() ) && ( t > m_to ) ) )
-        {            
-            i--;
-            continue;
-        }
-        m_timestamps[i] = t;
-    }
-    if( end ) { return false; }
-    boost::posix_time::ptime oldest;
-    std::size_t index = 0;
-    for( unsigned int i = 0; i < m_timestamps.size(); ++i )
-    {
-        if( !oldest.is_not_a_date_time() && ( m_timestamps[i].is_not_a_date_time() || m_timestamps[i] >= oldest ) ) { continue; }
-        oldest = m_timestamps[i];
-        index = i;
-    }
-    if( ( ( !m_from.is_not_a_date_time() ) && ( oldest < m_from ) ) || ( ( !m_to.is_not_a_date_time() ) && ( oldest > m_to ) ) )
-    {
-        return true;
-    }
-    m_play.wait( oldest );
-    if( m_configs[index].options.binary() )
-    {
-        if( binary_[index] )
-        {
-            ::memcpy( &buf_fer[0], m_inputStreams[index]->binary().last(), buf_fer.size() );
-            binary_[index]->put( time( oldest ), &buf_fer[0] );
-            m_publishers[index]->write( &buf_fer[0], buf_fer.size() );
-        }
-        else
-        {
-            m_publishers[index]->write( m_inputStreams[index]->binary().last(), m_configs[index].options.format().size() );
-        }
-    }
-    else
-    {
-        static std::string endl = impl::endl(); // quick and dirty, since publisher is not std::stream
-        if( ascii_[index] )
-        {
-            std::vector< std::string > last = m_inputStreams[index]->ascii().last();
-            ascii_[index]->put( time( oldest ), last );
-            ( *m_publishers[index] ) << comma::join( last, m_configs[index].options.delimiter ) << endl;
-        }
-        else
-        {
-            ( *m_publishers[index] ) << comma::join( m_inputStreams[index]->ascii().last(), m_configs[index].options.delimiter ) << endl;
-        }
-    }
-    m_timestamps[index] = boost::posix_time::not_a_date_time;
+    if( m_queue.empty() ) { return false; }
+    boost::posix_time::ptime oldest = m_queue.top().first;
+    std::size_t index = m_queue.top().second;
+    m_queue.pop();
+    if( m_wait ) { m_play.wait( oldest ); }
+    const reader::entry* e = m_readers[index]->front();
+    m_publishers[index]->write( &e->data[0], e->data.size() );
+    m_readers[index]->pop();
+    next_( index );
     return true;
 }
 
@@ -19,6 +19,9 @@
 #ifndef COMMA_CSV_MULTIPLAY_H
 #define COMMA_CSV_MULTIPLAY_H
 
+#include <functional>
+#include <queue>
+#include <utility>
 #include <vector>
 #include <boost/thread/thread_time.hpp>
 #include <comma/csv/options.h>
@@ -59,26 +62,32 @@ class Multiplay
                 , boost::posix_time::ptime from = boost::posix_time::not_a_date_time
                 , boost::posix_time::ptime to = boost::posix_time::not_a_date_time
                 , bool flush = true
+                , bool sorted = false
+                , bool wait = true
+                , bool precise = false
                  );
 
+        ~Multiplay();
+
         void close();
 
         bool read();
 
+        /// output playback lateness statistics
+        void report( std::ostream& os ) const { m_play.report( os ); }
+
     private:
+        class reader; // reads and prepares records of a source in its own thread
         std::vector<SourceConfig> m_configs;
-        std::vector< boost::shared_ptr< comma::io::istream > > istreams_;
-        std::vector< boost::shared_ptr< csv::input_stream< time > > > m_inputStreams;
+        std::vector< boost::shared_ptr< reader > > m_readers;
         std::vector< boost::shared_ptr< comma::io::publisher > > m_publishers;
         csv::impl::play m_play;
-        std::vector< boost::posix_time::ptime > m_timestamps;
+        typedef std::pair< boost::posix_time::ptime, unsigned int > record; // timestamp and source index, thus equal timestamps keep the order of sources
+        std::priority_queue< record, std::vector< record >, std::greater< record > > m_queue; // next record of each source, oldest on top
         bool m_started;
-        boost::posix_time::ptime m_from;
-        boost::posix_time::ptime m_to;
-        std::vector< boost::shared_ptr< csv::ascii< time > > > ascii_;
-        std::vector< boost::shared_ptr< csv::binary< time > > > binary_;
-        std::vector< char > buf_fer;
+        bool m_wait;
         bool ready();
+        void next_( unsigned int i );
 };
 
 } // namespace comma {
@@ -16,20 +16,54 @@
 // You should have received a copy of the GNU Lesser General Public
 // License along with Ark. If not, see <http://www.gnu.org/licenses/>.
 
+#ifndef WIN32
+#include <errno.h>
+#include <time.h>
+#endif
 #include <boost/thread/thread.hpp>
 #include <boost/thread/thread_time.hpp>
+#include <comma/csv/impl/iso_time.h>
 #include "./play.h"
 
 
 namespace comma { namespace csv { namespace impl {
+
+static const comma::int64 spin = 100000; // nanoseconds to spin before a deadline in precise mode, since sleep may overshoot
+
+static comma::int64 monotonic() // nanoseconds
+{
+    #ifdef WIN32
+    return ( boost::get_system_time() - boost::posix_time::ptime( boost::gregorian::date( 1970, 1, 1 ) ) ).total_microseconds() * 1000; // quick and dirty
+    #else
+    struct timespec t;
+    ::clock_gettime( CLOCK_MONOTONIC, &t );
+    return comma::int64( t.tv_sec ) * 1000000000 + t.tv_nsec;
+    #endif
+}
+
+static void sleep_until( comma::int64 deadline ) // nanoseconds on monotonic clock
+{
+    #ifdef WIN32
+    comma::int64 now = monotonic();
+    if( deadline > now ) { boost::this_thread::sleep( boost::posix_time::microseconds( ( deadline - now ) / 1000 ) ); }
+    #else
+    struct timespec t;
+    t.tv_sec = deadline / 1000000000;
+    t.tv_nsec = deadline % 1000000000;
+    while( ::clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL ) == EINTR );
+    #endif
+}
     
-/// constructor    
-play::play( double speed, bool quiet, const boost::posix_time::time_duration& precision ):
+/// constructor
+/// @param precise if true, sleep till absolute deadlines on monotonic clock and spin for the last few microseconds
+play::play( double speed, bool quiet, const boost::posix_time::time_duration& precision, bool precise ):
     m_speed( speed ),
     m_precision( precision ),
     m_lag( false ),
     m_lagCounter( 0U ),
-    m_quiet( quiet )
+    m_quiet( quiet ),
+    m_precise( precise ),
+    m_monotonicFirst( 0 )
 {
 }
 
@@ -48,7 +82,9 @@ play::play( const boost::posix_time::ptime& first, double speed, bool quiet, con
     m_precision( precision ),
     m_lag( false ),
     m_lagCounter( 0U ),
-    m_quiet( quiet )
+    m_quiet( quiet ),
+    m_precise( false ),
+    m_monotonicFirst( 0 )
 {
     
 }
@@ -58,7 +94,7 @@ play::play( const boost::posix_time::ptime& first, double speed, bool quiet, con
 /// @param time timestamp as ptime
 void play::wait( const boost::posix_time::ptime& time )
 {
-
+    if( m_precise ) { waitPrecisely_( time ); return; }
     if ( !m_offset )
     {
         boost::posix_time::ptime systemTime = boost::get_system_time();
@@ -94,8 +130,10 @@ void play::wait( const boost::posix_time::ptime& time )
                 if ( lag < -m_precision ) // no need to sleep less than the expected accuracy
                 {
                     boost::this_thread::sleep( target );
+                    systemTime = boost::get_system_time();
                 }
             }
+            update_( systemTime - target );
             m_last = time;
         }
         else
@@ -105,11 +143,59 @@ void play::wait( const boost::posix_time::ptime& time )
     }
 }
 
+/// wait until a timestamp in precise mode
+void play::waitPrecisely_( const boost::posix_time::ptime& time )
+{
+    if( !m_offset )
+    {
+        m_monotonicFirst = monotonic();
+        m_offset = boost::get_system_time() - time;
+        m_first = time;
+        m_last = time;
+        return;
+    }
+    if( time <= m_last ) { return; } // timestamp same or earlier than last time, nothing to do
+    const comma::int64 target = m_monotonicFirst + static_cast< comma::int64 >( ( time - m_first ).total_microseconds() * m_speed * 1000 );
+    comma::int64 now = monotonic();
+    if( now < target - spin ) { sleep_until( target - spin ); }
+    while( ( now = monotonic() ) < target ); // spin
+    const boost::posix_time::time_duration lag = boost::posix_time::microseconds( ( now - target ) / 1000 );
+    if( !m_quiet && lag > m_precision )
+    {
+        if( !m_lag ) { m_lag = true; std::cerr << "csv-play: warning, lagging behind " << lag << std::endl; }
+        m_lagCounter++;
+    }
+    else if( !m_quiet && m_lag )
+    {
+        m_lag = false;
+        std::cerr << "csv-play: recovered after " << m_lagCounter << " packets " << std::endl;
+        m_lagCounter = 0U;
+    }
+    update_( lag );
+    m_last = time;
+}
+
+void play::update_( const boost::posix_time::time_duration& lag )
+{
+    ++m_statistics.count;
+    if( lag.is_negative() ) { return; } // released early within precision
+    if( lag > m_precision ) { ++m_statistics.late; }
+    if( lag > m_statistics.max ) { m_statistics.max = lag; }
+    m_statistics.total += lag;
+}
+
+/// output lateness statistics
+void play::report( std::ostream& os ) const
+{
+    os << "csv-play: waited for " << m_statistics.count << " record(s); late by more than " << m_precision.total_microseconds() << " microseconds: " << m_statistics.late
+       << "; lag: max " << m_statistics.max.total_microseconds() << " microseconds, mean " << m_statistics.mean().total_microseconds() << " microseconds" << std::endl;
+}
+
 /// wait until a timestamp
 /// @param isoTime timestamp in iso format
 void play::wait( const std::string& isoTime )
 {
-    wait( boost::posix_time::from_iso_string( isoTime ) );
+    wait( comma::csv::impl::from_iso_string( isoTime ) );
 }
 
 } } } // namespace comma { namespace csv { namespace impl {
@@ -19,22 +19,45 @@
 #ifndef COMMA_CSV_APPLICATIONS_PLAY_H
 #define COMMA_CSV_APPLICATIONS_PLAY_H
 
+#include <iostream>
 #include <boost/optional.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
 
 namespace comma { namespace csv { namespace impl {
 
 /// play back timestamped data in a real time manner
+///
+/// in precise mode, sleep till absolute deadlines on monotonic clock
+/// (not affected by system time adjustments) and spin for the last
+/// few microseconds, rather than sleeping for relative durations
 class play
 {
 public:
-    play( double speed = 1.0, bool quiet = false, const boost::posix_time::time_duration& precision = boost::posix_time::milliseconds(1) );
+    /// lateness of records released by wait()
+    struct statistics
+    {
+        comma::uint64 count; /// number of records waited for
+        comma::uint64 late; /// number of records released later than precision
+        boost::posix_time::time_duration max; /// maximum lag
+        boost::posix_time::time_duration total; /// total lag
+        statistics() : count( 0 ), late( 0 ) {}
+        boost::posix_time::time_duration mean() const { return boost::posix_time::microseconds( count == 0 ? 0 : total.total_microseconds() / static_cast< comma::int64 >( count ) ); }
+    };
+
+    play( double speed = 1.0, bool quiet = false, const boost::posix_time::time_duration& precision = boost::posix_time::milliseconds(1), bool precise = false );
     play( const boost::posix_time::ptime& first, double speed = 1.0, bool quiet = false, const boost::posix_time::time_duration& precision = boost::posix_time::milliseconds(1) );
 
     void wait( const boost::posix_time::ptime& time );
 
     void wait( const std::string& isoTime );
 
+    /// return lateness statistics
+    const statistics& lateness() const { return m_statistics; }
+
+    /// output lateness statistics as a human-readable line
+    void report( std::ostream& os ) const;
+
 private:
     boost::posix_time::ptime m_systemFirst; /// system time at first timestamp
     boost::optional< boost::posix_time::time_duration > m_offset; /// offset between timestamps and system time
@@ -45,6 +68,11 @@ private:
     bool m_lag;
     unsigned int m_lagCounter;
     bool m_quiet;
+    bool m_precise;
+    comma::int64 m_monotonicFirst; /// monotonic time at first timestamp, nanoseconds
+    statistics m_statistics;
+    void update_( const boost::posix_time::time_duration& lag );
+    void waitPrecisely_( const boost::posix_time::ptime& time );
 };
 
 } } } // namespace comma { namespace csv { namespace impl {
@@ -19,6 +19,8 @@
 #ifndef COMMA_CSV_ASCII_HEADER_GUARD_
 #define COMMA_CSV_ASCII_HEADER_GUARD_
 
+#include <algorithm>
+#include <comma/base/exception.h>
 #include <comma/csv/names.h>
 #include <comma/csv/options.h>
 #include <comma/csv/impl/ascii_visitor.h>
@@ -41,6 +43,9 @@ class ascii
         /// get value (returns reference pointing to the parameter)
         const S& get( S& s, const std::vector< std::string >& v ) const;
 
+        /// get value from field views, e.g. as produced by impl::ascii_tokenizer (returns reference pointing to the parameter)
+        const S& get( S& s, const std::vector< impl::ascii_field >& v ) const;
+
         /// get value (convenience function)
         const S& get( S& s, const std::string& line ) const { return get( s, split( line, delimiter_ ) ); }
 
@@ -56,6 +61,13 @@ class ascii
         /// put value at the right place in the line (convenience function)
         const std::string& put( const S& s, std::string& line ) const;
 
+        /// put value into the fields of a line, splicing the new values into the line:
+        /// the other fields and delimiters are copied from the line as is, without re-joining them
+        /// @param fields views of the fields of the line, e.g. as split by impl::ascii_tokenizer
+        /// @param line resulting line (without end of line)
+        /// @note uses an internal buffer, thus not thread-safe
+        const std::string& put( const S& s, const std::vector< impl::ascii_field >& fields, std::string& line ) const;
+
         /// return delimiter
         char delimiter() const { return delimiter_; }
 
@@ -66,6 +78,9 @@ class ascii
         char delimiter_;
         boost::optional< unsigned int > precision_;
         impl::asciiVisitor ascii_;
+        std::vector< std::size_t > columns_; // columns that put() may write, ascending
+        mutable std::vector< std::string > row_;
+        void init_columns_();
 };
 
 template < typename S >
@@ -75,6 +90,7 @@ inline ascii< S >::ascii( const std::string& column_names, char d, bool full_pat
     , ascii_( join( csv::names( column_names, full_path_as_name, sample ), ',' ), full_path_as_name )
 {
     visiting::apply( ascii_, sample );
+    init_columns_();
 }
 
 template < typename S >
@@ -84,12 +100,30 @@ inline ascii< S >::ascii( const options& o, const S& sample )
     , ascii_( join( csv::names( o.fields, o.full_xpath, sample ), ',' ), o.full_xpath )
 {
     visiting::apply( ascii_, sample );
+    init_columns_();
+}
+
+template < typename S >
+inline void ascii< S >::init_columns_()
+{
+    const std::vector< boost::optional< std::size_t > >& indices = ascii_.indices();
+    for( std::size_t i = 0; i < indices.size(); ++i ) { if( indices[i] ) { columns_.push_back( *indices[i] ); } }
+    std::sort( columns_.begin(), columns_.end() );
+    columns_.erase( std::unique( columns_.begin(), columns_.end() ), columns_.end() );
 }
 
 template < typename S >
 inline const S& ascii< S >::get( S& s, const std::vector< std::string >& v ) const
 {
-    impl::from_ascii_ f( ascii_.indices(), ascii_.optional(), v );
+    impl::from_ascii_< std::vector< std::string > > f( ascii_.indices(), ascii_.optional(), v );
+    visiting::apply( f, s );
+    return s;
+}
+
+template < typename S >
+inline const S& ascii< S >::get( S& s, const std::vector< impl::ascii_field >& v ) const
+{
+    impl::from_ascii_< std::vector< impl::ascii_field > > f( ascii_.indices(), ascii_.optional(), v );
     visiting::apply( f, s );
     return s;
 }
@@ -107,9 +141,38 @@ inline const std::vector< std::string >& ascii< S >::put( const S& s, std::vecto
 template < typename S >
 inline const std::string& ascii< S >::put( const S& s, std::string& line ) const
 {
-    std::vector< std::string > v;
-    if( !line.empty() ) { v = split( line, delimiter_ ); }
-    line = join( put( s, v ), delimiter_ );
+    if( line.empty() )
+    {
+        std::vector< std::string > v( columns_.empty() ? 0 : columns_.back() + 1 );
+        line = join( put( s, v ), delimiter_ );
+        return line;
+    }
+    std::vector< impl::ascii_field > fields;
+    split( line, delimiter_, fields );
+    std::string result;
+    put( s, fields, result );
+    line.swap( result );
+    return line;
+}
+
+template < typename S >
+inline const std::string& ascii< S >::put( const S& s, const std::vector< impl::ascii_field >& fields, std::string& line ) const
+{
+    line.clear();
+    if( fields.empty() ) { return line; }
+    if( !columns_.empty() && columns_.back() >= fields.size() ) { COMMA_THROW( comma::exception, "expected at least " << ( columns_.back() + 1 ) << " fields, got " << fields.size() << " in line: " << impl::ascii_field( fields[0].data, fields.back().end() ) ); }
+    if( row_.size() < fields.size() ) { row_.resize( fields.size() ); }
+    for( std::size_t i = 0; i < columns_.size(); ++i ) { row_[ columns_[i] ].assign( fields[ columns_[i] ].data, fields[ columns_[i] ].size ); } // values not put (e.g. empty optional) stay as they are
+    put( s, row_ );
+    const char* begin = fields[0].data;
+    for( std::size_t i = 0; i < columns_.size(); ++i )
+    {
+        const impl::ascii_field& f = fields[ columns_[i] ];
+        line.append( begin, f.data );
+        line += row_[ columns_[i] ];
+        begin = f.end();
+    }
+    line.append( begin, fields.back().end() );
     return line;
 }
 
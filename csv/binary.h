@@ -22,6 +22,7 @@
 #include <boost/optional.hpp>
 #include <comma/csv/names.h>
 #include <comma/csv/options.h>
+#include <comma/csv/impl/binary_plan.h>
 #include <comma/csv/impl/binary_visitor.h>
 #include <comma/csv/impl/from_binary.h>
 #include <comma/csv/impl/to_binary.h>
@@ -51,6 +52,7 @@ class binary
     private:
         const csv::format format_;
         boost::optional< impl::binary_visitor > binary_;
+        impl::binary_plan plan_;
 };
 
 template < typename S >
@@ -60,6 +62,7 @@ inline binary< S >::binary( const std::string& f, const std::string& column_name
     if( format_.size() == sizeof( S ) && format_.string() == csv::format::value( sample ) && join( csv::names( column_names, full_path_as_name, sample ), ',' ) == join( csv::names( full_path_as_name ), ',' ) ) { return; }
     binary_ = impl::binary_visitor( format_, join( csv::names( column_names, full_path_as_name, sample ), ',' ), full_path_as_name );
     visiting::apply( *binary_, sample );
+    plan_ = impl::binary_plan( binary_->offsets(), sample );
 }
 
 template < typename S >
@@ -69,12 +72,17 @@ inline binary< S >::binary( const options& o, const S& sample )
     if( format_.size() == sizeof( S ) && format_.string() == csv::format::value( sample ) && join( csv::names( o.fields, o.full_xpath, sample ), ',' ) == join( csv::names( o.full_xpath ), ',' ) ) { return; }
     binary_ = impl::binary_visitor( format_, join( csv::names( o.fields, o.full_xpath, sample ), ',' ), o.full_xpath );
     visiting::apply( *binary_, sample );
+    plan_ = impl::binary_plan( binary_->offsets(), sample );
 }
 
 template < typename S >
 inline const S& binary< S >::get( S& s, const char* buf ) const
 {
-    if( binary_ )
+    if( plan_.valid() )
+    {
+        plan_.get( reinterpret_cast< char* >( &s ), buf );
+    }
+    else if( binary_ )
     {
         impl::frobinary_ f( binary_->offsets(), binary_->optional(), buf );
         visiting::apply( f, s );
@@ -89,7 +97,11 @@ inline const S& binary< S >::get( S& s, const char* buf ) const
 template < typename S >
 inline char* binary< S >::put( const S& s, char* buf ) const
 {
-    if( binary_ )
+    if( plan_.valid() )
+    {
+        plan_.put( reinterpret_cast< const char* >( &s ), buf );
+    }
+    else if( binary_ )
     {
         impl::to_binary f( binary_->offsets(), buf );
         visiting::apply( f, s );
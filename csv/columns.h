@@ -0,0 +1,267 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_COLUMNS_HEADER_GUARD_
+#define COMMA_CSV_COLUMNS_HEADER_GUARD_
+
+#ifdef WIN32
+#include <stdio.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <comma/base/exception.h>
+#include <comma/csv/format.h>
+
+namespace comma { namespace csv {
+
+/// a block of binary records decoded into columns (struct of arrays):
+/// one contiguous array per field of the format, e.g. for "t,3d,ui" five arrays:
+/// t as comma::int64 microseconds, x, y and z as doubles and the ui as comma::uint32
+///
+/// use it to run loops over a single field (e.g. vectorised ones) without
+/// dragging the other fields of each record through the cache
+///
+/// fields keep their binary representation as in the format, e.g. time is comma::int64 microseconds,
+/// fixed size string s[n] is n bytes per record, padded with zeros
+class columns
+{
+    public:
+        /// constructor
+        columns( const csv::format& format, std::size_t capacity );
+
+        /// return format
+        const csv::format& format() const { return format_; }
+
+        /// return maximum number of records in the block
+        std::size_t capacity() const { return capacity_; }
+
+        /// return number of records in the block
+        std::size_t size() const { return size_; }
+
+        /// set number of records in the block, e.g. before filling the columns to encode them
+        void resize( std::size_t n );
+
+        /// return number of columns, i.e. number of fields in the format
+        std::size_t count() const { return elements_.size(); }
+
+        /// return offset in the record, size and type of the field of a given column
+        const format::element& element( std::size_t i ) const { return elements_[i]; }
+
+        /// return column as array of given type; throw, if the type size does not match the field size
+        template < typename T > T* column( std::size_t i ) { check_< T >( i ); return reinterpret_cast< T* >( &columns_[i][0] ); }
+
+        /// return column as array of given type; throw, if the type size does not match the field size
+        template < typename T > const T* column( std::size_t i ) const { check_< T >( i ); return reinterpret_cast< const T* >( &columns_[i][0] ); }
+
+        /// return raw column data: size() values of element( i ).size bytes each
+        char* data( std::size_t i ) { return &columns_[i][0]; }
+        const char* data( std::size_t i ) const { return &columns_[i][0]; }
+
+        /// decode n packed records into the columns (e.g. binary_input_stream::last_batch()); set size to n
+        void decode( const char* records, std::size_t n );
+
+        /// encode size() records from the columns into packed records of format().size() bytes each
+        void encode( char* records ) const;
+
+    private:
+        csv::format format_;
+        std::size_t capacity_;
+        std::size_t size_;
+        std::vector< format::element > elements_;
+        std::vector< std::vector< char > > columns_;
+        template < typename T > void check_( std::size_t i ) const;
+};
+
+/// read binary records into columns block by block
+class columns_input_stream : public boost::noncopyable
+{
+    public:
+        /// constructor
+        /// @param capacity maximum number of records in a block
+        columns_input_stream( std::istream& is, const csv::format& format, std::size_t capacity = 4096 );
+
+        /// read at least one record (blocking), then as many records as are available without blocking,
+        /// up to the block capacity; return NULL on end of stream
+        /// @note std::cin synchronised with stdio reports no bytes available,
+        ///       call std::ios_base::sync_with_stdio( false ) to get full blocks
+        const columns* read();
+
+        /// return raw packed records of the last block, valid till the next read
+        const char* last() const { return &buffer_[0]; }
+
+    private:
+        std::istream& is_;
+        columns columns_;
+        std::vector< char > buffer_;
+};
+
+/// write columns as packed binary records
+class columns_output_stream : public boost::noncopyable
+{
+    public:
+        /// constructor
+        columns_output_stream( std::ostream& os, const csv::format& format );
+
+        /// write the records of the block
+        void write( const columns& c );
+
+        /// flush the stream
+        void flush() { os_.flush(); }
+
+    private:
+        std::ostream& os_;
+        std::size_t size_;
+        std::vector< char > buffer_;
+};
+
+namespace impl { namespace columns_impl {
+
+/// copy a field from each of n records to a column and back; field size as template parameter
+/// lets the compiler turn the copies into plain loads and stores
+template < std::size_t Size > struct copy
+{
+    static void gather( char* column, const char* records, std::size_t n, std::size_t stride ) { for( std::size_t i = 0; i < n; ++i, column += Size, records += stride ) { ::memcpy( column, records, Size ); } }
+    static void scatter( char* records, const char* column, std::size_t n, std::size_t stride ) { for( std::size_t i = 0; i < n; ++i, column += Size, records += stride ) { ::memcpy( records, column, Size ); } }
+};
+
+inline void gather( char* column, const char* records, std::size_t n, std::size_t stride, std::size_t size )
+{
+    switch( size )
+    {
+        case 1: copy< 1 >::gather( column, records, n, stride ); return;
+        case 2: copy< 2 >::gather( column, records, n, stride ); return;
+        case 4: copy< 4 >::gather( column, records, n, stride ); return;
+        case 8: copy< 8 >::gather( column, records, n, stride ); return;
+        case 12: copy< 12 >::gather( column, records, n, stride ); return;
+        default: for( std::size_t i = 0; i < n; ++i, column += size, records += stride ) { ::memcpy( column, records, size ); }
+    }
+}
+
+inline void scatter( char* records, const char* column, std::size_t n, std::size_t stride, std::size_t size )
+{
+    switch( size )
+    {
+        case 1: copy< 1 >::scatter( records, column, n, stride ); return;
+        case 2: copy< 2 >::scatter( records, column, n, stride ); return;
+        case 4: copy< 4 >::scatter( records, column, n, stride ); return;
+        case 8: copy< 8 >::scatter( records, column, n, stride ); return;
+        case 12: copy< 12 >::scatter( records, column, n, stride ); return;
+        default: for( std::size_t i = 0; i < n; ++i, column += size, records += stride ) { ::memcpy( records, column, size ); }
+    }
+}
+
+} } // namespace impl { namespace columns_impl {
+
+inline columns::columns( const csv::format& format, std::size_t capacity )
+    : format_( format )
+    , capacity_( capacity )
+    , size_( 0 )
+{
+    if( capacity == 0 ) { COMMA_THROW( comma::exception, "expected positive capacity, got 0" ); }
+    if( format.count() == 0 ) { COMMA_THROW( comma::exception, "expected non-empty format" ); }
+    elements_.reserve( format.count() );
+    columns_.resize( format.count() );
+    for( std::size_t i = 0; i < format.count(); ++i )
+    {
+        elements_.push_back( format.offset( i ) );
+        columns_[i].resize( capacity * elements_[i].size );
+    }
+}
+
+inline void columns::resize( std::size_t n )
+{
+    if( n > capacity_ ) { COMMA_THROW( comma::exception, "expected size not greater than capacity " << capacity_ << ", got " << n ); }
+    size_ = n;
+}
+
+template < typename T >
+inline void columns::check_( std::size_t i ) const
+{
+    if( i >= elements_.size() ) { COMMA_THROW( comma::exception, "expected column index less than " << elements_.size() << ", got " << i ); }
+    if( sizeof( T ) != elements_[i].size ) { COMMA_THROW( comma::exception, "column " << i << ": expected type of size " << elements_[i].size << " for " << format::to_format( elements_[i].type, elements_[i].size ) << ", got type of size " << sizeof( T ) ); }
+}
+
+inline void columns::decode( const char* records, std::size_t n )
+{
+    resize( n );
+    for( std::size_t i = 0; i < elements_.size(); ++i ) { impl::columns_impl::gather( &columns_[i][0], records + elements_[i].offset, n, format_.size(), elements_[i].size ); }
+}
+
+inline void columns::encode( char* records ) const
+{
+    for( std::size_t i = 0; i < elements_.size(); ++i ) { impl::columns_impl::scatter( records + elements_[i].offset, &columns_[i][0], size_, format_.size(), elements_[i].size ); }
+}
+
+inline columns_input_stream::columns_input_stream( std::istream& is, const csv::format& format, std::size_t capacity )
+    : is_( is )
+    , columns_( format, capacity )
+    , buffer_( format.size() * capacity )
+{
+    #ifdef WIN32
+    if( &is == &std::cin ) { _setmode( _fileno( stdin ), _O_BINARY ); }
+    #endif
+}
+
+inline const columns* columns_input_stream::read()
+{
+    const std::size_t size = columns_.format().size();
+    is_.read( &buffer_[0], size );
+    if( is_.gcount() == 0 ) { return NULL; }
+    if( static_cast< std::size_t >( is_.gcount() ) < size ) { COMMA_THROW( comma::exception, "expected " << size << " bytes, got only " << is_.gcount() ); }
+    std::size_t count = 1;
+    while( count < columns_.capacity() && is_.good() )
+    {
+        std::streamsize available = is_.rdbuf()->in_avail();
+        if( available < static_cast< std::streamsize >( size ) ) { break; }
+        std::size_t n = available / size;
+        if( n > columns_.capacity() - count ) { n = columns_.capacity() - count; }
+        is_.read( &buffer_[ count * size ], n * size );
+        if( static_cast< std::size_t >( is_.gcount() ) < n * size ) { COMMA_THROW( comma::exception, "expected " << ( n * size ) << " bytes, got only " << is_.gcount() ); }
+        count += n;
+    }
+    columns_.decode( &buffer_[0], count );
+    return &columns_;
+}
+
+inline columns_output_stream::columns_output_stream( std::ostream& os, const csv::format& format )
+    : os_( os )
+    , size_( format.size() )
+{
+    #ifdef WIN32
+    if( &os == &std::cout ) { _setmode( _fileno( stdout ), _O_BINARY ); }
+    #endif
+}
+
+inline void columns_output_stream::write( const columns& c )
+{
+    if( c.format().size() != size_ ) { COMMA_THROW( comma::exception, "expected columns of records of size " << size_ << ", got " << c.format().size() ); }
+    buffer_.resize( c.size() * size_ );
+    if( buffer_.empty() ) { return; }
+    c.encode( &buffer_[0] );
+    os_.write( &buffer_[0], buffer_.size() );
+}
+
+} } // namespace comma { namespace csv {
+
+#endif // #ifndef COMMA_CSV_COLUMNS_HEADER_GUARD_
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <time.h>
 #include <cmath>
+#include <limits>
 #include <sstream>
 #include <boost/array.hpp>
 #include <boost/lexical_cast.hpp>
@@ -28,6 +29,9 @@
 #include <comma/string/string.h>
 #include <comma/csv/format.h>
 #include "./impl/epoch.h"
+#include "./impl/iso_time.h"
+#include "./impl/parse.h"
+#include "./impl/print.h"
 
 namespace comma { namespace csv {
 
@@ -76,6 +80,7 @@ format::format( const std::string& f )
         offset += size;
         size_ += size;
     }
+    compile_();
 }
  
 const std::string& format::string() const { return string_; }
@@ -174,150 +179,170 @@ std::size_t format::sizeOf( types_enum type ) // todo: returns 0 for fixed size
     return sizes[ static_cast< std::size_t >( type ) ];
 }
 
-namespace impl {
+namespace impl { namespace codecs {
 
-template < typename T >
-static std::size_t csv_to_bin( char* buf, const std::string& s )
+// per-type encoders and decoders of a single field; decoders print into a buffer of at least csv_size() bytes and return its end
+
+template < typename T > struct number
 {
-    // T t = boost::lexical_cast< T >( s );
-    //::memcpy( buf, &t, sizeof( T ) );
-    *reinterpret_cast< T* >( buf ) = boost::lexical_cast< T >( s );
-    return sizeof( T );
-}
+    static std::size_t size( std::size_t ) { return sizeof( T ); }
+    static std::size_t csv_size( std::size_t ) { return std::numeric_limits< T >::digits10 + 2; } // sign and all the digits
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t ) { T t = impl::parse< T >( s, length ); ::memcpy( buf, &t, sizeof( T ) ); }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& ) { T t; ::memcpy( &t, buf, sizeof( T ) ); return impl::print( csv, t ); }
+};
 
-template < typename T >
-static void withPrecision( std::ostringstream& oss, T t, const boost::optional< unsigned int >& ) { oss << t; }
+template < typename T, unsigned int Precision > struct floating : public number< T >
+{
+    static std::size_t csv_size( std::size_t ) { return impl::print_size; }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& precision ) { T t; ::memcpy( &t, buf, sizeof( T ) ); return impl::print( csv, t, precision ? *precision : Precision ); }
+};
 
-static void withPrecision( std::ostringstream& oss, float t, const boost::optional< unsigned int >& precision )
+struct byte
 {
-    oss.precision( precision ? *precision : 6 );
-    oss << t;
-}
+    static std::size_t size( std::size_t ) { return 1; }
+    static std::size_t csv_size( std::size_t ) { return 4; }
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t )
+    {
+        int i = impl::parse< int >( s, length );
+        if( i < -127 || i > 128 ) { COMMA_THROW( comma::exception, "expected byte, got " << i ); }
+        *buf = static_cast< char >( i );
+    }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& ) { return impl::print( csv, static_cast< int >( *buf ) ); }
+};
 
-static void withPrecision( std::ostringstream& oss, double t, const boost::optional< unsigned int >& precision )
+struct unsigned_byte
 {
-    oss.precision( precision ? *precision : 16 );
-    oss << t;
-}
+    static std::size_t size( std::size_t ) { return 1; }
+    static std::size_t csv_size( std::size_t ) { return 3; }
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t )
+    {
+        unsigned int i = impl::parse< unsigned int >( s, length );
+        if( i > 255 ) { COMMA_THROW( comma::exception, "expected unsigned byte, got " << i ); }
+        *buf = static_cast< unsigned char >( i );
+    }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& ) { return impl::print( csv, static_cast< unsigned int >( static_cast< unsigned char >( *buf ) ) ); }
+};
 
-template < typename T >
-static std::size_t bin_to_csv( std::ostringstream& oss, const char* buf, const boost::optional< unsigned int >& precision )
+struct character
 {
-    //T t;
-    //::memcpy( &t, buf, sizeof( T ) );
-    //withPrecision( oss, t, precision );
-    withPrecision( oss, *reinterpret_cast< const T* >( buf ), precision );
-    return sizeof( T );
-}
+    static std::size_t size( std::size_t ) { return 1; }
+    static std::size_t csv_size( std::size_t ) { return 1; }
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t )
+    {
+        if( length != 1 ) { COMMA_THROW( comma::exception, "expected character, got \"" << std::string( s, length ) << "\"" ); }
+        *buf = s[0];
+    }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& ) { *csv = *buf; return csv + 1; }
+};
 
-static std::size_t csv_to_bin( char* buf, const std::string& s, format::types_enum type, std::size_t size )
+template < format::types_enum F > struct time
+{
+    typedef format::traits< boost::posix_time::ptime, F > traits;
+    static std::size_t size( std::size_t ) { return traits::size; }
+    static std::size_t csv_size( std::size_t ) { return impl::iso_time_size; }
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t ) { traits::to_bin( impl::from_iso_string( s, length ), buf ); }
+    static char* to_csv( char* csv, const char* buf, std::size_t, const boost::optional< unsigned int >& ) { return impl::to_iso_string( csv, traits::from_bin( buf ) ); }
+};
+
+struct fixed_string
 {
-    try
+    static std::size_t size( std::size_t size ) { return size; }
+    static std::size_t csv_size( std::size_t size ) { return size; }
+    static void to_bin( char* buf, const char* s, std::size_t length, std::size_t size )
     {
-        switch( type ) // todo: tear down csv_to_bin, use format::traits
-        {
-            case format::int8:
-            {
-                int i = boost::lexical_cast< int >( s );
-                if( i < -127 || i > 128 ) { COMMA_THROW( comma::exception, "expected byte, got " << i ); }
-                *buf = static_cast< char >( i );
-                return sizeof( char );
-            }
-            case format::uint8:
-            {
-                unsigned int i = boost::lexical_cast< unsigned int >( s );
-                if( i > 255 ) { COMMA_THROW( comma::exception, "expected unsigned byte, got " << i ); }
-                //unsigned char c = static_cast< unsigned char >( i );
-                //::memcpy( buf, &c, 1 );
-                *buf = static_cast< unsigned char >( i );
-                return sizeof( unsigned char );
-            }
-            case format::int16: return csv_to_bin< comma::int16 >( buf, s );
-            case format::uint16: return csv_to_bin< comma::uint16 >( buf, s );
-            case format::int32: return csv_to_bin< comma::int32 >( buf, s );
-            case format::uint32: return csv_to_bin< comma::uint32 >( buf, s );
-            case format::int64: return csv_to_bin< comma::int64 >( buf, s );
-            case format::uint64: return csv_to_bin< comma::uint64 >( buf, s );
-            case format::char_t: return csv_to_bin< char >( buf, s );
-            case format::float_t: return csv_to_bin< float >( buf, s );
-            case format::double_t: return csv_to_bin< double >( buf, s );
-            case format::time: // TODO: quick and dirty: use serialization traits
-                format::traits< boost::posix_time::ptime, format::time >::to_bin( boost::posix_time::from_iso_string( s ), buf );
-                return format::traits< boost::posix_time::ptime, format::time >::size;
-            case format::long_time: // TODO: quick and dirty: use serialization traits
-                format::traits< boost::posix_time::ptime, format::long_time >::to_bin( boost::posix_time::from_iso_string( s ), buf );
-                return format::traits< boost::posix_time::ptime, format::long_time >::size;
-            case format::fixed_string:
-                if( s.length() > size ) { COMMA_THROW( comma::exception, "expected string not longer than " << size << "; got \"" << s << "\"" ); }
-                ::memset( buf, 0, size );
-                if( !s.empty() ) { ::memcpy( buf, &s[0], s.length() ); }
-                return size;
-            default: COMMA_THROW( comma::exception, "todo: not implemented" );
-        }
+        if( length > size ) { COMMA_THROW( comma::exception, "expected string not longer than " << size << "; got \"" << std::string( s, length ) << "\"" ); }
+        ::memcpy( buf, s, length );
+        ::memset( buf + length, 0, size - length );
     }
-    catch( std::exception& ex )
+    static char* to_csv( char* csv, const char* buf, std::size_t size, const boost::optional< unsigned int >& )
     {
-        COMMA_THROW( comma::exception, "for [" << s << "]: " << ex.what() );
+        std::size_t length = buf[ size - 1 ] == 0 ? ::strlen( buf ) : size;
+        ::memcpy( csv, buf, length );
+        return csv + length;
     }
-    catch( ... )
+};
+
+// a run of fields of the same type: the loop over the run is compiled for the type, thus no per-field dispatch
+template < typename Codec > struct run
+{
+    static void csv_to_bin( char* buf, const impl::ascii_field* fields, std::size_t count, std::size_t size )
     {
-        throw;
+        std::size_t i = 0;
+        try { for( ; i < count; ++i, buf += Codec::size( size ) ) { Codec::to_bin( buf, fields[i].data, fields[i].size, size ); } }
+        catch( std::exception& ex ) { COMMA_THROW( comma::exception, "for [" << fields[i] << "]: " << ex.what() ); }
     }
-}
 
-static std::size_t bin_to_csv( std::ostringstream& oss, const char* buf, format::types_enum type, std::size_t size, const boost::optional< unsigned int >& precision )
+    // prints each field followed by delimiter straight into the string, resized once for the whole run
+    static void bin_to_csv( std::string& csv, const char* buf, std::size_t count, std::size_t size, char delimiter, const boost::optional< unsigned int >& precision )
+    {
+        std::size_t offset = csv.size();
+        csv.resize( offset + count * ( Codec::csv_size( size ) + 1 ) );
+        char* begin = &csv[0];
+        char* p = begin + offset;
+        for( std::size_t i = 0; i < count; ++i, buf += Codec::size( size ) ) { p = Codec::to_csv( p, buf, size, precision ); *p++ = delimiter; }
+        csv.resize( p - begin );
+    }
+};
+
+} } // namespace impl { namespace codecs {
+
+void format::compile_()
 {
-    switch( type ) // todo: tear down bin_to_csv, use format::traits
+    codecs_.clear();
+    for( std::size_t i = 0; i < elements_.size(); ++i )
     {
-        case format::int8:
-            oss << static_cast< int >( *buf );
-            return sizeof( char );
-        case format::uint8:
-            oss << static_cast< unsigned int >( static_cast< unsigned char >( *buf ) );
-            return sizeof( unsigned char );
-        case format::int16: return bin_to_csv< comma::int16 >( oss, buf, precision );
-        case format::uint16: return bin_to_csv< comma::uint16 >( oss, buf, precision );
-        case format::int32: return bin_to_csv< comma::int32 >( oss, buf, precision );
-        case format::uint32: return bin_to_csv< comma::uint32 >( oss, buf, precision );
-        case format::int64: return bin_to_csv< comma::int64 >( oss, buf, precision );
-        case format::uint64: return bin_to_csv< comma::uint64 >( oss, buf, precision );
-        case format::char_t: return bin_to_csv< char >( oss, buf, precision );
-        case format::float_t: return bin_to_csv< float >( oss, buf, precision );
-        case format::double_t: return bin_to_csv< double >( oss, buf, precision );
-        case format::time:
-            oss << boost::posix_time::to_iso_string( format::traits< boost::posix_time::ptime, format::time >::from_bin( buf, sizeof( comma::uint64 ) ) );
-            return format::traits< boost::posix_time::ptime, format::time >::size;
-        case format::long_time:
-            oss << boost::posix_time::to_iso_string( format::traits< boost::posix_time::ptime, format::long_time >::from_bin( buf, sizeof( comma::uint64 ) + sizeof( comma::uint32 ) ) );
-            return format::traits< boost::posix_time::ptime, format::long_time >::size;
-        case format::fixed_string:
-            oss << ( buf[ size - 1 ] == 0 ? std::string( buf ) : std::string( buf, size ) );
-            return size;
-        default : COMMA_THROW( comma::exception, "Todo: not implemented" );
+        const element& e = elements_[i];
+        if( i > 0 && e.type == elements_[ i - 1 ].type && e.size == elements_[ i - 1 ].size ) { codecs_.back().count += e.count; continue; } // e.g. "d,d,d" is the same run as "3d"
+        switch( e.type )
+        {
+            case format::int8: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::byte > >( e.count, e.size ) ); break;
+            case format::uint8: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::unsigned_byte > >( e.count, e.size ) ); break;
+            case format::int16: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::int16 > > >( e.count, e.size ) ); break;
+            case format::uint16: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::uint16 > > >( e.count, e.size ) ); break;
+            case format::int32: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::int32 > > >( e.count, e.size ) ); break;
+            case format::uint32: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::uint32 > > >( e.count, e.size ) ); break;
+            case format::int64: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::int64 > > >( e.count, e.size ) ); break;
+            case format::uint64: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::number< comma::uint64 > > >( e.count, e.size ) ); break;
+            case format::char_t: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::character > >( e.count, e.size ) ); break;
+            case format::float_t: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::floating< float, 6 > > >( e.count, e.size ) ); break;
+            case format::double_t: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::floating< double, 16 > > >( e.count, e.size ) ); break;
+            case format::time: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::time< format::time > > >( e.count, e.size ) ); break;
+            case format::long_time: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::time< format::long_time > > >( e.count, e.size ) ); break;
+            case format::fixed_string: codecs_.push_back( codec::make< impl::codecs::run< impl::codecs::fixed_string > >( e.count, e.size ) ); break;
+            default: COMMA_THROW( comma::exception, "todo: not implemented" );
+        }
     }
 }
 
-} // namespace impl {
-
 void format::csv_to_bin( std::ostream& os, const std::string& csv, char delimiter ) const
 {
-    const std::vector< std::string >& v = comma::split( csv, delimiter );
-    csv_to_bin( os, v );
+    std::vector< impl::ascii_field > v;
+    split( csv, delimiter, v );
+    std::vector< char > buf( size_ ); //char buf[ size_ ]; // stupid Windows
+    os.write( csv_to_bin( &buf[0], v ), size_ );
 }
     
 void format::csv_to_bin( std::ostream& os, const std::vector< std::string >& v ) const
 {
     if( v.size() != count_ ) { COMMA_THROW( comma::exception, "expected csv string with " << count_ << " elements, got [" << comma::join( v, ',' ) << "]" ); }
+    std::vector< impl::ascii_field > fields( v.size() );
+    for( std::size_t i = 0; i < v.size(); ++i ) { fields[i] = impl::ascii_field( v[i].data(), v[i].size() ); }
     std::vector< char > buf( size_ ); //char buf[ size_ ]; // stupid Windows
-    char* p = &buf[0];
-    unsigned int offsetIndex = 0u;
-    unsigned int count = 0u;
-    for( unsigned int i = 0; i < v.size(); ++i, ++count )
+    os.write( csv_to_bin( &buf[0], fields ), size_ );
+}
+
+char* format::csv_to_bin( char* buf, const std::vector< impl::ascii_field >& v ) const
+{
+    if( v.size() != count_ )
     {
-        if( count >= elements_[ offsetIndex ].count ) { count = 0; ++offsetIndex; }
-        p += impl::csv_to_bin( p, v[i], elements_[ offsetIndex ].type, elements_[ offsetIndex ].size );
+        std::ostringstream oss;
+        for( std::size_t i = 0; i < v.size(); ++i ) { oss << ( i == 0 ? "" : "," ) << v[i]; }
+        COMMA_THROW( comma::exception, "expected csv string with " << count_ << " elements, got [" << oss.str() << "]" );
     }
-    os.write( &buf[0], size_ );
+    char* p = buf;
+    const impl::ascii_field* f = v.empty() ? NULL : &v[0];
+    for( std::size_t i = 0; i < codecs_.size(); p += codecs_[i].count * codecs_[i].size, f += codecs_[i].count, ++i ) { codecs_[i].csv_to_bin( p, f, codecs_[i].count, codecs_[i].size ); }
+    return buf;
 }
 
 std::string format::csv_to_bin( const std::string& csv, char delimiter ) const
@@ -342,17 +367,18 @@ std::string format::bin_to_csv( const std::string& bin, char delimiter, const bo
 
 std::string format::bin_to_csv( const char* buf, char delimiter, const boost::optional< unsigned int >& precision ) const
 {
-    std::ostringstream oss;
+    std::string csv;
+    bin_to_csv( buf, csv, delimiter, precision );
+    return csv;
+}
+
+const std::string& format::bin_to_csv( const char* buf, std::string& csv, char delimiter, const boost::optional< unsigned int >& precision ) const
+{
+    csv.clear();
     const char* p = buf;
-    unsigned int offsetIndex = 0u; // index in elements_
-    unsigned int count = 0u;
-    for( unsigned int i = 0u; i < count_; ++i, ++count )
-    {
-        if( i > 0 ) { oss << delimiter; }
-        if( count >= elements_[ offsetIndex ].count ) { count = 0; ++offsetIndex; }
-        p += impl::bin_to_csv( oss, p, elements_[ offsetIndex ].type, elements_[ offsetIndex ].size, precision );
-    }
-    return oss.str();
+    for( std::size_t i = 0; i < codecs_.size(); p += codecs_[i].count * codecs_[i].size, ++i ) { codecs_[i].bin_to_csv( csv, p, codecs_[i].count, codecs_[i].size, delimiter, precision ); }
+    if( !csv.empty() ) { csv.resize( csv.size() - 1 ); } // trailing delimiter
+    return csv;
 }
 
 const std::vector< format::element >& format::elements() const { return elements_; }
@@ -29,6 +29,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <comma/base/exception.h>
 #include <comma/base/types.h>
+#include <comma/csv/impl/ascii_tokenizer.h>
 #include <comma/string/split.h>
 #include <comma/visiting/apply.h>
 #include <comma/visiting/visit.h>
@@ -109,12 +110,20 @@ class format
         std::string csv_to_bin( const std::string& csv, char delimiter = ',' ) const;
         std::string csv_to_bin( const std::vector< std::string >& csv ) const;
         
+        /// take csv fields (e.g. as split by impl::ascii_tokenizer), write binary to buf of size() bytes; return buf
+        char* csv_to_bin( char* buf, const std::vector< impl::ascii_field >& csv ) const;
+        
         /// take binary string, return csv
         std::string bin_to_csv( const char* bin, char delimiter = ',', const boost::optional< unsigned int >& precision = boost::optional< unsigned int >() ) const;
         
         /// take binary string, return csv
         std::string bin_to_csv( const std::string& bin, char delimiter = ',', const boost::optional< unsigned int >& precision = boost::optional< unsigned int >() ) const;
 
+        /// take binary string, put csv into a given string, reusing its storage; return csv
+        /// precision: number of significant digits for floating point, default: 6 for float, 16 for double;
+        ///            0: shortest representation that converts back to exactly the same value
+        const std::string& bin_to_csv( const char* bin, std::string& csv, char delimiter = ',', const boost::optional< unsigned int >& precision = boost::optional< unsigned int >() ) const;
+
         /// return as string
         const std::string& string() const;
         
@@ -136,9 +145,22 @@ class format
         static std::string to_format( types_enum type, unsigned int size );
                 
     private:
+        /// encoder and decoder of a run of fields of the same type (e.g. "100f" or "d,d,d"), resolved once on construction
+        struct codec
+        {
+            typedef void ( *csv_to_bin_function )( char* buf, const impl::ascii_field* fields, std::size_t count, std::size_t size );
+            typedef void ( *bin_to_csv_function )( std::string& csv, const char* buf, std::size_t count, std::size_t size, char delimiter, const boost::optional< unsigned int >& precision );
+            std::size_t count;
+            std::size_t size;
+            csv_to_bin_function csv_to_bin;
+            bin_to_csv_function bin_to_csv;
+            template < typename Run > static codec make( std::size_t count, std::size_t size ) { codec c; c.count = count; c.size = size; c.csv_to_bin = &Run::csv_to_bin; c.bin_to_csv = &Run::bin_to_csv; return c; }
+        };
         std::string string_;
         std::vector< types_enum > types_;
         std::vector< element > elements_;
+        std::vector< codec > codecs_;
+        void compile_();
         std::size_t size_;
         std::size_t count_;
         std::size_t elements_number_; /// total number of elements
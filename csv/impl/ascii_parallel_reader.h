@@ -0,0 +1,308 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_ASCII_PARALLEL_READER_HEADER_GUARD_
+#define COMMA_CSV_IMPL_ASCII_PARALLEL_READER_HEADER_GUARD_
+
+#include <string.h>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <comma/base/exception.h>
+#include "./ascii_tokenizer.h"
+
+namespace comma { namespace csv { namespace impl {
+
+/// order-preserving multi-threaded parser of ascii csv lines
+///
+/// the calling thread reads the stream in chunks of whole lines,
+/// worker threads split and parse the chunks into records,
+/// read() returns records in the original order
+///
+/// the calling thread blocks on the stream only if there are no chunks being parsed,
+/// i.e. as with ascii_tokenizer, records are delivered as soon as their lines are available
+///
+/// if parsing a line throws, the records before it are returned and then read() throws
+///
+/// @note since it reads ahead, do not read from the underlying stream directly, while the reader is in use
+template < typename T >
+class ascii_parallel_reader : public boost::noncopyable
+{
+    public:
+        /// parse record from line fields; called concurrently from worker threads
+        typedef boost::function< void( T&, const std::vector< ascii_field >& ) > parse_function;
+        
+        /// constructor
+        /// @param threads number of worker threads
+        /// @param chunk_size approximate size of chunk of lines given to a worker thread
+        ascii_parallel_reader( char delimiter, unsigned int threads, const parse_function& parse, const T& sample = T(), std::size_t chunk_size = 65536 );
+        
+        /// destructor: stop worker threads
+        ~ascii_parallel_reader();
+        
+        /// read next record; return NULL, if end of stream; the record is valid till the next read
+        const T* read( std::istream& is );
+        
+        /// return the last line read (without line terminator)
+        ascii_field line() const { return line_; }
+        
+        /// return fields of the last line read
+        const std::vector< ascii_field >& fields() const;
+        
+        /// return true, if next record is parsed already, i.e. read will not block
+        bool ready() const;
+        
+        /// return number of worker threads
+        unsigned int threads() const { return threads_.size(); }
+        
+    private:
+        struct chunk
+        {
+            std::vector< char > data;
+            std::vector< std::pair< std::size_t, std::size_t > > lines;
+            std::vector< T > records;
+            std::size_t size;
+            std::string error;
+            bool done;
+        };
+        typedef boost::shared_ptr< chunk > chunk_ptr;
+        char delimiter_;
+        parse_function parse_;
+        const T sample_;
+        std::size_t chunk_size_;
+        std::size_t max_chunks_;
+        std::vector< char > pending_; // incomplete line
+        std::size_t scanned_; // end of pending data already searched for end of line
+        std::size_t newline_; // end of last complete line in pending data, 0 if none
+        bool eof_;
+        chunk_ptr current_;
+        std::size_t index_;
+        std::deque< chunk_ptr > chunks_; // being parsed, in order
+        std::deque< chunk_ptr > queue_; // waiting for a worker
+        std::vector< chunk_ptr > free_;
+        mutable boost::mutex mutex_;
+        boost::condition_variable queued_;
+        boost::condition_variable parsed_;
+        bool shutdown_;
+        boost::thread_group threads_;
+        ascii_field line_;
+        mutable std::vector< ascii_field > fields_;
+        mutable bool fields_valid_;
+        chunk_ptr read_chunk_( std::istream& is, bool block );
+        void append_();
+        void work_();
+        void parse_chunk_( chunk& c, std::vector< ascii_field >& fields ) const;
+};
+
+template < typename T >
+inline ascii_parallel_reader< T >::ascii_parallel_reader( char delimiter, unsigned int threads, const parse_function& parse, const T& sample, std::size_t chunk_size )
+    : delimiter_( delimiter )
+    , parse_( parse )
+    , sample_( sample )
+    , chunk_size_( chunk_size ? chunk_size : 1 )
+    , max_chunks_( 2 * ( threads ? threads : 1 ) )
+    , scanned_( 0 )
+    , newline_( 0 )
+    , eof_( false )
+    , index_( 0 )
+    , shutdown_( false )
+    , fields_valid_( false )
+{
+    for( unsigned int i = 0; i < ( threads ? threads : 1 ); ++i ) { threads_.create_thread( boost::bind( &ascii_parallel_reader::work_, this ) ); }
+}
+
+template < typename T >
+inline ascii_parallel_reader< T >::~ascii_parallel_reader()
+{
+    {
+        boost::mutex::scoped_lock lock( mutex_ );
+        shutdown_ = true;
+    }
+    queued_.notify_all();
+    threads_.join_all();
+}
+
+template < typename T >
+inline const T* ascii_parallel_reader< T >::read( std::istream& is )
+{
+    fields_valid_ = false;
+    while( true )
+    {
+        if( current_ )
+        {
+            if( index_ < current_->size )
+            {
+                const std::pair< std::size_t, std::size_t >& l = current_->lines[ index_ ];
+                line_ = ascii_field( &current_->data[0] + l.first, l.second );
+                return &current_->records[ index_++ ];
+            }
+            line_ = ascii_field();
+            if( !current_->error.empty() ) { std::string error = current_->error; current_.reset(); COMMA_THROW( comma::exception, error ); }
+            free_.push_back( current_ );
+            current_.reset();
+        }
+        while( chunks_.size() < max_chunks_ )
+        {
+            chunk_ptr c = read_chunk_( is, chunks_.empty() );
+            if( !c ) { break; }
+            chunks_.push_back( c );
+            {
+                boost::mutex::scoped_lock lock( mutex_ );
+                queue_.push_back( c );
+            }
+            queued_.notify_one();
+        }
+        if( chunks_.empty() ) { return NULL; }
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            while( !chunks_.front()->done ) { parsed_.wait( lock ); }
+        }
+        current_ = chunks_.front();
+        chunks_.pop_front();
+        index_ = 0;
+    }
+}
+
+template < typename T >
+inline const std::vector< ascii_field >& ascii_parallel_reader< T >::fields() const
+{
+    if( fields_valid_ ) { return fields_; }
+    if( line_.data ) { split_fields( line_.data, line_.data + line_.size, delimiter_, fields_ ); } else { fields_.clear(); }
+    fields_valid_ = true;
+    return fields_;
+}
+
+template < typename T >
+inline bool ascii_parallel_reader< T >::ready() const
+{
+    if( current_ && ( index_ < current_->size || !current_->error.empty() ) ) { return true; }
+    if( chunks_.empty() ) { return false; }
+    boost::mutex::scoped_lock lock( mutex_ );
+    return chunks_.front()->done;
+}
+
+template < typename T >
+inline void ascii_parallel_reader< T >::append_() // search appended data for end of line
+{
+    for( std::size_t i = pending_.size(); i > scanned_; --i ) { if( pending_[ i - 1 ] == '\n' ) { newline_ = i; break; } }
+    scanned_ = pending_.size();
+}
+
+template < typename T >
+inline typename ascii_parallel_reader< T >::chunk_ptr ascii_parallel_reader< T >::read_chunk_( std::istream& is, bool block )
+{
+    std::streambuf* rdbuf = is.rdbuf();
+    while( !eof_ && !( newline_ > 0 && pending_.size() >= chunk_size_ ) )
+    {
+        std::streamsize available = is.good() ? rdbuf->in_avail() : -1;
+        if( available > 0 )
+        {
+            std::size_t size = static_cast< std::size_t >( available );
+            if( newline_ > 0 && size > chunk_size_ - pending_.size() ) { size = chunk_size_ - pending_.size(); }
+            std::size_t offset = pending_.size();
+            pending_.resize( offset + size );
+            pending_.resize( offset + rdbuf->sgetn( &pending_[0] + offset, size ) );
+            append_();
+            continue;
+        }
+        if( newline_ > 0 || !block ) { break; }
+        std::streambuf::int_type c = is.good() ? rdbuf->sbumpc() : std::streambuf::traits_type::eof(); // block for a single character, which pulls whatever is available into the stream buffer
+        if( std::streambuf::traits_type::eq_int_type( c, std::streambuf::traits_type::eof() ) ) { is.setstate( std::ios::eofbit ); eof_ = true; break; }
+        pending_.push_back( std::streambuf::traits_type::to_char_type( c ) );
+        append_();
+    }
+    std::size_t size = eof_ ? pending_.size() : newline_;
+    if( size == 0 ) { return chunk_ptr(); }
+    chunk_ptr c;
+    if( free_.empty() ) { c.reset( new chunk ); } else { c = free_.back(); free_.pop_back(); }
+    c->data.assign( pending_.begin(), pending_.begin() + size );
+    pending_.erase( pending_.begin(), pending_.begin() + size );
+    scanned_ = pending_.size(); // no end of line in the remainder
+    newline_ = 0;
+    c->size = 0;
+    c->error.clear();
+    c->done = false;
+    return c;
+}
+
+template < typename T >
+inline void ascii_parallel_reader< T >::work_()
+{
+    std::vector< ascii_field > fields;
+    while( true )
+    {
+        chunk_ptr c;
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            while( !shutdown_ && queue_.empty() ) { queued_.wait( lock ); }
+            if( shutdown_ ) { return; }
+            c = queue_.front();
+            queue_.pop_front();
+        }
+        parse_chunk_( *c, fields );
+        {
+            boost::mutex::scoped_lock lock( mutex_ );
+            c->done = true;
+        }
+        parsed_.notify_all();
+    }
+}
+
+template < typename T >
+inline void ascii_parallel_reader< T >::parse_chunk_( chunk& c, std::vector< ascii_field >& fields ) const
+{
+    c.lines.clear();
+    const char* data = c.data.empty() ? NULL : &c.data[0];
+    const char* end = data + c.data.size();
+    for( const char* begin = data; begin < end; )
+    {
+        const char* p = static_cast< const char* >( ::memchr( begin, '\n', end - begin ) );
+        if( !p ) { p = end; }
+        const char* e = p > begin && *( p - 1 ) == '\r' ? p - 1 : p; // windows... sigh...
+        if( e > begin ) { c.lines.push_back( std::make_pair( std::size_t( begin - data ), std::size_t( e - begin ) ) ); }
+        begin = p + 1;
+    }
+    if( c.records.size() < c.lines.size() ) { c.records.resize( c.lines.size(), sample_ ); }
+    for( c.size = 0; c.size < c.lines.size(); ++c.size )
+    {
+        const char* line = data + c.lines[ c.size ].first;
+        split_fields( line, line + c.lines[ c.size ].second, delimiter_, fields );
+        try
+        {
+            T& record = c.records[ c.size ];
+            record = sample_;
+            parse_( record, fields );
+        }
+        catch( std::exception& ex ) { c.error = ex.what(); return; }
+        catch( ... ) { c.error = "unknown exception"; return; }
+    }
+}
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_ASCII_PARALLEL_READER_HEADER_GUARD_
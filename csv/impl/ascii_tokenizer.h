@@ -0,0 +1,171 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_ASCII_TOKENIZER_HEADER_GUARD_
+#define COMMA_CSV_IMPL_ASCII_TOKENIZER_HEADER_GUARD_
+
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <comma/string/split.h>
+
+namespace comma { namespace csv { namespace impl {
+
+/// non-owning view of a field in a line; valid till the next read
+typedef comma::span ascii_field;
+
+/// split line [begin, end) into fields in place
+inline void split_fields( const char* begin, const char* end, char delimiter, std::vector< ascii_field >& fields )
+{
+    fields.clear();
+    while( true )
+    {
+        const char* p = static_cast< const char* >( ::memchr( begin, delimiter, end - begin ) );
+        if( !p ) { fields.push_back( ascii_field( begin, end - begin ) ); return; }
+        fields.push_back( ascii_field( begin, p - begin ) );
+        begin = p + 1;
+    }
+}
+
+/// reads lines from a stream in large blocks and splits them in place,
+/// without allocating strings per line or per field
+/// @note since it reads ahead, do not read from the underlying stream
+///       directly, while the tokenizer is in use
+class ascii_tokenizer
+{
+    public:
+        /// constructor
+        ascii_tokenizer( char delimiter = ',', std::size_t block_size = 65536 );
+
+        /// read next non-empty line and split it; return false, if end of stream
+        bool read( std::istream& is );
+
+        /// return fields of the last line read
+        const std::vector< ascii_field >& fields() const { return fields_; }
+
+        /// return the last line read (without line terminator)
+        ascii_field line() const { return line_; }
+
+        /// return delimiter
+        char delimiter() const { return delimiter_; }
+
+        /// return true, if a complete line is buffered, i.e. read will not block
+        bool ready() const;
+
+        /// read up to size bytes, which must be available without blocking,
+        /// appending them to the incomplete line buffered; return number of bytes read
+        std::size_t fill( std::istream& is, std::size_t size );
+
+    private:
+        char delimiter_;
+        std::vector< char > buf_;
+        std::size_t begin_; // beginning of unconsumed data
+        std::size_t scanned_; // end of data already searched for end of line
+        std::size_t end_; // end of data in the buffer
+        ascii_field line_;
+        std::vector< ascii_field > fields_;
+        bool fill_( std::istream& is );
+        void reserve_();
+};
+
+inline ascii_tokenizer::ascii_tokenizer( char delimiter, std::size_t block_size )
+    : delimiter_( delimiter )
+    , buf_( block_size ? block_size : 1 )
+    , begin_( 0 )
+    , scanned_( 0 )
+    , end_( 0 )
+{
+}
+
+inline bool ascii_tokenizer::read( std::istream& is )
+{
+    while( true )
+    {
+        const char* p = end_ > scanned_ ? static_cast< const char* >( ::memchr( &buf_[0] + scanned_, '\n', end_ - scanned_ ) ) : NULL;
+        if( !p )
+        {
+            scanned_ = end_;
+            if( fill_( is ) ) { continue; }
+            if( begin_ == end_ ) { fields_.clear(); line_ = ascii_field(); return false; }
+            p = &buf_[0] + end_; // last line without end of line
+        }
+        const char* begin = &buf_[0] + begin_;
+        const char* end = p;
+        begin_ = scanned_ = p == &buf_[0] + end_ ? end_ : p + 1 - &buf_[0];
+        if( end > begin && *( end - 1 ) == '\r' ) { --end; } // windows... sigh...
+        if( end == begin ) { continue; }
+        line_ = ascii_field( begin, end - begin );
+        split_fields( begin, end, delimiter_, fields_ );
+        return true;
+    }
+}
+
+inline bool ascii_tokenizer::ready() const
+{
+    return end_ > scanned_ && ::memchr( &buf_[0] + scanned_, '\n', end_ - scanned_ ) != NULL;
+}
+
+inline std::size_t ascii_tokenizer::fill( std::istream& is, std::size_t size )
+{
+    if( size == 0 || !is.good() ) { return 0; }
+    reserve_();
+    if( size > buf_.size() - end_ ) { size = buf_.size() - end_; }
+    is.read( &buf_[0] + end_, size );
+    end_ += is.gcount();
+    return is.gcount();
+}
+
+inline void ascii_tokenizer::reserve_()
+{
+    if( begin_ > 0 ) // move the incomplete line to the beginning of the buffer
+    {
+        ::memmove( &buf_[0], &buf_[0] + begin_, end_ - begin_ );
+        end_ -= begin_;
+        scanned_ -= begin_;
+        begin_ = 0;
+    }
+    if( end_ == buf_.size() ) { buf_.resize( buf_.size() * 2 ); } // line longer than the buffer
+}
+
+inline bool ascii_tokenizer::fill_( std::istream& is )
+{
+    if( !is.good() ) { return false; }
+    reserve_();
+    std::streambuf* rdbuf = is.rdbuf();
+    std::streamsize available = rdbuf->in_avail();
+    if( available <= 0 ) // nothing buffered: block for a single character, which pulls whatever is available into the stream buffer
+    {
+        std::streambuf::int_type c = rdbuf->sbumpc();
+        if( std::streambuf::traits_type::eq_int_type( c, std::streambuf::traits_type::eof() ) ) { is.setstate( std::ios::eofbit ); return false; }
+        buf_[ end_++ ] = std::streambuf::traits_type::to_char_type( c );
+        available = rdbuf->in_avail();
+    }
+    if( available > 0 )
+    {
+        std::size_t size = buf_.size() - end_;
+        if( static_cast< std::size_t >( available ) < size ) { size = available; }
+        end_ += rdbuf->sgetn( &buf_[0] + end_, size );
+    }
+    return true;
+}
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_ASCII_TOKENIZER_HEADER_GUARD_
@@ -0,0 +1,190 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_BINARY_PLAN_HEADER_GUARD_
+#define COMMA_CSV_IMPL_BINARY_PLAN_HEADER_GUARD_
+
+#include <string.h>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits.hpp>
+#include <comma/csv/format.h>
+#include <comma/visiting/apply.h>
+#include <comma/visiting/visit.h>
+#include <comma/visiting/while.h>
+#include "./from_binary.h"
+#include "./to_binary.h"
+
+namespace comma { namespace csv { namespace impl {
+
+/// flat list of copy operations between a binary record and a struct,
+/// compiled once from field offsets, so that get/put do not need to visit the struct
+///
+/// fields of the same type laid out contiguously in both the record and the struct
+/// are coalesced into a single memcpy; fields needing conversion (e.g. time, strings,
+/// different numeric types) are copied by functions compiled for their type
+///
+/// a plan is not valid (and visiting should be used instead) if the struct has
+/// optional or pointer members or fields not stored inside the struct (e.g. in std::vector)
+class binary_plan
+{
+    public:
+        /// copy from buffer to a field at given address
+        typedef void ( *get_function )( char* value, const char* buf, std::size_t size, format::types_enum type );
+        
+        /// copy from a field at given address to buffer
+        typedef void ( *put_function )( char* buf, const char* value, std::size_t size, format::types_enum type );
+        
+        /// copy operation
+        struct operation
+        {
+            std::size_t source; /// offset in binary record
+            std::size_t destination; /// offset in struct
+            std::size_t size; /// size in binary record
+            format::types_enum type; /// type in binary record
+            get_function get; /// null for memcpy
+            put_function put; /// null for memcpy
+        };
+        
+        /// default constructor: invalid plan
+        binary_plan() : valid_( false ) {}
+        
+        /// constructor from offsets as in binary_visitor::offsets()
+        template < typename S >
+        binary_plan( const std::vector< boost::optional< format::element > >& offsets, const S& sample );
+        
+        /// return true, if plan can be used
+        bool valid() const { return valid_; }
+        
+        /// return operations
+        const std::vector< operation >& operations() const { return operations_; }
+        
+        /// copy fields from buffer to struct
+        void get( char* s, const char* buf ) const;
+        
+        /// copy fields from struct to buffer
+        void put( const char* s, char* buf ) const;
+        
+        /// visitor building the plan
+        class visitor;
+        
+    private:
+        bool valid_;
+        std::vector< operation > operations_;
+};
+
+class binary_plan::visitor
+{
+    public:
+        visitor( const std::vector< boost::optional< format::element > >& offsets, const char* begin, const char* end, std::vector< operation >& operations )
+            : offsets_( offsets ), begin_( begin ), end_( end ), operations_( operations ), index_( 0 ), valid_( true ) {}
+        
+        template < typename K, typename T > void apply( const K&, const boost::optional< T >& ) { valid_ = false; }
+        
+        template < typename K, typename T > void apply( const K&, const boost::scoped_ptr< T >& ) { valid_ = false; }
+        
+        template < typename K, typename T > void apply( const K&, const boost::shared_ptr< T >& ) { valid_ = false; }
+        
+        template < typename K, typename T > void apply( const K& name, const T& value )
+        {
+            visiting::do_while<    !boost::is_fundamental< T >::value
+                                && !boost::is_same< T, std::string >::value
+                                && !boost::is_same< T, boost::posix_time::ptime >::value >::visit( name, value, *this );
+        }
+        
+        template < typename K, typename T > void apply_next( const K& name, const T& value ) { comma::visiting::visit( name, value, *this ); }
+        
+        template < typename K, typename T > void apply_final( const K&, const T& value )
+        {
+            const char* address = reinterpret_cast< const char* >( &value );
+            if( address < begin_ || address + sizeof( T ) > end_ ) { valid_ = false; }
+            if( !valid_ || index_ >= offsets_.size() ) { valid_ = false; return; }
+            const boost::optional< format::element >& e = offsets_[ index_++ ];
+            if( !e ) { return; }
+            operation o;
+            o.source = e->offset;
+            o.destination = address - begin_;
+            o.size = e->size;
+            o.type = e->type;
+            bool plain = boost::is_arithmetic< T >::value && e->type == format::traits< T >::type && e->size == sizeof( T );
+            o.get = plain ? NULL : &get_< T >;
+            o.put = plain ? NULL : &put_< T >;
+            operations_.push_back( o );
+        }
+        
+        bool valid() const { return valid_ && index_ == offsets_.size(); }
+        
+    private:
+        const std::vector< boost::optional< format::element > >& offsets_;
+        const char* begin_;
+        const char* end_;
+        std::vector< operation >& operations_;
+        std::size_t index_;
+        bool valid_;
+        template < typename T > static void get_( char* value, const char* buf, std::size_t size, format::types_enum type ) { frobinary_::copy( *reinterpret_cast< T* >( value ), buf, size, type ); }
+        template < typename T > static void put_( char* buf, const char* value, std::size_t size, format::types_enum type ) { to_binary::copy( buf, *reinterpret_cast< const T* >( value ), size, type ); }
+};
+
+template < typename S >
+inline binary_plan::binary_plan( const std::vector< boost::optional< format::element > >& offsets, const S& sample )
+{
+    const char* begin = reinterpret_cast< const char* >( &sample );
+    std::vector< operation > operations;
+    visitor v( offsets, begin, begin + sizeof( S ), operations );
+    visiting::apply( v, sample );
+    valid_ = v.valid();
+    if( !valid_ ) { return; }
+    for( std::size_t i = 0; i < operations.size(); ++i )
+    {
+        if( !operations_.empty() )
+        {
+            operation& last = operations_.back();
+            if(    !last.get && !operations[i].get
+                && last.source + last.size == operations[i].source
+                && last.destination + last.size == operations[i].destination ) { last.size += operations[i].size; continue; }
+        }
+        operations_.push_back( operations[i] );
+    }
+}
+
+inline void binary_plan::get( char* s, const char* buf ) const
+{
+    for( std::size_t i = 0; i < operations_.size(); ++i )
+    {
+        const operation& o = operations_[i];
+        if( o.get ) { o.get( s + o.destination, buf + o.source, o.size, o.type ); }
+        else { ::memcpy( s + o.destination, buf + o.source, o.size ); }
+    }
+}
+
+inline void binary_plan::put( const char* s, char* buf ) const
+{
+    for( std::size_t i = 0; i < operations_.size(); ++i )
+    {
+        const operation& o = operations_[i];
+        if( o.put ) { o.put( buf + o.source, s + o.destination, o.size, o.type ); }
+        else { ::memcpy( buf + o.source, s + o.destination, o.size ); }
+    }
+}
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_BINARY_PLAN_HEADER_GUARD_
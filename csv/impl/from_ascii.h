@@ -21,27 +21,37 @@
 
 #include <deque>
 #include <vector>
-#include <boost/lexical_cast.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/type_traits.hpp>
 #include <comma/base/exception.h>
+#include <comma/csv/impl/ascii_tokenizer.h>
+#include <comma/csv/impl/iso_time.h>
+#include <comma/csv/impl/parse.h>
+#include <comma/string/string.h>
 #include <comma/visiting/visit.h>
 #include <comma/visiting/while.h>
 
 namespace comma { namespace csv { namespace impl {
 
+inline const char* field_data( const std::string& s ) { return s.data(); }
+inline std::size_t field_size( const std::string& s ) { return s.size(); }
+inline const char* field_data( const ascii_field& f ) { return f.data; }
+inline std::size_t field_size( const ascii_field& f ) { return f.size; }
+
 /// visitor loading a struct from a csv file
+/// the line is either a vector of strings or a vector of ascii_field views
 /// see unit test for usage
+template < typename Row = std::vector< std::string > >
 class from_ascii_
 {
     public:
         /// constructor
         from_ascii_( const std::vector< boost::optional< std::size_t > >& indices
                   , const std::deque< bool >& optional
-                  , const std::vector< std::string >& line );
+                  , const Row& line );
         
         /// apply
         template < typename K, typename T > void apply( const K& name, boost::optional< T >& value );
@@ -64,21 +74,23 @@ class from_ascii_
     private:
         const std::vector< boost::optional< std::size_t > >& indices_;
         const std::deque< bool >& optional_;
-        const std::vector< std::string >& row_;
+        const Row& row_;
         std::size_t index_;
         std::size_t optional_index;
-        static void lexical_cast_( char& v, const std::string& s ) { v = s.at( 0 ) == '\'' && s.at( 2 ) == '\'' && s.length() == 3 ? s.at( 1 ) : static_cast< char >( boost::lexical_cast< int >( s ) ); }
-        static void lexical_cast_( unsigned char& v, const std::string& s ) { v = s.at( 0 ) == '\'' && s.at( 2 ) == '\'' && s.length() == 3 ? s.at( 1 ) : static_cast< unsigned char >( boost::lexical_cast< unsigned int >( s ) ); }
-        static void lexical_cast_( boost::posix_time::ptime& v, const std::string& s ) { v = boost::posix_time::from_iso_string( s ); }
-        static void lexical_cast_( std::string& v, const std::string& s ) { v = comma::strip( s, "\"" ); }
-        static void lexical_cast_( bool& v, const std::string& s ) { v = static_cast< bool >( boost::lexical_cast< unsigned int >( s ) ); }
+        static bool is_quoted_char_( const char* s, std::size_t size ) { return size == 3 && s[0] == '\'' && s[2] == '\''; }
+        static void lexical_cast_( char& v, const char* s, std::size_t size ) { v = is_quoted_char_( s, size ) ? s[1] : static_cast< char >( impl::parse< int >( s, size ) ); }
+        static void lexical_cast_( unsigned char& v, const char* s, std::size_t size ) { v = is_quoted_char_( s, size ) ? s[1] : static_cast< unsigned char >( impl::parse< unsigned int >( s, size ) ); }
+        static void lexical_cast_( boost::posix_time::ptime& v, const char* s, std::size_t size ) { v = impl::from_iso_string( s, size ); }
+        static void lexical_cast_( std::string& v, const char* s, std::size_t size ) { v = comma::strip( std::string( s, size ), "\"" ); }
+        static void lexical_cast_( bool& v, const char* s, std::size_t size ) { v = static_cast< bool >( impl::parse< unsigned int >( s, size ) ); }
         template < typename T >
-        static void lexical_cast_( T& v, const std::string& s ) { v = boost::lexical_cast< T >( s ); }        
+        static void lexical_cast_( T& v, const char* s, std::size_t size ) { v = impl::parse< T >( s, size ); }
 };
 
-inline from_ascii_::from_ascii_( const std::vector< boost::optional< std::size_t > >& indices
+template < typename Row >
+inline from_ascii_< Row >::from_ascii_( const std::vector< boost::optional< std::size_t > >& indices
                            , const std::deque< bool >& optional
-                           , const std::vector< std::string >& line )
+                           , const Row& line )
     : indices_( indices )
     , optional_( optional )
     , row_( line )
@@ -87,51 +99,57 @@ inline from_ascii_::from_ascii_( const std::vector< boost::optional< std::size_t
 {
 }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply( const K& name, boost::optional< T >& value ) // todo: watch performance
+inline void from_ascii_< Row >::apply( const K& name, boost::optional< T >& value ) // todo: watch performance
 {
     if( !value && optional_[optional_index++] ) { value = T(); }
     if( value ) { this->apply( name, *value ); }
     else { ++index_; }
 }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply( const K& name, boost::scoped_ptr< T >& value ) // todo: watch performance
+inline void from_ascii_< Row >::apply( const K& name, boost::scoped_ptr< T >& value ) // todo: watch performance
 {
     if( !value && optional_[optional_index++] ) { value = T(); }
     if( value ) { this->apply( name, *value ); }
     else { ++index_; }
 }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply( const K& name, boost::shared_ptr< T >& value ) // todo: watch performance
+inline void from_ascii_< Row >::apply( const K& name, boost::shared_ptr< T >& value ) // todo: watch performance
 {
     if( !value && optional_[optional_index++] ) { value = T(); }
     if( value ) { this->apply( name, *value ); }
     else { ++index_; }
 }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply( const K& name, T& value )
+inline void from_ascii_< Row >::apply( const K& name, T& value )
 {
     visiting::do_while<    !boost::is_fundamental< T >::value
                         && !boost::is_same< T, std::string >::value
                         && !boost::is_same< T, boost::posix_time::ptime >::value >::visit( name, value, *this );
 }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply_next( const K& name, T& value ) { comma::visiting::visit( name, value, *this ); }
+inline void from_ascii_< Row >::apply_next( const K& name, T& value ) { comma::visiting::visit( name, value, *this ); }
 
+template < typename Row >
 template < typename K, typename T >
-inline void from_ascii_::apply_final( const K& key, T& value )
+inline void from_ascii_< Row >::apply_final( const K& key, T& value )
 { 
 	(void)key;
     if( indices_[ index_ ] )
     {
         std::size_t i = *indices_[ index_ ];
         if( i >= row_.size() ) { COMMA_THROW( comma::exception, "got column index " << i << ", for " << row_.size() << " column(s) in line: \"" << join( row_, ',' ) << "\"" ); }
-        const std::string& s = row_[i];
-        if( !s.empty() ) { lexical_cast_( value, s ); }
+        std::size_t size = field_size( row_[i] );
+        if( size > 0 ) { lexical_cast_( value, field_data( row_[i] ), size ); }
     }
     ++index_;
 }
@@ -62,6 +62,9 @@ class frobinary_
         /// apply to leaf elements
         template < typename K, typename T > void apply_final( const K& name, T& value );
         
+        /// copy value from buffer, converting it, if binary type does not match T
+        template < typename T > static void copy( T& value, const char* buf, std::size_t size, format::types_enum type );
+        
     private:
         const std::vector< boost::optional< format::element > >& offsets_;
         const std::deque< bool >& optional_;
@@ -134,37 +137,35 @@ template < typename K, typename T >
 inline void frobinary_::apply_final( const K&, T& value )
 {
     //if( offsets_[ index_ ] ) { copy( value, buf_ + offsets_[ index_ ]->offset, offsets_[ index_ ]->size ); }
-    if( offsets_[ index_ ] )
+    if( offsets_[ index_ ] ) { copy( value, buf_ + offsets_[ index_ ]->offset, offsets_[ index_ ]->size, offsets_[ index_ ]->type ); }
+    ++index_;
+}
+
+template < typename T >
+inline void frobinary_::copy( T& value, const char* buf, std::size_t size, format::types_enum type )
+{
+    if( type == format::traits< T >::type ) // quick path
     {
-        const char* buf = buf_ + offsets_[ index_ ]->offset;
-        std::size_t size = offsets_[ index_ ]->size;
-        format::types_enum type = offsets_[ index_ ]->type;
-        if( type == format::traits< T >::type ) // quick path
-        {
-            value = format::traits< T >::from_bin( buf, size ); // copy( value, buf, size );
-        }
-        else
-        {
-            switch( type )
-            {
-                case format::int8: value = static_cast_impl< T >::value( format::traits< char >::from_bin( buf ) ); break;
-                case format::uint8: value = static_cast_impl< T >::value( format::traits< unsigned char >::from_bin( buf ) ); break;
-                case format::int16: value = static_cast_impl< T >::value( format::traits< comma::int16 >::from_bin( buf ) ); break;
-                case format::uint16: value = static_cast_impl< T >::value( format::traits< comma::uint16 >::from_bin( buf ) ); break;
-                case format::int32: value = static_cast_impl< T >::value( format::traits< comma::int32 >::from_bin( buf ) ); break;
-                case format::uint32: value = static_cast_impl< T >::value( format::traits< comma::uint32 >::from_bin( buf ) ); break;
-                case format::int64: value = static_cast_impl< T >::value( format::traits< comma::int64 >::from_bin( buf ) ); break;
-                case format::uint64: value = static_cast_impl< T >::value( format::traits< comma::uint64 >::from_bin( buf ) ); break;
-                case format::char_t: value = static_cast_impl< T >::value( format::traits< char >::from_bin( buf ) ); break;
-                case format::float_t: value = static_cast_impl< T >::value( format::traits< float >::from_bin( buf ) ); break;
-                case format::double_t: value = static_cast_impl< T >::value( format::traits< double >::from_bin( buf ) ); break;
-                case format::time: value = static_cast_impl< T >::value( format::traits< boost::posix_time::ptime, format::time >::from_bin( buf ) ); break;
-                case format::long_time: value = static_cast_impl< T >::value( format::traits< boost::posix_time::ptime, format::long_time >::from_bin( buf ) ); break;
-                case format::fixed_string: value = static_cast_impl< T >::value( format::traits< std::string >::from_bin( buf, size ) ); break;
-            };
-        }
+        value = format::traits< T >::from_bin( buf, size ); // copy( value, buf, size );
+        return;
     }
-    ++index_;
+    switch( type )
+    {
+        case format::int8: value = static_cast_impl< T >::value( format::traits< char >::from_bin( buf ) ); break;
+        case format::uint8: value = static_cast_impl< T >::value( format::traits< unsigned char >::from_bin( buf ) ); break;
+        case format::int16: value = static_cast_impl< T >::value( format::traits< comma::int16 >::from_bin( buf ) ); break;
+        case format::uint16: value = static_cast_impl< T >::value( format::traits< comma::uint16 >::from_bin( buf ) ); break;
+        case format::int32: value = static_cast_impl< T >::value( format::traits< comma::int32 >::from_bin( buf ) ); break;
+        case format::uint32: value = static_cast_impl< T >::value( format::traits< comma::uint32 >::from_bin( buf ) ); break;
+        case format::int64: value = static_cast_impl< T >::value( format::traits< comma::int64 >::from_bin( buf ) ); break;
+        case format::uint64: value = static_cast_impl< T >::value( format::traits< comma::uint64 >::from_bin( buf ) ); break;
+        case format::char_t: value = static_cast_impl< T >::value( format::traits< char >::from_bin( buf ) ); break;
+        case format::float_t: value = static_cast_impl< T >::value( format::traits< float >::from_bin( buf ) ); break;
+        case format::double_t: value = static_cast_impl< T >::value( format::traits< double >::from_bin( buf ) ); break;
+        case format::time: value = static_cast_impl< T >::value( format::traits< boost::posix_time::ptime, format::time >::from_bin( buf ) ); break;
+        case format::long_time: value = static_cast_impl< T >::value( format::traits< boost::posix_time::ptime, format::long_time >::from_bin( buf ) ); break;
+        case format::fixed_string: value = static_cast_impl< T >::value( format::traits< std::string >::from_bin( buf, size ) ); break;
+    };
 }
 
 } } } // namespace comma { namespace csv { namespace impl {
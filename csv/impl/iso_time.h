@@ -0,0 +1,130 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_ISO_TIME_HEADER_GUARD_
+#define COMMA_CSV_IMPL_ISO_TIME_HEADER_GUARD_
+
+#include <string.h>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
+
+namespace comma { namespace csv { namespace impl {
+
+/// fast conversion of time to and from iso format: YYYYMMDDTHHMMSS[.ffffff],
+/// a replacement for boost::posix_time::from_iso_string() and to_iso_string()
+/// on character ranges, without allocations
+///
+/// the results (including exceptions on invalid dates) are exactly the same as boost's:
+/// the fixed layout above is converted directly, anything else (e.g. not-a-date-time)
+/// is passed to boost::posix_time::from_iso_string()
+///
+/// the buffer for to_iso_string must be at least iso_time_size bytes long;
+/// returns end of printed characters (no terminating zero)
+enum { iso_time_size = 32 };
+
+namespace iso_time_impl {
+
+inline bool digits( const char* s, unsigned int n, unsigned int& v )
+{
+    v = 0;
+    for( const char* end = s + n; s < end; ++s )
+    {
+        unsigned int d = static_cast< unsigned char >( *s ) - '0';
+        if( d > 9 ) { return false; }
+        v = v * 10 + d;
+    }
+    return true;
+}
+
+inline char* print_digits( char* buf, unsigned int v, unsigned int n )
+{
+    for( char* p = buf + n; p > buf; v /= 10 ) { *--p = '0' + v % 10; }
+    return buf + n;
+}
+
+} // namespace iso_time_impl {
+
+/// parse time in iso format
+inline boost::posix_time::ptime from_iso_string( const char* s, std::size_t size )
+{
+    unsigned int year, month, day, hours, minutes, seconds;
+    if(    ( size == 15 || ( size > 16 && ( s[15] == '.' || s[15] == ',' ) ) )
+        && s[8] == 'T'
+        && iso_time_impl::digits( s, 4, year )
+        && iso_time_impl::digits( s + 4, 2, month )
+        && iso_time_impl::digits( s + 6, 2, day )
+        && iso_time_impl::digits( s + 9, 2, hours )
+        && iso_time_impl::digits( s + 11, 2, minutes )
+        && iso_time_impl::digits( s + 13, 2, seconds ) )
+    {
+        unsigned int fraction = 0;
+        if( size > 16 )
+        {
+            static const unsigned int precision = boost::posix_time::time_duration::num_fractional_digits();
+            unsigned int n = size - 16;
+            if( !iso_time_impl::digits( s + 16, n < precision ? n : precision, fraction ) ) { return boost::posix_time::from_iso_string( std::string( s, size ) ); }
+            for( ; n < precision; ++n ) { fraction *= 10; }
+            for( const char* p = s + 16 + precision; p < s + size; ++p ) // extra digits are truncated
+            {
+                if( static_cast< unsigned int >( static_cast< unsigned char >( *p ) - '0' ) > 9 ) { return boost::posix_time::from_iso_string( std::string( s, size ) ); }
+            }
+        }
+        return boost::posix_time::ptime( boost::gregorian::date( year, month, day ), boost::posix_time::time_duration( hours, minutes, seconds, fraction ) );
+    }
+    return boost::posix_time::from_iso_string( std::string( s, size ) );
+}
+
+/// parse time in iso format
+inline boost::posix_time::ptime from_iso_string( const std::string& s ) { return from_iso_string( s.data(), s.size() ); }
+
+/// print time in iso format
+inline char* to_iso_string( char* buf, const boost::posix_time::ptime& t )
+{
+    if( t.is_special() )
+    {
+        const std::string& s = boost::posix_time::to_iso_string( t );
+        ::memcpy( buf, s.data(), s.size() );
+        return buf + s.size();
+    }
+    boost::gregorian::date::ymd_type ymd = t.date().year_month_day();
+    boost::posix_time::time_duration d = t.time_of_day();
+    buf = iso_time_impl::print_digits( buf, ymd.year, 4 );
+    buf = iso_time_impl::print_digits( buf, ymd.month, 2 );
+    buf = iso_time_impl::print_digits( buf, ymd.day, 2 );
+    *buf++ = 'T';
+    buf = iso_time_impl::print_digits( buf, d.hours(), 2 );
+    buf = iso_time_impl::print_digits( buf, d.minutes(), 2 );
+    buf = iso_time_impl::print_digits( buf, d.seconds(), 2 );
+    comma::int64 fraction = d.fractional_seconds();
+    if( fraction == 0 ) { return buf; }
+    *buf++ = '.';
+    return iso_time_impl::print_digits( buf, static_cast< unsigned int >( fraction ), boost::posix_time::time_duration::num_fractional_digits() );
+}
+
+/// print time in iso format
+inline std::string to_iso_string( const boost::posix_time::ptime& t )
+{
+    char buf[ iso_time_size ];
+    return std::string( buf, to_iso_string( buf, t ) );
+}
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_ISO_TIME_HEADER_GUARD_
@@ -0,0 +1,239 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_PARSE_HEADER_GUARD_
+#define COMMA_CSV_IMPL_PARSE_HEADER_GUARD_
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <boost/type_traits.hpp>
+#include <comma/base/exception.h>
+#include <comma/base/types.h>
+
+namespace comma { namespace csv { namespace impl {
+
+/// locale-free parsing of numbers from character ranges,
+/// a faster replacement for boost::lexical_cast in csv
+///
+/// accepted: [+-]digits for integers;
+///           [+-]digits[.digits][(e|E)[+-]digits], nan, inf, infinity (case-insensitive) for floating point
+///
+/// floating point conversion is exact (correctly rounded): the most common values
+/// (up to 19 significant digits with a small exponent) are converted directly,
+/// the rest falls back to strtod()
+///
+/// @todo add the rest of the types when needed (e.g. for hex numbers)
+namespace parse_impl {
+
+template < typename T, bool Signed = std::numeric_limits< T >::is_signed > struct integer;
+
+template < typename T > struct integer< T, false >
+{
+    static bool parse( const char* s, const char* end, T& v )
+    {
+        if( s < end && *s == '+' ) { ++s; }
+        if( s == end ) { return false; }
+        T r = 0;
+        static const T max = std::numeric_limits< T >::max();
+        for( ; s < end; ++s )
+        {
+            unsigned int d = static_cast< unsigned char >( *s ) - '0';
+            if( d > 9 ) { return false; }
+            if( r > ( max - d ) / 10 ) { return false; } // overflow
+            r = r * 10 + d;
+        }
+        v = r;
+        return true;
+    }
+};
+
+template < typename T > struct integer< T, true >
+{
+    static bool parse( const char* s, const char* end, T& v )
+    {
+        typedef typename boost::make_unsigned< T >::type unsigned_type;
+        bool negative = s < end && *s == '-';
+        if( negative ) { ++s; } else if( s < end && *s == '+' ) { ++s; }
+        if( s == end ) { return false; }
+        const unsigned_type limit = static_cast< unsigned_type >( std::numeric_limits< T >::max() ) + ( negative ? 1 : 0 );
+        unsigned_type r = 0;
+        for( ; s < end; ++s )
+        {
+            unsigned int d = static_cast< unsigned char >( *s ) - '0';
+            if( d > 9 ) { return false; }
+            if( r > ( limit - d ) / 10 ) { return false; } // overflow
+            r = r * 10 + d;
+        }
+        v = negative ? static_cast< T >( unsigned_type( 0 ) - r ) : static_cast< T >( r );
+        return true;
+    }
+};
+
+/// floating point traits
+template < typename T > struct floating;
+
+template <> struct floating< float >
+{
+    static const comma::uint64 max_exact_mantissa = comma::uint64( 1 ) << 24;
+    static const int max_exact_exponent = 10;
+    static float strto( const char* s, char** end ) { return ::strtof( s, end ); }
+};
+
+template <> struct floating< double >
+{
+    static const comma::uint64 max_exact_mantissa = comma::uint64( 1 ) << 53;
+    static const int max_exact_exponent = 22;
+    static double strto( const char* s, char** end ) { return ::strtod( s, end ); }
+};
+
+template <> struct floating< long double >
+{
+    static const comma::uint64 max_exact_mantissa = std::numeric_limits< long double >::digits >= 64 ? ~comma::uint64( 0 ) : comma::uint64( 1 ) << ( std::numeric_limits< long double >::digits % 64 );
+    static const int max_exact_exponent = std::numeric_limits< long double >::digits >= 64 ? 27 : 22;
+    static long double strto( const char* s, char** end ) { return ::strtold( s, end ); }
+};
+
+inline bool equal_no_case( const char* s, const char* end, const char* lowercase )
+{
+    for( ; s < end; ++s, ++lowercase ) { if( *lowercase == 0 || ( *s | 0x20 ) != *lowercase ) { return false; } }
+    return *lowercase == 0;
+}
+
+template < typename T >
+inline T power_of_ten( int e ) // exact for e <= floating< T >::max_exact_exponent
+{
+    T p = 1;
+    T b = 10;
+    for( ; e > 0; e >>= 1, b *= b ) { if( e & 1 ) { p *= b; } }
+    return p;
+}
+
+template < typename T >
+inline bool slow_path( const char* begin, const char* end, T& v )
+{
+    char buf[64];
+    std::string s;
+    const char* p;
+    std::size_t size = end - begin;
+    if( size < sizeof( buf ) ) { ::memcpy( buf, begin, size ); buf[size] = 0; p = buf; }
+    else { s.assign( begin, size ); p = s.c_str(); }
+    char* e;
+    errno = 0;
+    T t = floating< T >::strto( p, &e );
+    if( e != p + size ) { return false; }
+    if( errno == ERANGE && std::fabs( t ) > 1 ) { return false; } // overflow, but let underflow be
+    v = t;
+    return true;
+}
+
+template < typename T >
+inline bool parse_floating( const char* begin, const char* end, T& v )
+{
+    const char* s = begin;
+    bool negative = s < end && *s == '-';
+    if( negative || ( s < end && *s == '+' ) ) { ++s; }
+    if( s == end ) { return false; }
+    if( *s > '9' ) // quick check for nan and infinity
+    {
+        if( equal_no_case( s, end, "nan" ) ) { v = std::numeric_limits< T >::quiet_NaN(); return true; }
+        if( equal_no_case( s, end, "inf" ) || equal_no_case( s, end, "infinity" ) ) { v = negative ? -std::numeric_limits< T >::infinity() : std::numeric_limits< T >::infinity(); return true; }
+        return false;
+    }
+    comma::uint64 mantissa = 0;
+    unsigned int digits = 0; // significant digits in mantissa
+    bool truncated = false;
+    bool has_digits = false;
+    int exponent = 0;
+    for( ; s < end && static_cast< unsigned int >( *s - '0' ) < 10; ++s )
+    {
+        has_digits = true;
+        if( digits < 19 ) { mantissa = mantissa * 10 + ( *s - '0' ); if( mantissa ) { ++digits; } }
+        else { ++exponent; truncated = truncated || *s != '0'; }
+    }
+    if( s < end && *s == '.' )
+    {
+        for( ++s; s < end && static_cast< unsigned int >( *s - '0' ) < 10; ++s )
+        {
+            has_digits = true;
+            if( digits < 19 ) { mantissa = mantissa * 10 + ( *s - '0' ); if( mantissa ) { ++digits; } --exponent; }
+            else { truncated = truncated || *s != '0'; }
+        }
+    }
+    if( !has_digits ) { return false; }
+    if( s < end && ( *s == 'e' || *s == 'E' ) )
+    {
+        ++s;
+        bool negative_exponent = s < end && *s == '-';
+        if( negative_exponent || ( s < end && *s == '+' ) ) { ++s; }
+        if( s == end ) { return false; }
+        int e = 0;
+        for( ; s < end; ++s )
+        {
+            unsigned int d = static_cast< unsigned char >( *s ) - '0';
+            if( d > 9 ) { return false; }
+            if( e < 100000 ) { e = e * 10 + d; }
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    if( s != end ) { return false; }
+    if( mantissa == 0 && !truncated ) { v = negative ? -T( 0 ) : T( 0 ); return true; }
+    if( truncated || mantissa > floating< T >::max_exact_mantissa || exponent > floating< T >::max_exact_exponent || exponent < -floating< T >::max_exact_exponent )
+    {
+        return slow_path( begin, end, v );
+    }
+    T t = static_cast< T >( mantissa ); // exact, since mantissa fits
+    if( exponent > 0 ) { t *= power_of_ten< T >( exponent ); }
+    else if( exponent < 0 ) { t /= power_of_ten< T >( -exponent ); }
+    v = negative ? -t : t;
+    return true;
+}
+
+template < typename T, bool Integer = std::numeric_limits< T >::is_integer > struct number;
+
+template < typename T > struct number< T, true > { static bool parse( const char* s, const char* end, T& v ) { return integer< T >::parse( s, end, v ); } };
+
+template < typename T > struct number< T, false > { static bool parse( const char* s, const char* end, T& v ) { return parse_floating( s, end, v ); } };
+
+} // namespace parse_impl {
+
+/// parse number from the whole given range; return false, if not a valid number or out of range
+template < typename T >
+inline bool parse( const char* s, std::size_t size, T& v ) { return parse_impl::number< T >::parse( s, s + size, v ); }
+
+/// parse number from the whole given range; throw, if not a valid number or out of range
+template < typename T >
+inline T parse( const char* s, std::size_t size )
+{
+    T v;
+    if( parse( s, size, v ) ) { return v; }
+    if( std::numeric_limits< T >::is_integer ) { COMMA_THROW( comma::exception, "expected integer in [" << +std::numeric_limits< T >::min() << "," << +std::numeric_limits< T >::max() << "], got \"" << std::string( s, size ) << "\"" ); }
+    COMMA_THROW( comma::exception, "expected floating point number, got \"" << std::string( s, size ) << "\"" );
+}
+
+/// parse number from string; throw, if not a valid number or out of range
+template < typename T >
+inline T parse( const std::string& s ) { return parse< T >( s.data(), s.size() ); }
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_PARSE_HEADER_GUARD_
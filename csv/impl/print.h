@@ -0,0 +1,223 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_PRINT_HEADER_GUARD_
+#define COMMA_CSV_IMPL_PRINT_HEADER_GUARD_
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <boost/math/special_functions/sign.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <comma/base/types.h>
+#include <comma/csv/impl/parse.h>
+
+namespace comma { namespace csv { namespace impl {
+
+/// locale-free printing of numbers into a caller-provided buffer,
+/// a faster replacement for std::ostringstream in csv
+///
+/// integers are printed in decimal;
+/// floating point numbers are printed as std::ostream (i.e. printf "%g") would
+/// with the given precision (number of significant digits), e.g. 1234.56, 1e+20, nan, -inf;
+/// precision print_shortest means the shortest representation that reads back to exactly the same value
+///
+/// the buffer must be at least print_size bytes long; returns end of printed characters (no terminating zero)
+enum { print_size = 64 };
+
+/// precision for the shortest representation that reads back to exactly the same value
+static const unsigned int print_shortest = static_cast< unsigned int >( -1 );
+
+namespace print_impl {
+
+/// maximum supported precision; greater precisions get clamped (digits beyond it are noise anyway)
+enum { max_precision = 40 };
+
+inline char* print_unsigned( char* buf, comma::uint64 v )
+{
+    static const char digits[] = "00010203040506070809"
+                                 "10111213141516171819"
+                                 "20212223242526272829"
+                                 "30313233343536373839"
+                                 "40414243444546474849"
+                                 "50515253545556575859"
+                                 "60616263646566676869"
+                                 "70717273747576777879"
+                                 "80818283848586878889"
+                                 "90919293949596979899";
+    char tmp[24];
+    char* end = tmp + sizeof( tmp );
+    char* p = end;
+    while( v >= 100 )
+    {
+        unsigned int i = static_cast< unsigned int >( v % 100 ) * 2;
+        v /= 100;
+        *--p = digits[ i + 1 ];
+        *--p = digits[i];
+    }
+    if( v >= 10 ) { unsigned int i = static_cast< unsigned int >( v ) * 2; *--p = digits[ i + 1 ]; *--p = digits[i]; }
+    else { *--p = '0' + static_cast< char >( v ); }
+    ::memcpy( buf, p, end - p );
+    return buf + ( end - p );
+}
+
+template < typename T > struct floating;
+template <> struct floating< float > { enum { shortest = 6, exact = 9 }; static int snprintf( char* buf, unsigned int p, float v ) { return ::snprintf( buf, print_size, "%.*g", p, v ); } };
+template <> struct floating< double > { enum { shortest = 15, exact = 17 }; static int snprintf( char* buf, unsigned int p, double v ) { return ::snprintf( buf, print_size, "%.*g", p, v ); } };
+template <> struct floating< long double > { enum { shortest = 18, exact = 21 }; static int snprintf( char* buf, unsigned int p, long double v ) { return ::snprintf( buf, print_size, "%.*Lg", p, v ); } };
+
+/// values with up to 15 integral digits, which print as integers in "%g" unless precision is too small
+template < typename T > inline bool is_small_integral( T v, unsigned int precision )
+{
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    T a = v < 0 ? -v : v; // nan compares false below
+    return a < 1e15 && a < powers[ precision < 15 ? precision : 15 ] && a == static_cast< T >( static_cast< comma::int64 >( a ) );
+}
+
+template < typename T > inline char* print_integral( char* buf, T v )
+{
+    if( v < 0 || ( v == 0 && boost::math::signbit( v ) ) ) { *buf++ = '-'; v = -v; }
+    return print_unsigned( buf, static_cast< comma::uint64 >( v ) );
+}
+
+/// fast path of "%.*g" for double precision and up to 17 significant digits:
+/// scale the value to a precision-digit integer in extended precision (a single rounding),
+/// give up if the result is too close to a rounding boundary to be sure; returns end of printed characters or 0
+inline char* print_scaled( char* buf, double v, unsigned int precision )
+{
+    static const long double powers[] = { 1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L
+                                        , 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L }; // all exact in 64-bit mantissa
+    if( std::numeric_limits< long double >::digits < 64 || precision > 17 ) { return 0; }
+    double a = v < 0 ? -v : v;
+    if( !( a > 0 ) || a > std::numeric_limits< double >::max() ) { return 0; } // zero, nan, inf
+    int exponent = static_cast< int >( std::floor( std::log10( a ) ) ); // may be off by one, corrected below
+    long double scaled = 0;
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+        int k = static_cast< int >( precision ) - 1 - exponent;
+        if( k < -27 || k > 27 ) { return 0; }
+        scaled = k >= 0 ? static_cast< long double >( a ) * powers[k] : static_cast< long double >( a ) / powers[-k];
+        if( scaled < powers[ precision - 1 ] ) { --exponent; }
+        else if( scaled >= powers[ precision ] ) { ++exponent; }
+        else { break; }
+        if( i == 2 ) { return 0; }
+    }
+    comma::uint64 n = static_cast< comma::uint64 >( scaled );
+    long double fraction = scaled - n;
+    long double margin = std::ldexp( scaled, -62 ); // well above the error of one extended precision rounding
+    if( std::fabs( fraction - 0.5L ) <= margin ) { return 0; }
+    if( fraction > 0.5L ) { ++n; }
+    char digits[24];
+    char* end = print_unsigned( digits, n );
+    if( static_cast< unsigned int >( end - digits ) > precision ) { --end; ++exponent; } // rounded up to the next power of ten
+    while( end > digits + 1 && *( end - 1 ) == '0' ) { --end; }
+    unsigned int size = end - digits;
+    if( v < 0 ) { *buf++ = '-'; }
+    if( exponent < -4 || exponent >= static_cast< int >( precision ) )
+    {
+        *buf++ = digits[0];
+        if( size > 1 ) { *buf++ = '.'; ::memcpy( buf, digits + 1, size - 1 ); buf += size - 1; }
+        *buf++ = 'e';
+        *buf++ = exponent < 0 ? '-' : '+';
+        unsigned int e = exponent < 0 ? -exponent : exponent;
+        if( e < 10 ) { *buf++ = '0'; }
+        return print_unsigned( buf, e );
+    }
+    if( exponent < 0 )
+    {
+        *buf++ = '0';
+        *buf++ = '.';
+        for( int i = -1; i > exponent; --i ) { *buf++ = '0'; }
+        ::memcpy( buf, digits, size );
+        return buf + size;
+    }
+    unsigned int integral = exponent + 1;
+    if( size <= integral )
+    {
+        ::memcpy( buf, digits, size );
+        buf += size;
+        for( unsigned int i = size; i < integral; ++i ) { *buf++ = '0'; }
+        return buf;
+    }
+    ::memcpy( buf, digits, integral );
+    buf += integral;
+    *buf++ = '.';
+    ::memcpy( buf, digits + integral, size - integral );
+    return buf + size - integral;
+}
+
+inline char* print_scaled( char* buf, float v, unsigned int precision ) { return print_scaled( buf, static_cast< double >( v ), precision ); }
+
+inline char* print_scaled( char*, long double, unsigned int ) { return 0; }
+
+template < typename T > inline char* print_fixed( char* buf, T v, unsigned int precision )
+{
+    char* end = print_scaled( buf, v, precision );
+    return end ? end : buf + floating< T >::snprintf( buf, precision, v );
+}
+
+template < typename T > inline char* print_floating( char* buf, T v, unsigned int precision )
+{
+    if( precision != print_shortest )
+    {
+        if( precision == 0 ) { precision = 1; } // as "%.0g"
+        if( precision > max_precision ) { precision = max_precision; }
+        if( is_small_integral( v, precision ) ) { return print_integral( buf, v ); }
+        return print_fixed( buf, v, precision );
+    }
+    if( is_small_integral( v, floating< T >::shortest ) ) { return print_integral( buf, v ); }
+    char* end = buf;
+    T a = v < 0 ? -v : v;
+    unsigned int shortest = a < std::numeric_limits< T >::min() && a > 0 ? 1 : floating< T >::shortest; // denormals have fewer significant digits
+    for( unsigned int p = shortest; p <= static_cast< unsigned int >( floating< T >::exact ); ++p )
+    {
+        end = print_fixed( buf, v, p );
+        T w;
+        if( p == static_cast< unsigned int >( floating< T >::exact ) || !( v == v ) || ( parse( buf, end - buf, w ) && w == v ) ) { break; }
+    }
+    return end;
+}
+
+} // namespace print_impl {
+
+/// print integer
+template < typename T >
+inline typename boost::enable_if_c< std::numeric_limits< T >::is_integer && std::numeric_limits< T >::is_signed, char* >::type print( char* buf, T v )
+{
+    if( v >= 0 ) { return print_impl::print_unsigned( buf, static_cast< comma::uint64 >( v ) ); }
+    *buf++ = '-';
+    return print_impl::print_unsigned( buf, comma::uint64( 0 ) - static_cast< comma::uint64 >( static_cast< comma::int64 >( v ) ) );
+}
+
+/// print unsigned integer
+template < typename T >
+inline typename boost::enable_if_c< std::numeric_limits< T >::is_integer && !std::numeric_limits< T >::is_signed, char* >::type print( char* buf, T v )
+{
+    return print_impl::print_unsigned( buf, static_cast< comma::uint64 >( v ) );
+}
+
+/// print floating point number with given precision, print_shortest for shortest exact representation
+inline char* print( char* buf, float v, unsigned int precision ) { return print_impl::print_floating( buf, v, precision ); }
+inline char* print( char* buf, double v, unsigned int precision ) { return print_impl::print_floating( buf, v, precision ); }
+inline char* print( char* buf, long double v, unsigned int precision ) { return print_impl::print_floating( buf, v, precision ); }
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_PRINT_HEADER_GUARD_
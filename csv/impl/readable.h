@@ -0,0 +1,73 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_IMPL_READABLE_HEADER_GUARD_
+#define COMMA_CSV_IMPL_READABLE_HEADER_GUARD_
+
+#ifndef WIN32
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+#include <comma/io/file_descriptor.h>
+
+namespace comma { namespace csv { namespace impl {
+
+/// wait till data is available on the stream or till the deadline
+/// @param fd file descriptor of the stream or invalid_file_descriptor, if unknown,
+///        in which case only the data buffered in the stream buffer is seen,
+///        polling it every millisecond till deadline
+/// @return number of bytes that can be read without blocking;
+///         0, if none by the deadline; -1, if end of stream (reading will not block either)
+inline std::streamsize readable( std::istream& is, comma::io::file_descriptor fd, const boost::posix_time::ptime& deadline )
+{
+    if( !is.good() ) { return -1; }
+    while( true )
+    {
+        std::streamsize available = is.rdbuf()->in_avail();
+        if( available != 0 ) { return available; }
+        boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+        boost::posix_time::time_duration remaining = deadline.is_special() ? boost::posix_time::time_duration( 0, 0, 0 ) : deadline - now;
+        if( remaining.is_negative() ) { remaining = boost::posix_time::time_duration( 0, 0, 0 ); }
+        #ifndef WIN32
+        if( fd != comma::io::invalid_file_descriptor )
+        {
+            struct pollfd p;
+            p.fd = fd;
+            p.events = POLLIN;
+            p.revents = 0;
+            long long milliseconds = ( remaining.total_microseconds() + 999 ) / 1000;
+            int r = ::poll( &p, 1, milliseconds > 0x7fffffff ? 0x7fffffff : int( milliseconds ) );
+            if( r < 0 ) { continue; } // interrupted
+            if( r == 0 ) { if( remaining.total_microseconds() == 0 ) { return 0; } continue; }
+            int size = 0;
+            if( ::ioctl( fd, FIONREAD, &size ) < 0 || size <= 0 ) { return -1; } // readable, but nothing to read: end of stream or error
+            return size;
+        }
+        #endif
+        if( remaining.total_microseconds() == 0 ) { return 0; }
+        boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+    }
+}
+
+} } } // namespace comma { namespace csv { namespace impl {
+
+#endif // #ifndef COMMA_CSV_IMPL_READABLE_HEADER_GUARD_
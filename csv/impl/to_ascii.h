@@ -20,13 +20,14 @@
 #define COMMA_CSV_IMPL_TOASCII_HEADER_GUARD_
 
 #include <vector>
-#include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/type_traits.hpp>
 #include <comma/visiting/visit.h>
 #include <comma/visiting/while.h>
+#include <comma/csv/impl/iso_time.h>
+#include <comma/csv/impl/print.h>
 
 namespace comma { namespace csv { namespace impl {
 
@@ -67,19 +68,18 @@ class to_ascii
         std::vector< std::string >& row_;
         std::size_t index_;
         boost::optional< unsigned int > precision_;
-        std::string as_string_( const boost::posix_time::ptime& v ) { return to_iso_string( v ); }
-        std::string as_string_( const std::string& v ) { return std::string( "\"" ) + v + "\""; } // todo: escape/unescape
+        void as_string_( const boost::posix_time::ptime& v, std::string& s ) { char buf[ iso_time_size ]; s.assign( buf, to_iso_string( buf, v ) - buf ); }
+        void as_string_( const std::string& v, std::string& s ) { s.clear(); s.reserve( v.size() + 2 ); s += '"'; s += v; s += '"'; } // todo: escape/unescape
         // todo: better output semantics for char/unsigned char
-        std::string as_string_( const char& v ) { std::ostringstream oss; oss << static_cast< int >( v ); return oss.str(); }
-        std::string as_string_( const unsigned char& v ) { std::ostringstream oss; oss << static_cast< unsigned int >( v ); return oss.str(); }
+        void as_string_( const char& v, std::string& s ) { char buf[ print_size ]; s.assign( buf, print( buf, static_cast< int >( v ) ) - buf ); }
+        void as_string_( const unsigned char& v, std::string& s ) { char buf[ print_size ]; s.assign( buf, print( buf, static_cast< unsigned int >( v ) ) - buf ); }
+        void as_string_( float v, std::string& s ) { as_floating_( v, s ); }
+        void as_string_( double v, std::string& s ) { as_floating_( v, s ); }
+        void as_string_( long double v, std::string& s ) { as_floating_( v, s ); }
         template < typename T >
-        std::string as_string_( T v )
-        {
-            std::ostringstream oss;
-            if( precision_ ) { oss.precision( *precision_ ); }
-            oss << v;
-            return oss.str();
-        }
+        void as_string_( T v, std::string& s ) { char buf[ print_size ]; s.assign( buf, print( buf, v ) - buf ); }
+        template < typename T >
+        void as_floating_( T v, std::string& s ) { char buf[ print_size ]; s.assign( buf, print( buf, v, precision_ ? *precision_ : 6 ) - buf ); } // 6: std::ostream default precision
 };
 
 inline to_ascii::to_ascii( const std::vector< boost::optional< std::size_t > >& indices, std::vector< std::string >& line )
@@ -125,7 +125,7 @@ inline void to_ascii::apply_final( const K&, const T& value )
     {
         std::size_t i = *indices_[ index_ ];
         if( i >= row_.size() ) { COMMA_THROW( comma::exception, "got column index " << i << ", for " << row_.size() << " columns in row " << join( row_, ',' ) ); }
-        row_[i] = as_string_( value );
+        as_string_( value, row_[i] );
     }
     ++index_;
 }
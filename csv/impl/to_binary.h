@@ -62,6 +62,10 @@ class to_binary
         template < typename K, typename T >
         void apply_final( const K& name, const T& value );
         
+        /// copy value to buffer, converting it, if binary type does not match T
+        template < typename T >
+        static void copy( char* buf, const T& value, std::size_t size, format::types_enum type );
+        
     private:
         const std::vector< boost::optional< format::element > >& offsets_;
         char* buf_;
@@ -126,37 +130,35 @@ template < typename K, typename T >
 inline void to_binary::apply_final( const K&, const T& value )
 {
     //if( offsets_[ index_ ] ) { copy( buf_ + offsets_[ index_ ]->offset, value, offsets_[ index_ ]->size ); }
-    if( offsets_[ index_ ] )
+    if( offsets_[ index_ ] ) { copy( buf_ + offsets_[ index_ ]->offset, value, offsets_[ index_ ]->size, offsets_[ index_ ]->type ); }
+    ++index_;
+}
+
+template < typename T >
+inline void to_binary::copy( char* buf, const T& value, std::size_t size, format::types_enum type )
+{
+    if( type == format::traits< T >::type ) // quick path
     {
-        char* buf = buf_ + offsets_[ index_ ]->offset;
-        std::size_t size = offsets_[ index_ ]->size;
-        format::types_enum type = offsets_[ index_ ]->type;
-        if( type == format::traits< T >::type ) // quick path
-        {
-            format::traits< T >::to_bin( value, buf, size ); //copy( buf, value, size );
-        }
-        else
-        {
-            switch( type )
-            {
-                case format::int8: format::traits< char >::to_bin( static_cast_impl< char >::value( value ), buf ); break;
-                case format::uint8: format::traits< unsigned char >::to_bin( static_cast_impl< unsigned char >::value( value ), buf ); break;
-                case format::int16: format::traits< comma::int16 >::to_bin( static_cast_impl< comma::int16 >::value( value ), buf ); break;
-                case format::uint16: format::traits< comma::uint16 >::to_bin( static_cast_impl< comma::uint16 >::value( value ), buf ); break;
-                case format::int32: format::traits< comma::int32 >::to_bin( static_cast_impl< comma::int32 >::value( value ), buf ); break;
-                case format::uint32: format::traits< comma::int32 >::to_bin( static_cast_impl< comma::uint32 >::value( value ), buf ); break;
-                case format::int64: format::traits< comma::int64 >::to_bin( static_cast_impl< comma::int64 >::value( value ), buf ); break;
-                case format::uint64: format::traits< comma::uint64 >::to_bin( static_cast_impl< comma::uint64 >::value( value ), buf ); break;
-                case format::char_t: format::traits< char >::to_bin( static_cast_impl< char >::value( value ), buf ); break;
-                case format::float_t: format::traits< float >::to_bin( static_cast_impl< float >::value( value ), buf ); break;
-                case format::double_t: format::traits< double >::to_bin( static_cast_impl< double >::value( value ), buf ); break;
-                case format::time: format::traits< boost::posix_time::ptime, format::time >::to_bin( static_cast_impl< boost::posix_time::ptime >::value( value ), buf ); break;
-                case format::long_time: format::traits< boost::posix_time::ptime, format::long_time >::to_bin( static_cast_impl< boost::posix_time::ptime >::value( value ), buf ); break;
-                case format::fixed_string: format::traits< std::string >::to_bin( static_cast_impl< std::string >::value( value ), buf, size ); break;
-            };
-        }
+        format::traits< T >::to_bin( value, buf, size ); //copy( buf, value, size );
+        return;
     }
-    ++index_;
+    switch( type )
+    {
+        case format::int8: format::traits< char >::to_bin( static_cast_impl< char >::value( value ), buf ); break;
+        case format::uint8: format::traits< unsigned char >::to_bin( static_cast_impl< unsigned char >::value( value ), buf ); break;
+        case format::int16: format::traits< comma::int16 >::to_bin( static_cast_impl< comma::int16 >::value( value ), buf ); break;
+        case format::uint16: format::traits< comma::uint16 >::to_bin( static_cast_impl< comma::uint16 >::value( value ), buf ); break;
+        case format::int32: format::traits< comma::int32 >::to_bin( static_cast_impl< comma::int32 >::value( value ), buf ); break;
+        case format::uint32: format::traits< comma::int32 >::to_bin( static_cast_impl< comma::uint32 >::value( value ), buf ); break;
+        case format::int64: format::traits< comma::int64 >::to_bin( static_cast_impl< comma::int64 >::value( value ), buf ); break;
+        case format::uint64: format::traits< comma::uint64 >::to_bin( static_cast_impl< comma::uint64 >::value( value ), buf ); break;
+        case format::char_t: format::traits< char >::to_bin( static_cast_impl< char >::value( value ), buf ); break;
+        case format::float_t: format::traits< float >::to_bin( static_cast_impl< float >::value( value ), buf ); break;
+        case format::double_t: format::traits< double >::to_bin( static_cast_impl< double >::value( value ), buf ); break;
+        case format::time: format::traits< boost::posix_time::ptime, format::time >::to_bin( static_cast_impl< boost::posix_time::ptime >::value( value ), buf ); break;
+        case format::long_time: format::traits< boost::posix_time::ptime, format::long_time >::to_bin( static_cast_impl< boost::posix_time::ptime >::value( value ), buf ); break;
+        case format::fixed_string: format::traits< std::string >::to_bin( static_cast_impl< std::string >::value( value ), buf, size ); break;
+    };
 }
 
 } } } // namespace comma { namespace csv { namespace impl {
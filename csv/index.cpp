@@ -0,0 +1,128 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <comma/base/exception.h>
+#include <comma/csv/index.h>
+#include "./impl/epoch.h"
+
+namespace comma { namespace csv {
+
+index::index( std::istream& is, const csv::format& format, std::size_t field, std::size_t step )
+{
+    if( step == 0 ) { COMMA_THROW( comma::exception, "expected positive step, got 0" ); }
+    const format::element e = format.offset( field );
+    const bool time = e.type == format::time || e.type == format::long_time;
+    const std::size_t size = format.size();
+    std::vector< char > buffer( ( size < 65536 ? 65536 / size : 1 ) * size );
+    comma::uint64 offset = 0;
+    comma::uint64 count = 0;
+    comma::int64 greatest = 0;
+    comma::int64 previous = 0;
+    while( is.good() )
+    {
+        is.read( &buffer[0], buffer.size() );
+        std::size_t n = is.gcount();
+        if( n % size ) { COMMA_THROW( comma::exception, "expected records of " << size << " bytes, got " << ( n % size ) << " trailing byte(s) after offset " << ( offset + n - n % size ) ); }
+        for( const char* p = &buffer[0]; p < &buffer[0] + n; p += size, offset += size, ++count )
+        {
+            comma::int64 k = key( p, e );
+            if( count > 0 && ( count % step == 0 || ( !time && k != previous ) ) ) { entries_.push_back( entry( greatest, offset ) ); }
+            if( count == 0 || k > greatest ) { greatest = k; }
+            previous = k;
+        }
+    }
+}
+
+index::index( std::istream& is )
+{
+    entry e;
+    while( is.read( reinterpret_cast< char* >( &e.key ), sizeof( e.key ) ) && is.read( reinterpret_cast< char* >( &e.offset ), sizeof( e.offset ) ) )
+    {
+        if( !entries_.empty() && ( e.key < entries_.back().key || e.offset <= entries_.back().offset ) ) { COMMA_THROW( comma::exception, "expected index entries sorted by key and offset, got entry " << entries_.size() << " out of order" ); }
+        entries_.push_back( e );
+    }
+    if( is.gcount() > 0 ) { COMMA_THROW( comma::exception, "expected index entries of " << ( sizeof( e.key ) + sizeof( e.offset ) ) << " bytes, got trailing bytes" ); }
+}
+
+void index::write( std::ostream& os ) const
+{
+    for( std::size_t i = 0; i < entries_.size(); ++i )
+    {
+        os.write( reinterpret_cast< const char* >( &entries_[i].key ), sizeof( entries_[i].key ) );
+        os.write( reinterpret_cast< const char* >( &entries_[i].offset ), sizeof( entries_[i].offset ) );
+    }
+}
+
+static bool less( const index::entry& lhs, comma::int64 rhs ) { return lhs.key < rhs; }
+
+comma::uint64 index::seek( comma::int64 key ) const
+{
+    std::vector< entry >::const_iterator it = std::lower_bound( entries_.begin(), entries_.end(), key, &less ); // first entry with records of key or greater before it
+    return it == entries_.begin() ? 0 : ( it - 1 )->offset;
+}
+
+comma::uint64 index::seek( const boost::posix_time::ptime& t ) const { return seek( key( t ) ); }
+
+comma::uint64 index::bisect( std::istream& is, const csv::format& format, std::size_t field, comma::int64 key )
+{
+    const format::element e = format.offset( field );
+    const std::size_t size = format.size();
+    std::istream::pos_type end = is.seekg( 0, std::ios::end ).tellg();
+    if( !is.good() || end < 0 ) { COMMA_THROW( comma::exception, "expected seekable stream, failed to get its size" ); }
+    std::vector< char > record( size );
+    comma::uint64 first = 0;
+    comma::uint64 last = comma::uint64( end ) / size;
+    while( first < last )
+    {
+        comma::uint64 middle = first + ( last - first ) / 2;
+        is.seekg( middle * size );
+        if( !is.read( &record[0], size ) ) { COMMA_THROW( comma::exception, "failed to read record at offset " << ( middle * size ) ); }
+        if( index::key( &record[0], e ) < key ) { first = middle + 1; } else { last = middle; }
+    }
+    is.seekg( first * size );
+    return first * size;
+}
+
+comma::int64 index::key( const boost::posix_time::ptime& t )
+{
+    static const boost::posix_time::ptime epoch( impl::epoch );
+    if( t.is_special() ) { COMMA_THROW( comma::exception, "expected valid time, got " << boost::posix_time::to_iso_string( t ) ); }
+    return ( t - epoch ).total_microseconds();
+}
+
+comma::int64 index::key( const char* record, const format::element& e )
+{
+    const char* p = record + e.offset;
+    switch( e.type )
+    {
+        case format::int8: return static_cast< comma::int64 >( *reinterpret_cast< const char* >( p ) );
+        case format::uint8: return static_cast< comma::int64 >( *reinterpret_cast< const unsigned char* >( p ) );
+        case format::int16: return format::traits< comma::int16 >::from_bin( p );
+        case format::uint16: return format::traits< comma::uint16 >::from_bin( p );
+        case format::int32: return format::traits< comma::int32 >::from_bin( p );
+        case format::uint32: return format::traits< comma::uint32 >::from_bin( p );
+        case format::int64: return format::traits< comma::int64 >::from_bin( p );
+        case format::uint64: return static_cast< comma::int64 >( format::traits< comma::uint64 >::from_bin( p ) );
+        case format::time: return format::traits< comma::int64 >::from_bin( p ); // microseconds since epoch
+        case format::long_time: return format::traits< comma::int64 >::from_bin( p ) * 1000000 + format::traits< comma::int32 >::from_bin( p + sizeof( comma::int64 ) ) / 1000;
+        default: COMMA_THROW( comma::exception, "expected time or integer key, got " << format::to_format( e.type ) );
+    }
+}
+
+} } // namespace comma { namespace csv {
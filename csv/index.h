@@ -0,0 +1,99 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_CSV_INDEX_HEADER_GUARD_
+#define COMMA_CSV_INDEX_HEADER_GUARD_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
+#include <comma/csv/format.h>
+
+namespace comma { namespace csv {
+
+/// sparse index of a binary csv file by a key, time or integer (e.g. block),
+/// for seeking to a key without reading the file from the beginning
+///
+/// each entry is the byte offset of a record and the greatest key of all
+/// the records before it, thus seek( key ) returns an offset before which
+/// all the records have smaller keys; the file does not need to be strictly
+/// sorted by the key: records out of order just make seeks less precise
+///
+/// entries are added every given number of records and, for integer keys,
+/// wherever the key changes, i.e. at the beginning of each block
+///
+/// the index is saved in a sidecar file as binary records of the key and
+/// the offset, format l,ul; time is saved as microseconds since epoch, as in format t
+class index
+{
+    public:
+        struct entry
+        {
+            comma::int64 key;
+            comma::uint64 offset;
+            entry() : key( 0 ), offset( 0 ) {}
+            entry( comma::int64 key, comma::uint64 offset ) : key( key ), offset( offset ) {}
+        };
+
+        /// constructor: empty index, seek() always returns 0
+        index() {}
+
+        /// build index of binary records read from a stream
+        /// @param field index of the key field in the format, e.g. 0 for t in "t,3d"
+        /// @param step number of records between entries
+        index( std::istream& is, const csv::format& format, std::size_t field, std::size_t step = 1024 );
+
+        /// load index from a stream
+        explicit index( std::istream& is );
+
+        /// save index to a stream
+        void write( std::ostream& os ) const;
+
+        /// return offset, before which all the records have keys less than given key
+        comma::uint64 seek( comma::int64 key ) const;
+
+        /// return offset, before which all the records have timestamps less than given time
+        comma::uint64 seek( const boost::posix_time::ptime& t ) const;
+
+        /// return entries
+        const std::vector< entry >& entries() const { return entries_; }
+
+        /// return offset of the first record with key not less than given key
+        /// by binary search in a seekable stream of binary records sorted by the key,
+        /// e.g. to seek to a given time in a file without index; leaves the stream at the returned offset
+        static comma::uint64 bisect( std::istream& is, const csv::format& format, std::size_t field, comma::int64 key );
+
+        /// return key of a record as integer, time as microseconds since epoch
+        static comma::int64 key( const char* record, const format::element& e );
+
+        /// return time as key
+        static comma::int64 key( const boost::posix_time::ptime& t );
+
+        /// return sidecar filename for a given file and key field name, e.g. "points.bin.t.index"
+        static std::string sidecar( const std::string& filename, const std::string& field ) { return filename + "." + field + ".index"; }
+
+    private:
+        std::vector< entry > entries_;
+};
+
+} } // namespace comma { namespace csv {
+
+#endif // #ifndef COMMA_CSV_INDEX_HEADER_GUARD_
@@ -20,9 +20,11 @@
 #define COMMA_CSV_OPTIONS_H_
 
 #include <sstream>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 #include <comma/application/command_line_options.h>
 #include <comma/csv/format.h>
+#include <comma/csv/impl/print.h>
 #include <comma/string/string.h>
 #include <comma/visiting/traits.h>
 
@@ -81,6 +83,9 @@ class options
 
 namespace impl {
 
+/// return precision from string: number of significant digits or "shortest" for shortest exact representation
+inline static unsigned int precision( const std::string& s ) { return s == "shortest" ? print_shortest : boost::lexical_cast< unsigned int >( s ); }
+
 inline static void init( comma::csv::options& csvoptions, const comma::command_line_options& options, const std::string& defaultFields )
 {
     csvoptions.full_xpath = options.exists( "--full-xpath" );
@@ -93,7 +98,7 @@ inline static void init( comma::csv::options& csvoptions, const comma::command_l
             csvoptions.format( options.value< std::string >( "--binary" ) );
         }
     }
-    csvoptions.precision = options.value< unsigned int >( "--precision", 6 );
+    csvoptions.precision = precision( options.value< std::string >( "--precision", "6" ) );
     csvoptions.delimiter = options.exists( "--delimiter" ) ? options.value( "--delimiter", ',' ) : options.value( "-d", ',' );
 }
 
@@ -118,7 +123,7 @@ inline std::string options::usage()
     oss << "    --delimiter,-d <delimiter> : default: ','" << std::endl;
     oss << "    --fields,-f <names> : field names, e.g. t,,x,y,z" << std::endl;
     oss << "    --full-xpath : expect full xpaths as field names" << std::endl;
-    oss << "    --precision <precision> : floating point precision; default: 6" << std::endl;
+    oss << "    --precision <precision> : floating point precision; \"shortest\": shortest exact representation; default: 6" << std::endl;
     oss << format::usage();
     return oss.str();
 }
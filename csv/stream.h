@@ -27,11 +27,18 @@
 
 #include <iostream>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <comma/base/exception.h>
 #include <comma/csv/ascii.h>
 #include <comma/csv/binary.h>
 #include <comma/csv/options.h>
+#include <comma/csv/impl/ascii_parallel_reader.h>
+#include <comma/csv/impl/ascii_tokenizer.h>
+#include <comma/csv/impl/readable.h>
+#include <comma/io/file_descriptor.h>
+#include <comma/io/mapped_file.h>
 #include <comma/string/string.h>
 
 namespace comma { namespace csv {
@@ -50,12 +57,33 @@ class ascii_input_stream : public boost::noncopyable
         /// read; return NULL, if end of stream or alike
         const S* read();
     
-        /// read with timeout; return NULL, if insufficient data (e.g. end of stream)
-        /// @todo implement
+        /// read with timeout; return NULL, if no complete line by the deadline or end of stream
+        /// an incomplete line is kept till the next read
+        /// @note if parsing in threads, may block till a line available is complete
         const S* read( const boost::posix_time::ptime& timeout );
     
+        /// set file descriptor of the stream to wait on in read with timeout;
+        /// default: stdin for std::cin, otherwise none, in which case only the
+        /// data already in the stream buffer is seen, polled every millisecond
+        /// @note std::cin synchronised with stdio may hold data in stdio buffers,
+        ///       invisible to the file descriptor; call std::ios_base::sync_with_stdio( false )
+        void fd( comma::io::file_descriptor fd ) { fd_ = fd; }
+    
         /// return the last line read
-        const std::vector< std::string >& last() const { return line_; }
+        /// @note fields are copied into strings only on demand; if you do not need
+        ///       to own them, last_fields() is cheaper
+        const std::vector< std::string >& last() const;
+
+        /// return views of the fields of the last line read; valid till the next read
+        const std::vector< impl::ascii_field >& last_fields() const { return parallel_ ? parallel_->fields() : tokenizer_.fields(); }
+    
+        /// return the last line read as is (without end of line); valid till the next read
+        /// use it to pass the line through rather than joining last() or last_fields()
+        impl::ascii_field last_line() const { return parallel_ ? parallel_->line() : tokenizer_.line(); }
+    
+        /// parse lines in given number of threads, preserving their order; 0: parse in the calling thread
+        /// @note must be called before the first read, since the parsing threads read ahead
+        void threads( unsigned int n );
     
         /// a helper: return the engine
         const csv::ascii< S > ascii() const { return ascii_; }
@@ -64,15 +92,20 @@ class ascii_input_stream : public boost::noncopyable
         const std::vector< std::string >& fields() const { return fields_; }
 
         /// return true, if read will not block
-        bool ready() const { return false; }
+        bool ready() const { return parallel_ ? parallel_->ready() : tokenizer_.ready(); }
     
     private:
         std::istream& is_;
+        comma::io::file_descriptor fd_;
         csv::ascii< S > ascii_;
         const S default_;
         S result_;
-        std::vector< std::string > line_;
+        impl::ascii_tokenizer tokenizer_;
+        mutable std::vector< std::string > line_;
+        mutable bool line_valid_;
         std::vector< std::string > fields_;
+        boost::scoped_ptr< impl::ascii_parallel_reader< S > > parallel_;
+        static void parse_( const csv::ascii< S >* a, S& s, const std::vector< impl::ascii_field >& fields ) { a->get( s, fields ); }
 };
 
 /// ascii csv output stream 
@@ -92,6 +125,13 @@ class ascii_output_stream : public boost::noncopyable
         /// substitute corresponding fields in the line and write
         void write( const S& s, const std::string& line );
     
+        /// substitute corresponding fields in the line and write, copying the other fields as they are
+        void write( const S& s, const impl::ascii_field& line );
+    
+        /// substitute corresponding fields of a line and write, copying the other fields as they are
+        /// @param fields views of the fields of a line, e.g. ascii_input_stream::last_fields()
+        void write( const S& s, const std::vector< impl::ascii_field >& fields );
+    
         /// substitute corresponding fields and write
         void write( const S& s, const std::vector< std::string >& line );
     
@@ -115,9 +155,16 @@ class ascii_output_stream : public boost::noncopyable
         std::ostream& m_os;
         csv::ascii< S > ascii_;
         std::vector< std::string > fields_;
+        std::vector< impl::ascii_field > split_;
+        std::string line_;
 };
 
 /// binary csv input stream 
+///
+/// regular files are read through memory mapping, i.e. without copying:
+/// streams reading through comma::io::mapped_streambuf (e.g. comma::io::mapped_ifstream
+/// or comma::io::istream::map()) and std::cin redirected from a file; then last()
+/// and last_batch() point straight into the mapping
 template < typename S >
 class binary_input_stream : public boost::noncopyable
 {
@@ -131,13 +178,27 @@ class binary_input_stream : public boost::noncopyable
         /// read; return NULL, if insufficient data (e.g. end of stream)
         const S* read();
     
-        /// read with timeout; return NULL, if insufficient data (e.g. end of stream)
-        /// @todo implement
+        /// read with timeout; return NULL, if no complete record by the deadline or end of stream
+        /// an incomplete record is kept till the next read
         const S* read( const boost::posix_time::ptime& timeout );
     
+        /// set file descriptor of the stream to wait on in read with timeout; see ascii_input_stream::fd()
+        void fd( comma::io::file_descriptor fd ) { fd_ = fd; }
+    
         /// return the last line read
         const char* last() const { return last_; }
     
+        /// read up to n records into a caller-owned contiguous array,
+        /// each record defaulting to the sample; blocks only till at least one record is available;
+        /// return number of records read, 0, if insufficient data (e.g. end of stream)
+        std::size_t read_batch( S* records, std::size_t n );
+    
+        /// return raw bytes of the records of the last batch, valid till the next read
+        const char* last_batch() const { return last_batch_; }
+    
+        /// return number of records in the last batch
+        std::size_t last_batch_size() const { return last_batch_size_; }
+    
         /// a helper: return the engine
         const csv::binary< S > binary() const { return binary_; }
 
@@ -152,6 +213,7 @@ class binary_input_stream : public boost::noncopyable
     
     private:
         std::istream& is_;
+        comma::io::file_descriptor fd_;
         csv::binary< S > binary_;
         const S default_;
         S result_;
@@ -160,9 +222,45 @@ class binary_input_stream : public boost::noncopyable
         char* begin_;
         const char* end_;
         char* cur_;
-        char* last_;
+        const char* last_;
         std::size_t offset_;
         std::vector< std::string > fields_;
+        const char* last_batch_;
+        std::size_t last_batch_size_;
+        io::mapped_streambuf* mapped_;
+        boost::scoped_ptr< io::mapped_streambuf > mapped_stdin_;
+        bool fill_();
+        void read_available_( std::size_t available );
+        void map_();
+        const char* read_mapped_( std::size_t& n );
+};
+
+/// buffering and flushing policy for binary csv output stream
+/// records are accumulated in a buffer and written to the stream
+/// in one go, when any of the limits is reached or on flush()
+struct flush_policy
+{
+    /// buffer size in bytes, rounded down to whole records, but at least one record;
+    /// 0: write each record through (default)
+    std::size_t bytes;
+
+    /// write buffered records after this number of records; 0: no limit
+    std::size_t records;
+
+    /// write buffered records, if the oldest of them is older than period; not_a_date_time: no limit
+    /// @note the age is checked on write; records are not written in background
+    boost::posix_time::time_duration period;
+
+    /// if true, flush the stream every time buffered records are written
+    bool flush;
+
+    flush_policy() : bytes( 0 ), records( 0 ), period( boost::posix_time::not_a_date_time ), flush( false ) {}
+
+    /// convenience constructor
+    flush_policy( std::size_t bytes, std::size_t records = 0, boost::posix_time::time_duration period = boost::posix_time::not_a_date_time, bool flush = false ) : bytes( bytes ), records( records ), period( period ), flush( flush ) {}
+
+    /// write and flush each record (for low latency producers)
+    static flush_policy per_record() { return flush_policy( 0, 1, boost::posix_time::not_a_date_time, true ); }
 };
 
 /// binary csv output stream 
@@ -185,8 +283,14 @@ class binary_output_stream : public boost::noncopyable
         /// substitute corresponding fields in the buffer and write
         void write( const S& s, const char* buf );
     
-        /// flush
+        /// write buffered records and flush the stream
         void flush();
+
+        /// set buffering policy; buffered records get written first
+        void policy( const csv::flush_policy& p );
+
+        /// return buffering policy
+        const csv::flush_policy& policy() const { return policy_; }
     
         /// a helper: return the engine
         const csv::binary< S > binary() const { return binary_; }
@@ -197,12 +301,17 @@ class binary_output_stream : public boost::noncopyable
     private:
         std::ostream& m_os;
         csv::binary< S > binary_;
-        //const std::size_t size_;
+        const std::size_t size_;
+        csv::flush_policy policy_;
         std::vector< char > buf_;
-        //char* begin_;
-        //const char* end_;
-        //char* cur_;
+        char* begin_;
+        const char* end_;
+        char* cur_;
+        std::size_t count_;
+        boost::posix_time::ptime first_;
         std::vector< std::string > fields_;
+        void commit_();
+        void write_();
 };
 
 /// trivial generic csv input stream wrapper, less optimized, but more convenient 
@@ -222,9 +331,16 @@ class input_stream : public boost::noncopyable
         /// read; return NULL, if insufficient data (e.g. end of stream)
         const S* read() { return ascii_ ? ascii_->read() : binary_->read(); }
     
-        /// read with timeout; return NULL, if insufficient data (e.g. end of stream)
+        /// read with timeout; return NULL, if insufficient data by the deadline (e.g. end of stream)
         const S* read( const boost::posix_time::ptime& timeout ) { return ascii_ ? ascii_->read( timeout ) : binary_->read( timeout ); }
     
+        /// set file descriptor of the stream to wait on in read with timeout
+        void fd( comma::io::file_descriptor fd ) { if( ascii_ ) { ascii_->fd( fd ); } else { binary_->fd( fd ); } }
+    
+        /// read up to n records into a caller-owned array; return number of records read
+        /// @note ascii streams currently read one record per batch
+        std::size_t read_batch( S* records, std::size_t n );
+    
         /// get last as string: an evil function, don't use it!
         //std::string last() const;
     
@@ -240,6 +356,17 @@ class input_stream : public boost::noncopyable
         boost::scoped_ptr< binary_input_stream< S > > binary_;
 };
 
+template < typename S >
+inline std::size_t input_stream< S >::read_batch( S* records, std::size_t n )
+{
+    if( binary_ ) { return binary_->read_batch( records, n ); }
+    if( n == 0 ) { return 0; }
+    const S* s = ascii_->read();
+    if( !s ) { return 0; }
+    records[0] = *s;
+    return 1;
+}
+
 /// trivial generic csv output stream wrapper, less optimized, but more convenient 
 template < typename S >
 class output_stream : public boost::noncopyable
@@ -284,9 +411,12 @@ class output_stream : public boost::noncopyable
 template < typename S >
 inline ascii_input_stream< S >::ascii_input_stream( std::istream& is, const std::string& column_names, char delimiter, bool full_path_as_name, const S& sample )
     : is_( is )
+    , fd_( &is == &std::cin ? comma::io::stdin_fd : comma::io::invalid_file_descriptor )
     , ascii_( column_names, delimiter, full_path_as_name, sample )
     , default_( sample )
     , result_( sample )
+    , tokenizer_( delimiter )
+    , line_valid_( false )
     , fields_( split( column_names, delimiter ) )
 {
 }
@@ -294,9 +424,12 @@ inline ascii_input_stream< S >::ascii_input_stream( std::istream& is, const std:
 template < typename S >
 inline ascii_input_stream< S >::ascii_input_stream(std::istream& is, const options& o, const S& sample )
     : is_( is )
+    , fd_( &is == &std::cin ? comma::io::stdin_fd : comma::io::invalid_file_descriptor )
     , ascii_( o.fields, o.delimiter, o.full_xpath, sample )
     , default_( sample )
     , result_( sample )
+    , tokenizer_( o.delimiter )
+    , line_valid_( false )
     , fields_( split( o.fields, o.delimiter ) )
 {
 
@@ -306,20 +439,43 @@ inline ascii_input_stream< S >::ascii_input_stream(std::istream& is, const optio
 template < typename S >
 inline const S* ascii_input_stream< S >::read()
 {
-    while( is_.good() && !is_.eof() )
+    line_valid_ = false;
+    if( parallel_ ) { return parallel_->read( is_ ); }
+    if( !tokenizer_.read( is_ ) ) { return NULL; }
+    result_ = default_;
+    ascii_.get( result_, tokenizer_.fields() );
+    return &result_;
+}
+
+template < typename S >
+inline const S* ascii_input_stream< S >::read( const boost::posix_time::ptime& timeout )
+{
+    while( !ready() )
     {
-        /// @todo implement reassembly
-        std::string s;
-        std::getline( is_, s );
-        if( !s.empty() && *s.rbegin() == '\r' ) { s = s.substr( 0, s.length() - 1 ); } // windows... sigh...
-        if( s.empty() ) { continue; }
-        result_ = default_;
-        line_ = split
-( s, ascii_.delimiter() );
-        ascii_.get( result_, line_ );
-        return &result_;
+        std::streamsize available = impl::readable( is_, fd_, timeout );
+        if( available == 0 ) { return NULL; }
+        if( available < 0 || parallel_ ) { break; } // end of stream: read will not block; parallel reader reads the stream by itself
+        tokenizer_.fill( is_, available );
     }
-    return NULL;
+    return read();
+}
+
+template < typename S >
+inline void ascii_input_stream< S >::threads( unsigned int n )
+{
+    if( n == 0 ) { parallel_.reset(); return; }
+    parallel_.reset( new impl::ascii_parallel_reader< S >( ascii_.delimiter(), n, boost::bind( &ascii_input_stream< S >::parse_, &ascii_, _1, _2 ), default_ ) );
+}
+
+template < typename S >
+inline const std::vector< std::string >& ascii_input_stream< S >::last() const
+{
+    if( line_valid_ ) { return line_; }
+    const std::vector< impl::ascii_field >& f = last_fields();
+    line_.resize( f.size() );
+    for( std::size_t i = 0; i < f.size(); ++i ) { line_[i].assign( f[i].data, f[i].size ); }
+    line_valid_ = true;
+    return line_;
 }
 
 template < typename S >
@@ -352,8 +508,23 @@ inline void ascii_output_stream< S >::write( const S& s )
 template < typename S >
 inline void ascii_output_stream< S >::write( const S& s, const std::string& line )
 {
-    write( s, split
-( line, ascii_.delimiter() ) );
+    split( line, ascii_.delimiter(), split_ );
+    write( s, split_ );
+}
+
+template < typename S >
+inline void ascii_output_stream< S >::write( const S& s, const impl::ascii_field& line )
+{
+    split( line.begin(), line.end(), ascii_.delimiter(), split_ );
+    write( s, split_ );
+}
+
+template < typename S >
+inline void ascii_output_stream< S >::write( const S& s, const std::vector< impl::ascii_field >& fields )
+{
+    ascii_.put( s, fields, line_ );
+    m_os.write( line_.data(), line_.size() );
+    m_os << std::endl;
 }
 
 template < typename S >
@@ -377,6 +548,7 @@ inline void ascii_output_stream< S >::write( const S& s, std::vector< std::strin
 template < typename S >
 inline binary_input_stream< S >::binary_input_stream( std::istream& is, const std::string& format, const std::string& column_names, bool full_path_as_name, const S& sample )
     : is_( is )
+    , fd_( &is == &std::cin ? comma::io::stdin_fd : comma::io::invalid_file_descriptor )
     , binary_( format, column_names, full_path_as_name, sample )
     , default_( sample )
     , result_( sample )
@@ -387,17 +559,21 @@ inline binary_input_stream< S >::binary_input_stream( std::istream& is, const st
     , cur_( begin_ )
     , last_( begin_ )
     , offset_( 0 )
-    , fields_( split
-( column_names, ',' ) )
+    , fields_( split( column_names, ',' ) )
+    , last_batch_( begin_ )
+    , last_batch_size_( 0 )
+    , mapped_( NULL )
 {
     #ifdef WIN32
     if( &is == &std::cin ) { _setmode( _fileno( stdin ), _O_BINARY ); }
     #endif
+    map_();
 }
 
 template < typename S >
 inline binary_input_stream< S >::binary_input_stream( std::istream& is, const options& o, const S& sample )
     : is_( is )
+    , fd_( &is == &std::cin ? comma::io::stdin_fd : comma::io::invalid_file_descriptor )
     , binary_( o.format().string(), o.fields, o.full_xpath, sample )
     , default_( sample )
     , result_( sample )
@@ -409,37 +585,148 @@ inline binary_input_stream< S >::binary_input_stream( std::istream& is, const op
     , last_( begin_ )
     , offset_( 0 )
     , fields_( split( o.fields, ',' ) )
+    , last_batch_( begin_ )
+    , last_batch_size_( 0 )
+    , mapped_( NULL )
 {
-    
     #ifdef WIN32
     if( &is == &std::cin ) { _setmode( _fileno( stdin ), _O_BINARY ); }
     #endif
+    map_();
+}
+
+template < typename S >
+inline void binary_input_stream< S >::map_()
+{
+    mapped_ = dynamic_cast< io::mapped_streambuf* >( is_.rdbuf() );
+    #ifndef WIN32
+    if( mapped_ || &is_ != &std::cin || !io::mapped_file::regular( io::stdin_fd ) ) { return; }
+    if( is_.rdbuf()->in_avail() != 0 ) { return; } // std::cin not synchronised with stdio has its own buffer: position in file unknown
+    long offset = ::ftell( stdin ); // accounts for data buffered by stdio, if any
+    if( offset < 0 ) { return; }
+    mapped_stdin_.reset( new io::mapped_streambuf( io::stdin_fd, offset ) );
+    mapped_ = mapped_stdin_.get();
+    #endif
+}
+
+template < typename S >
+inline const char* binary_input_stream< S >::read_mapped_( std::size_t& n ) // return up to n records straight from the mapping
+{
+    const std::size_t size = binary_.format().size();
+    if( mapped_->available() < size ) { mapped_->update(); } // the file may have grown
+    std::size_t available = mapped_->available();
+    if( available < size )
+    {
+        if( available > 0 ) { COMMA_THROW( comma::exception, "expected at least " << size << " bytes; got " << available ); }
+        return NULL;
+    }
+    if( n > available / size ) { n = available / size; }
+    const char* records = mapped_->data();
+    mapped_->consume( n * size );
+    return records;
 }
 
 template < typename S >
 inline bool binary_input_stream< S >::ready() const
 {
-    return offset_ >= binary_.format().size();
+    return ( mapped_ ? mapped_->available() : offset_ ) >= binary_.format().size();
 }
 
 template < typename S >
 inline const S* binary_input_stream< S >::read()
 { 
-    while( true ) // reading a big chunk for better performance
+    if( mapped_ )
+    {
+        std::size_t n = 1;
+        const char* record = read_mapped_( n );
+        if( !record ) { return NULL; }
+        result_ = default_;
+        binary_.get( result_, record );
+        last_ = record;
+        return &result_;
+    }
+    if( !fill_() ) { return NULL; }
+    result_ = default_;
+    binary_.get( result_, cur_ );
+    last_ = cur_;
+    cur_ += binary_.format().size();
+    offset_ -= binary_.format().size();
+    if( cur_ >= end_ ) { cur_ = begin_; offset_ = 0; }
+    return &result_;
+}
+
+template < typename S >
+inline std::size_t binary_input_stream< S >::read_batch( S* records, std::size_t n )
+{
+    const std::size_t size = binary_.format().size();
+    if( n == 0 ) { return 0; }
+    if( mapped_ )
     {
-        if( ready() )
+        const char* p = read_mapped_( n );
+        if( !p ) { return 0; }
+        last_batch_ = p;
+        last_batch_size_ = n;
+        for( std::size_t i = 0; i < n; ++i, p += size )
         {
-            result_ = default_;
-            binary_.get( result_, cur_ );
-            last_ = cur_;
-            cur_ += binary_.format().size();
-            offset_ -= binary_.format().size();
-            if( cur_ >= end_ ) { cur_ = begin_; offset_ = 0; }
-            return &result_;
+            records[i] = default_;
+            binary_.get( records[i], p );
         }
+        last_ = p - size;
+        return n;
+    }
+    if( offset_ < n * size && ready() )
+    {
+        std::streamsize available = is_.rdbuf()->in_avail();
+        if( available > 0 ) { read_available_( available ); }
+    }
+    if( !fill_() ) { return 0; }
+    std::size_t count = offset_ / size;
+    if( count > n ) { count = n; }
+    last_batch_ = cur_;
+    last_batch_size_ = count;
+    for( std::size_t i = 0; i < count; ++i, cur_ += size )
+    {
+        records[i] = default_;
+        binary_.get( records[i], cur_ );
+    }
+    last_ = cur_ - size;
+    offset_ -= count * size;
+    if( cur_ >= end_ ) { cur_ = begin_; offset_ = 0; }
+    return count;
+}
+
+template < typename S >
+inline const S* binary_input_stream< S >::read( const boost::posix_time::ptime& timeout )
+{
+    if( mapped_ ) { return read(); } // never blocks
+    while( !ready() )
+    {
+        std::streamsize available = impl::readable( is_, fd_, timeout );
+        if( available == 0 ) { return NULL; }
+        if( available < 0 ) { break; } // end of stream: read will not block
+        read_available_( available );
+    }
+    return read();
+}
+
+template < typename S >
+inline void binary_input_stream< S >::read_available_( std::size_t available ) // top up the buffer with data available without blocking
+{
+    std::size_t size = end_ - cur_ - offset_;
+    if( size > available ) { size = available; }
+    is_.read( cur_ + offset_, size );
+    if( is_.gcount() > 0 ) { offset_ += is_.gcount(); }
+}
+
+template < typename S >
+inline bool binary_input_stream< S >::fill_()
+{
+    while( true ) // reading a big chunk for better performance
+    {
+        if( ready() ) { return true; }
         bool bad = is_.eof() || !is_.good() || is_.bad() || is_.fail();
         if( offset_ > 0 && bad ) { COMMA_THROW( comma::exception, "expected at least " << binary_.format().size() << " bytes; got " << offset_ ); }
-        if( bad ) { return NULL; }
+        if( bad ) { return false; }
         std::size_t size = end_ - cur_ - offset_;
         // this is a painful part to read only the available bytes
         // if using sockets or pipes, make sure that data is there
@@ -477,11 +764,12 @@ template < typename S >
 inline binary_output_stream< S >::binary_output_stream( std::ostream& os, const std::string& format, const std::string& column_names, bool full_path_as_name, const S& sample )
     : m_os( os )
     , binary_( format, column_names, full_path_as_name, sample )
-    //, size_( binary_.format().size() * ( 4098 / binary_.format().size() ) ) // quick and dirty
-    , buf_( binary_.format().size() ) //, buf_( size_ )
-    //, begin_( &buf_[0] )
-    //, end_( begin_ + size_ )
-    //, cur_( begin_ )
+    , size_( binary_.format().size() )
+    , buf_( size_ )
+    , begin_( &buf_[0] )
+    , end_( begin_ + size_ )
+    , cur_( begin_ )
+    , count_( 0 )
     , fields_( split( column_names, ',' ) )
 {
     #ifdef WIN32
@@ -494,11 +782,12 @@ template < typename S >
 inline binary_output_stream< S >::binary_output_stream( std::ostream& os, const options& o, const S& sample )
     : m_os( os )
     , binary_( o.format().string(), o.fields, o.full_xpath, sample )
-//     , size_( binary_.format().size() ) //, size_( binary_.format().size() * ( 4098 / binary_.format().size() ) ) // quick and dirty
-    , buf_( binary_.format().size() ) //, buf_( size_ )
-//     , begin_( &buf_[0] )
-//     , end_( begin_ + size_ )
-//     , cur_( begin_ )
+    , size_( binary_.format().size() )
+    , buf_( size_ )
+    , begin_( &buf_[0] )
+    , end_( begin_ + size_ )
+    , cur_( begin_ )
+    , count_( 0 )
     , fields_( split( o.fields, ',' ) )
 {
     #ifdef WIN32
@@ -507,33 +796,59 @@ inline binary_output_stream< S >::binary_output_stream( std::ostream& os, const
     #endif
 }
 
+template < typename S >
+inline void binary_output_stream< S >::policy( const csv::flush_policy& p )
+{
+    write_();
+    policy_ = p;
+    buf_.resize( p.bytes > size_ ? ( p.bytes / size_ ) * size_ : size_ );
+    begin_ = &buf_[0];
+    end_ = begin_ + buf_.size();
+    cur_ = begin_;
+}
+
+template < typename S >
+inline void binary_output_stream< S >::write_()
+{
+    if( cur_ == begin_ ) { return; }
+    m_os.write( begin_, cur_ - begin_ );
+    cur_ = begin_;
+    count_ = 0;
+    if( policy_.flush ) { m_os.flush(); }
+}
+
+template < typename S >
+inline void binary_output_stream< S >::commit_()
+{
+    cur_ += size_;
+    ++count_;
+    if( cur_ == end_ || ( policy_.records > 0 && count_ >= policy_.records ) ) { write_(); return; }
+    if( policy_.period.is_special() ) { return; }
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    if( count_ == 1 ) { first_ = now; }
+    if( now - first_ >= policy_.period ) { write_(); }
+}
+
 template < typename S >
 inline void binary_output_stream< S >::flush()
 {
+    write_();
     m_os.flush();
-//     if( cur_ == begin_ ) { return; }
-//     m_os.write( begin_, cur_ - begin_ );
-//     m_os.flush();
-//     cur_ = begin_;
 }
 
 template < typename S >
 inline void binary_output_stream< S >::write( const S& s )
 {
-    binary_.put( s, &buf_[0] );
-    m_os.write( &buf_[0], binary_.format().size() );
-//     binary_.put( s, cur_ );
-//     cur_ += binary_.format().size();
-//     if( cur_ == end_ ) { flush(); }
+    binary_.put( s, cur_ );
+    commit_();
 }
 
 template < typename S >
 inline void binary_output_stream< S >::write( const S& s, const char* buf )
 {
-    ::memcpy( &buf_[0], buf, binary_.format().size() );
-    write( s );    
-//     ::memcpy( cur_, buf, binary_.format().size() );
-//     write( s );
+    ::memcpy( cur_, buf, size_ );
+    binary_.put( s, cur_ );
+    commit_();
 }
 
 template < typename S >
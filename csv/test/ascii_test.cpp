@@ -172,7 +172,27 @@ TEST( csv, ascii_get )
 
 TEST( csv, ascii_put )
 {
-    // todo
+    comma::csv::ascii_test::nested n;
+    n.x = 5;
+    n.y = 6;
+    {
+        comma::csv::ascii< comma::csv::ascii_test::nested > ascii( ",x,,y" );
+        std::string line = "1.50,abc, 0.100,def,  g";
+        EXPECT_EQ( ascii.put( n, line ), "1.50,5, 0.100,6,  g" );
+        line = "";
+        EXPECT_EQ( ascii.put( n, line ), ",5,,6" );
+        line = "1,2";
+        EXPECT_THROW( ascii.put( n, line ), comma::exception );
+    }
+    {
+        comma::csv::ascii< comma::csv::ascii_test::nested > ascii( "y,,x" );
+        std::string line = "a,,b;c";
+        std::vector< comma::csv::impl::ascii_field > fields;
+        comma::split( line, ',', fields );
+        std::string result;
+        EXPECT_EQ( ascii.put( n, fields, result ), "6,,5" );
+        EXPECT_EQ( line, "a,,b;c" );
+    }
 }
 
 TEST( csv, ascii_optional_element )
@@ -20,6 +20,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <comma/csv/binary.h>
 #include <comma/csv/format.h>
+#include <comma/csv/impl/binary_plan.h>
 #include <comma/string/string.h>
 
 namespace comma { namespace csv { namespace binary_test {
@@ -255,6 +256,58 @@ TEST( csv, binary_get )
     // todo: more testing
 }
 
+TEST( csv, binary_plan )
+{
+    {
+        comma::csv::binary_test::large_struct s;
+        comma::csv::impl::binary_visitor v( comma::csv::format( "%b%3i%ui%4d%2s[8]%ui" ), comma::join( comma::csv::names( s ), ',' ) );
+        comma::visiting::apply( v, s );
+        comma::csv::impl::binary_plan plan( v.offsets(), s );
+        EXPECT_TRUE( plan.valid() );
+        ASSERT_EQ( plan.operations().size(), 6u ); // boule, a..size, alpha..delta, string1, string2, id
+        EXPECT_EQ( plan.operations()[1].size, 4 * sizeof( int ) );
+        EXPECT_EQ( plan.operations()[2].size, 4 * sizeof( double ) );
+        EXPECT_TRUE( plan.operations()[3].get != NULL );
+    }
+    {
+        comma::csv::binary_test::simple_struct s;
+        comma::csv::impl::binary_visitor v( comma::csv::format( "d,d,i,i,ui" ), "b,,nested/x,nested/y" );
+        comma::visiting::apply( v, s );
+        comma::csv::impl::binary_plan plan( v.offsets(), s );
+        EXPECT_TRUE( plan.valid() );
+        ASSERT_EQ( plan.operations().size(), 2u ); // b, nested
+        EXPECT_EQ( plan.operations()[1].source, 16u );
+        EXPECT_EQ( plan.operations()[1].size, 2 * sizeof( int ) );
+    }
+    {
+        comma::csv::binary_test::test_struct s;
+        comma::csv::impl::binary_visitor v( comma::csv::format( "%4i" ), comma::join( comma::csv::names( s ), ',' ) );
+        comma::visiting::apply( v, s );
+        EXPECT_FALSE( comma::csv::impl::binary_plan( v.offsets(), s ).valid() );
+    }
+    {
+        comma::csv::binary_test::simple_struct s;
+        s.a = 1;
+        s.b = 2;
+        s.c = 'c';
+        s.t = boost::posix_time::from_iso_string( "20110304T111111.1234" );
+        s.nested.x = 5;
+        s.nested.y = 6;
+        comma::csv::binary< comma::csv::binary_test::simple_struct > binary( "ui,d,i,i,t,f", "a,b,nested/x,nested/y,t" );
+        char buf[64];
+        ::memset( buf, 0, sizeof( buf ) );
+        binary.put( s, buf );
+        comma::csv::binary_test::simple_struct t;
+        binary.get( t, buf );
+        EXPECT_EQ( t.a, 1 );
+        EXPECT_EQ( t.b, 2 );
+        EXPECT_EQ( t.c, 0 );
+        EXPECT_EQ( t.t, s.t );
+        EXPECT_EQ( t.nested.x, 5 );
+        EXPECT_EQ( t.nested.y, 6 );
+    }
+}
+
 template < typename T > struct test_cast
 {
     T value;
@@ -0,0 +1,95 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
+#include <comma/csv/columns.h>
+
+TEST( csv, columns )
+{
+    comma::csv::format format( "t,3d,ui,s[3]" );
+    std::vector< char > records( format.size() * 10 );
+    for( std::size_t i = 0; i < 10; ++i )
+    {
+        char* p = &records[ i * format.size() ];
+        comma::csv::format::traits< boost::posix_time::ptime, comma::csv::format::time >::to_bin( boost::posix_time::from_iso_string( "20140101T000000" ) + boost::posix_time::seconds( i ), p );
+        for( std::size_t k = 0; k < 3; ++k ) { double d = i * 10 + k; ::memcpy( p + 8 + k * 8, &d, 8 ); }
+        comma::uint32 u = i * 100;
+        ::memcpy( p + 32, &u, 4 );
+        ::memcpy( p + 36, "abc", 3 );
+    }
+    comma::csv::columns columns( format, 16 );
+    EXPECT_EQ( 6u, columns.count() );
+    columns.decode( &records[0], 10 );
+    EXPECT_EQ( 10u, columns.size() );
+    const double* y = columns.column< double >( 2 );
+    const comma::uint32* u = columns.column< comma::uint32 >( 4 );
+    const comma::int64* t = columns.column< comma::int64 >( 0 );
+    for( std::size_t i = 0; i < 10; ++i )
+    {
+        EXPECT_EQ( i * 10 + 1, y[i] );
+        EXPECT_EQ( i * 100, u[i] );
+        EXPECT_EQ( t[0] + comma::int64( i ) * 1000000, t[i] );
+        EXPECT_EQ( 0, ::memcmp( columns.data( 5 ) + i * 3, "abc", 3 ) );
+    }
+    EXPECT_THROW( columns.column< float >( 2 ), comma::exception );
+    EXPECT_THROW( columns.column< double >( 6 ), comma::exception );
+    EXPECT_THROW( columns.resize( 17 ), comma::exception );
+    std::vector< char > encoded( records.size() );
+    columns.encode( &encoded[0] );
+    EXPECT_TRUE( encoded == records );
+    double* x = columns.column< double >( 1 );
+    for( std::size_t i = 0; i < columns.size(); ++i ) { x[i] *= 2; }
+    columns.encode( &encoded[0] );
+    double d;
+    ::memcpy( &d, &encoded[ 3 * format.size() + 8 ], 8 );
+    EXPECT_EQ( 60, d );
+}
+
+TEST( csv, columns_stream )
+{
+    comma::csv::format format( "ui,d" );
+    std::ostringstream oss;
+    for( comma::uint32 i = 0; i < 1000; ++i ) { double d = i * 0.5; oss.write( reinterpret_cast< const char* >( &i ), 4 ); oss.write( reinterpret_cast< const char* >( &d ), 8 ); }
+    std::istringstream iss( oss.str() );
+    std::ostringstream output;
+    comma::csv::columns_input_stream istream( iss, format, 64 );
+    comma::csv::columns_output_stream ostream( output, format );
+    std::size_t count = 0;
+    while( const comma::csv::columns* c = istream.read() )
+    {
+        EXPECT_LE( c->size(), 64u );
+        for( std::size_t i = 0; i < c->size(); ++i, ++count )
+        {
+            EXPECT_EQ( count, c->column< comma::uint32 >( 0 )[i] );
+            EXPECT_EQ( count * 0.5, c->column< double >( 1 )[i] );
+        }
+        EXPECT_EQ( 0, ::memcmp( istream.last(), &oss.str()[ ( count - c->size() ) * 12 ], c->size() * 12 ) );
+        ostream.write( *c );
+    }
+    EXPECT_EQ( 1000u, count );
+    EXPECT_EQ( oss.str(), output.str() );
+    std::istringstream truncated( oss.str().substr( 0, 30 ) );
+    comma::csv::columns_input_stream s( truncated, format, 64 );
+    const comma::csv::columns* c = s.read();
+    ASSERT_TRUE( c != NULL );
+    EXPECT_EQ( 2u, c->size() );
+    EXPECT_THROW( s.read(), comma::exception );
+}
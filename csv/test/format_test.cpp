@@ -18,8 +18,10 @@
 
 #include <gtest/gtest.h>
 #include <limits>
+#include <string.h>
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include <comma/csv/format.h>
+#include <comma/csv/impl/print.h>
 
 TEST( csv, format )
 {
@@ -243,3 +245,49 @@ TEST( csv, format_with_fields )
     EXPECT_EQ( comma::csv::format::value< simple_struct >( "a,s,t", false ), "i,s,t" );
     EXPECT_EQ( comma::csv::format::value< simple_struct >( "x,y", false ), "i,i" );
 }
+
+TEST( csv, DISABLED_format_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    const char* types[] = { "16ub", "16ui", "16l", "16f", "16d", "16t", "16s[8]", "t,3d,ui,2f,ub" };
+    const std::size_t records = 20000;
+    for( std::size_t k = 0; k < sizeof( types ) / sizeof( types[0] ); ++k )
+    {
+        comma::csv::format format( types[k] );
+        std::vector< char > bin( format.size() * records );
+        for( std::size_t i = 0; i < bin.size(); ++i ) { bin[i] = static_cast< char >( ::rand() % 64 + 64 ); }
+        for( std::size_t i = 0; i < records; ++i ) // make sure times are valid
+        {
+            for( std::size_t j = 0; j < format.count(); ++j )
+            {
+                comma::csv::format::element e = format.offset( j );
+                if( e.type == comma::csv::format::time ) { comma::csv::format::traits< boost::posix_time::ptime, comma::csv::format::time >::to_bin( boost::posix_time::from_iso_string( "20140101T000000.123456" ) + boost::posix_time::seconds( i ), &bin[ i * format.size() + e.offset ] ); }
+                if( e.type == comma::csv::format::fixed_string ) { bin[ i * format.size() + e.offset + e.size - 1 ] = 0; }
+            }
+        }
+        for( unsigned int p = 0; p < 2; ++p ) // default precision, then shortest exact representation, which reads back to the same binary
+        {
+            boost::optional< unsigned int > precision;
+            if( p == 1 ) { precision = comma::csv::impl::print_shortest; }
+            std::vector< std::string > lines( records );
+            for( std::size_t i = 0; i < records; ++i ) { format.bin_to_csv( &bin[ i * format.size() ], lines[i], ',', precision ); }
+            std::string line;
+            boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+            for( std::size_t i = 0; i < records; ++i ) { EXPECT_EQ( lines[i].size(), format.bin_to_csv( &bin[ i * format.size() ], line, ',', precision ).size() ); }
+            boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+            std::vector< char > buf( format.size() );
+            std::vector< comma::csv::impl::ascii_field > fields;
+            std::size_t bytes = 0;
+            for( std::size_t i = 0; i < records; ++i )
+            {
+                comma::split( lines[i], ',', fields );
+                format.csv_to_bin( &buf[0], fields );
+                if( precision ) { EXPECT_EQ( 0, ::memcmp( &buf[0], &bin[ i * format.size() ], format.size() ) ); }
+                bytes += lines[i].size() + 1;
+            }
+            boost::posix_time::ptime finish = boost::posix_time::microsec_clock::universal_time();
+            std::cerr << types[k] << ( precision ? " (shortest)" : "" ) << ": bin_to_csv: " << ( middle - start ).total_microseconds() * 1000 / ( records * format.count() ) << "ns/field"
+                      << "; csv_to_bin: " << ( finish - middle ).total_microseconds() * 1000 / ( records * format.count() ) << "ns/field"
+                      << " (" << bytes / ( 1 + ( finish - middle ).total_microseconds() ) << "MB/s)" << std::endl;
+        }
+    }
+}
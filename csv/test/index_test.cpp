@@ -0,0 +1,116 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/exception.h>
+#include <comma/base/types.h>
+#include <comma/csv/index.h>
+
+TEST( csv, index_block )
+{
+    comma::csv::format format( "d,ui" );
+    std::ostringstream oss;
+    comma::uint32 blocks[] = { 0, 0, 0, 2, 2, 5, 5, 5, 5, 6 };
+    for( std::size_t i = 0; i < 10; ++i )
+    {
+        double d = i;
+        oss.write( reinterpret_cast< const char* >( &d ), sizeof( d ) );
+        oss.write( reinterpret_cast< const char* >( &blocks[i] ), sizeof( blocks[i] ) );
+    }
+    std::istringstream iss( oss.str() );
+    comma::csv::index index( iss, format, 1, 1024 );
+    ASSERT_EQ( 3u, index.entries().size() );
+    EXPECT_EQ( 0, index.entries()[0].key );
+    EXPECT_EQ( 3u * 12, index.entries()[0].offset );
+    EXPECT_EQ( 0u, index.seek( 0 ) );
+    EXPECT_EQ( 3u * 12, index.seek( 1 ) );
+    EXPECT_EQ( 3u * 12, index.seek( 2 ) );
+    EXPECT_EQ( 5u * 12, index.seek( 3 ) );
+    EXPECT_EQ( 5u * 12, index.seek( 5 ) );
+    EXPECT_EQ( 9u * 12, index.seek( 6 ) );
+    EXPECT_EQ( 9u * 12, index.seek( 100 ) );
+    std::ostringstream saved;
+    index.write( saved );
+    EXPECT_EQ( 3u * 16, saved.str().size() );
+    std::istringstream loaded_stream( saved.str() );
+    comma::csv::index loaded( loaded_stream );
+    ASSERT_EQ( index.entries().size(), loaded.entries().size() );
+    for( std::size_t i = 0; i < index.entries().size(); ++i )
+    {
+        EXPECT_EQ( index.entries()[i].key, loaded.entries()[i].key );
+        EXPECT_EQ( index.entries()[i].offset, loaded.entries()[i].offset );
+    }
+    std::istringstream truncated( oss.str().substr( 0, 10 * 12 - 5 ) );
+    EXPECT_THROW( comma::csv::index( truncated, format, 1 ), comma::exception );
+    std::istringstream truncated_index( saved.str().substr( 0, 3 * 16 - 1 ) );
+    EXPECT_THROW( comma::csv::index i( truncated_index ), comma::exception );
+}
+
+TEST( csv, index_time )
+{
+    comma::csv::format format( "t,d" );
+    boost::posix_time::ptime start = boost::posix_time::from_iso_string( "20140101T000000" );
+    std::ostringstream oss;
+    for( std::size_t i = 0; i < 100; ++i )
+    {
+        comma::int64 t = comma::csv::index::key( start + boost::posix_time::seconds( i ) );
+        double d = i;
+        oss.write( reinterpret_cast< const char* >( &t ), sizeof( t ) );
+        oss.write( reinterpret_cast< const char* >( &d ), sizeof( d ) );
+    }
+    std::istringstream iss( oss.str() );
+    comma::csv::index index( iss, format, 0, 10 );
+    EXPECT_EQ( 9u, index.entries().size() );
+    EXPECT_EQ( 0u, index.seek( start ) );
+    EXPECT_EQ( 0u, index.seek( start - boost::posix_time::hours( 1 ) ) );
+    EXPECT_EQ( 10u * 16, index.seek( start + boost::posix_time::seconds( 10 ) ) );
+    EXPECT_EQ( 20u * 16, index.seek( start + boost::posix_time::seconds( 25 ) ) );
+    EXPECT_EQ( 90u * 16, index.seek( start + boost::posix_time::hours( 1 ) ) );
+    for( std::size_t i = 0; i < 100; ++i ) // all records before the offset are earlier
+    {
+        boost::posix_time::ptime t = start + boost::posix_time::seconds( i );
+        EXPECT_LE( index.seek( t ), i * 16 );
+    }
+    EXPECT_THROW( index.seek( boost::posix_time::ptime() ), comma::exception );
+}
+
+TEST( csv, index_bisect )
+{
+    comma::csv::format format( "d,t" );
+    boost::posix_time::ptime start = boost::posix_time::from_iso_string( "20140101T000000" );
+    std::ostringstream oss;
+    for( std::size_t i = 0; i < 100; ++i )
+    {
+        double d = i;
+        comma::int64 t = comma::csv::index::key( start + boost::posix_time::seconds( i / 2 * 2 ) ); // pairs of equal timestamps
+        oss.write( reinterpret_cast< const char* >( &d ), sizeof( d ) );
+        oss.write( reinterpret_cast< const char* >( &t ), sizeof( t ) );
+    }
+    std::istringstream iss( oss.str() );
+    EXPECT_EQ( 0u, comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start - boost::posix_time::seconds( 1 ) ) ) );
+    EXPECT_EQ( 0u, comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start ) ) );
+    EXPECT_EQ( 2u * 16, comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start + boost::posix_time::seconds( 1 ) ) ) );
+    EXPECT_EQ( 50u * 16, comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start + boost::posix_time::seconds( 50 ) ) ) );
+    EXPECT_EQ( 100u * 16, comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start + boost::posix_time::hours( 1 ) ) ) );
+    comma::csv::index::bisect( iss, format, 1, comma::csv::index::key( start + boost::posix_time::seconds( 51 ) ) );
+    double d;
+    iss.read( reinterpret_cast< char* >( &d ), sizeof( d ) );
+    EXPECT_EQ( 52, d );
+}
@@ -0,0 +1,107 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/csv/impl/iso_time.h>
+
+namespace comma { namespace csv { namespace iso_time_test {
+
+static std::string parsed( const std::string& s, bool fast )
+{
+    try { return boost::posix_time::to_iso_string( fast ? impl::from_iso_string( s ) : boost::posix_time::from_iso_string( s ) ); }
+    catch( std::exception& ex ) { return std::string( "exception: " ) + ex.what(); }
+}
+
+TEST( csv, iso_time_from_string )
+{
+    const char* values[] = { "20110304T111111", "20110304T111111.1234", "20110304T111111,1234", "20110304T111111.123456", "20110304T111111.1234567"
+                           , "20110304T111111.000000", "20110304T111111.", "20110304T111111.12a", "20110304T11111", "20110304T1111", "20110304T251111"
+                           , "20110304T116111", "20110304T115999", "20111304T111111", "20110230T111111", "20120229T000000", "20130229T000000"
+                           , "14000101T000000", "13990101T000000", "99991231T235959.999999", "not-a-date-time", "+infinity", "-infinity", ""
+                           , "20110304", "20110304T111111Z", " 20110304T111111", "2011-03-04T11:11:11", "20110304T-11111", "201103041T11111"
+                           , "2011030aT111111", "20110304t111111", "20110304T111111.1", "20110304T111111.0000001" };
+    for( std::size_t i = 0; i < sizeof( values ) / sizeof( values[0] ); ++i ) { EXPECT_EQ( parsed( values[i], false ), parsed( values[i], true ) ) << values[i]; }
+    ::srand( 1 );
+    char buf[64];
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        ::snprintf( buf, sizeof( buf ), "%04d%02d%02dT%02d%02d%02d.%0*d", 1400 + ::rand() % 8600, 1 + ::rand() % 12, 1 + ::rand() % 31
+                  , ::rand() % 24, ::rand() % 60, ::rand() % 60, 1 + i % 9, ::rand() % 1000000000 );
+        std::string s( buf, i % 10 == 0 ? 15 : 17 + i % 9 );
+        EXPECT_EQ( parsed( s, false ), parsed( s, true ) ) << s;
+    }
+}
+
+TEST( csv, iso_time_to_string )
+{
+    EXPECT_EQ( "not-a-date-time", impl::to_iso_string( boost::posix_time::not_a_date_time ) );
+    EXPECT_EQ( "+infinity", impl::to_iso_string( boost::posix_time::pos_infin ) );
+    EXPECT_EQ( "-infinity", impl::to_iso_string( boost::posix_time::neg_infin ) );
+    boost::posix_time::ptime t( boost::gregorian::date( 1400, 1, 1 ) );
+    EXPECT_EQ( boost::posix_time::to_iso_string( t ), impl::to_iso_string( t ) );
+    t = boost::posix_time::ptime( boost::gregorian::date( 9999, 12, 31 ), boost::posix_time::time_duration( 23, 59, 59, 999999 ) );
+    EXPECT_EQ( boost::posix_time::to_iso_string( t ), impl::to_iso_string( t ) );
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        boost::posix_time::ptime t( boost::gregorian::date( 1970, 1, 1 ), boost::posix_time::seconds( ::rand() ) + boost::posix_time::microseconds( i % 3 == 0 ? 0 : ::rand() % 1000000 ) );
+        EXPECT_EQ( boost::posix_time::to_iso_string( t ), impl::to_iso_string( t ) );
+        EXPECT_EQ( t, impl::from_iso_string( impl::to_iso_string( t ) ) );
+    }
+}
+
+TEST( csv, DISABLED_iso_time_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    std::vector< std::string > values;
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        boost::posix_time::ptime t( boost::gregorian::date( 1970, 1, 1 ), boost::posix_time::seconds( ::rand() ) + boost::posix_time::microseconds( ::rand() % 1000000 ) );
+        values.push_back( boost::posix_time::to_iso_string( t ) );
+    }
+    std::vector< boost::posix_time::ptime > times( values.size() );
+    std::vector< boost::posix_time::ptime > parsed( values.size() );
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for( std::size_t i = 0; i < values.size(); ++i ) { times[i] = boost::posix_time::from_iso_string( values[i] ); }
+    boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+    for( std::size_t i = 0; i < values.size(); ++i ) { parsed[i] = impl::from_iso_string( values[i] ); }
+    boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "from_iso_string: boost: " << ( middle - start ).total_microseconds() * 1000 / values.size() << "ns"
+              << "; impl: " << ( end - middle ).total_microseconds() * 1000 / values.size() << "ns per value" << std::endl;
+    EXPECT_TRUE( times == parsed );
+    std::size_t size = 0;
+    std::size_t printed_size = 0;
+    char buf[ impl::iso_time_size ];
+    start = boost::posix_time::microsec_clock::universal_time();
+    for( std::size_t i = 0; i < times.size(); ++i ) { size += boost::posix_time::to_iso_string( times[i] ).size(); }
+    middle = boost::posix_time::microsec_clock::universal_time();
+    for( std::size_t i = 0; i < times.size(); ++i ) { printed_size += impl::to_iso_string( buf, times[i] ) - buf; }
+    end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "to_iso_string: boost: " << ( middle - start ).total_microseconds() * 1000 / times.size() << "ns"
+              << "; impl: " << ( end - middle ).total_microseconds() * 1000 / times.size() << "ns per value" << std::endl;
+    EXPECT_EQ( size, printed_size );
+}
+
+} } } // namespace comma { namespace csv { namespace iso_time_test {
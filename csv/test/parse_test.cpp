@@ -0,0 +1,165 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <comma/base/types.h>
+#include <comma/csv/impl/parse.h>
+
+namespace comma { namespace csv { namespace parse_test {
+
+template < typename T > static bool parses( const std::string& s ) { T t; return impl::parse( s.data(), s.size(), t ); }
+
+static double strtod_( const std::string& s ) { return ::strtod( s.c_str(), NULL ); }
+
+TEST( csv, parse_integer )
+{
+    EXPECT_EQ( 0, impl::parse< int >( "0" ) );
+    EXPECT_EQ( 123, impl::parse< int >( "123" ) );
+    EXPECT_EQ( 123, impl::parse< int >( "+123" ) );
+    EXPECT_EQ( -123, impl::parse< int >( "-123" ) );
+    EXPECT_EQ( 7, impl::parse< int >( "0007" ) );
+    EXPECT_EQ( std::numeric_limits< comma::int32 >::max(), impl::parse< comma::int32 >( "2147483647" ) );
+    EXPECT_EQ( std::numeric_limits< comma::int32 >::min(), impl::parse< comma::int32 >( "-2147483648" ) );
+    EXPECT_EQ( std::numeric_limits< comma::uint32 >::max(), impl::parse< comma::uint32 >( "4294967295" ) );
+    EXPECT_EQ( std::numeric_limits< comma::int64 >::min(), impl::parse< comma::int64 >( "-9223372036854775808" ) );
+    EXPECT_EQ( std::numeric_limits< comma::uint64 >::max(), impl::parse< comma::uint64 >( "18446744073709551615" ) );
+    EXPECT_EQ( 65535, impl::parse< comma::uint16 >( "65535" ) );
+    EXPECT_EQ( -32768, impl::parse< comma::int16 >( "-32768" ) );
+    EXPECT_FALSE( parses< comma::int32 >( "2147483648" ) );
+    EXPECT_FALSE( parses< comma::int32 >( "-2147483649" ) );
+    EXPECT_FALSE( parses< comma::uint32 >( "4294967296" ) );
+    EXPECT_FALSE( parses< comma::uint64 >( "18446744073709551616" ) );
+    EXPECT_FALSE( parses< comma::uint16 >( "65536" ) );
+    EXPECT_FALSE( parses< comma::uint32 >( "-1" ) );
+    EXPECT_FALSE( parses< int >( "" ) );
+    EXPECT_FALSE( parses< int >( "-" ) );
+    EXPECT_FALSE( parses< int >( "+" ) );
+    EXPECT_FALSE( parses< int >( "1.0" ) );
+    EXPECT_FALSE( parses< int >( " 1" ) );
+    EXPECT_FALSE( parses< int >( "1 " ) );
+    EXPECT_FALSE( parses< int >( "1a" ) );
+    EXPECT_THROW( impl::parse< int >( "abc" ), comma::exception );
+}
+
+TEST( csv, parse_floating_point )
+{
+    EXPECT_EQ( 0.0, impl::parse< double >( "0" ) );
+    EXPECT_EQ( 1.5, impl::parse< double >( "1.5" ) );
+    EXPECT_EQ( -1.5, impl::parse< double >( "-1.5" ) );
+    EXPECT_EQ( 0.5, impl::parse< double >( ".5" ) );
+    EXPECT_EQ( 5.0, impl::parse< double >( "5." ) );
+    EXPECT_EQ( 1e10, impl::parse< double >( "1e10" ) );
+    EXPECT_EQ( 1.5e-10, impl::parse< double >( "1.5E-10" ) );
+    EXPECT_EQ( 1e300, impl::parse< double >( "1e+300" ) );
+    EXPECT_EQ( 1234.56f, impl::parse< float >( "1234.56" ) );
+    EXPECT_TRUE( std::signbit( impl::parse< double >( "-0" ) ) );
+    EXPECT_TRUE( std::isnan( impl::parse< double >( "nan" ) ) );
+    EXPECT_TRUE( std::isnan( impl::parse< float >( "NaN" ) ) );
+    EXPECT_EQ( std::numeric_limits< double >::infinity(), impl::parse< double >( "inf" ) );
+    EXPECT_EQ( -std::numeric_limits< double >::infinity(), impl::parse< double >( "-Infinity" ) );
+    EXPECT_EQ( 0.0, impl::parse< double >( "1e-400" ) );
+    EXPECT_FALSE( parses< double >( "1e400" ) );
+    EXPECT_FALSE( parses< float >( "1e40" ) );
+    EXPECT_FALSE( parses< double >( "" ) );
+    EXPECT_FALSE( parses< double >( "." ) );
+    EXPECT_FALSE( parses< double >( "-" ) );
+    EXPECT_FALSE( parses< double >( "e5" ) );
+    EXPECT_FALSE( parses< double >( "1e" ) );
+    EXPECT_FALSE( parses< double >( "1e+" ) );
+    EXPECT_FALSE( parses< double >( "1.2.3" ) );
+    EXPECT_FALSE( parses< double >( "1,2" ) );
+    EXPECT_FALSE( parses< double >( "0x10" ) );
+    EXPECT_FALSE( parses< double >( "infinit" ) );
+    EXPECT_FALSE( parses< double >( " 1" ) );
+    EXPECT_THROW( impl::parse< double >( "abc" ), comma::exception );
+}
+
+TEST( csv, parse_floating_point_exact )
+{
+    const char* values[] = { "0.1", "0.2", "0.3", "3.141592653589793", "2.718281828459045", "1.7976931348623157e308", "2.2250738585072014e-308"
+                           , "4.9406564584124654e-324", "9007199254740993", "123456789012345678901234567890", "0.000000000000000000000000000001"
+                           , "1.00000000000000011102230246251565404236316680908203125", "1.000000000000000111022302462515654042363166809082031251"
+                           , "7.038531e-26", "89255.0e-22", "1e23", "8.98846567431158e307", "1234.123456789012", "-0.000123456789" };
+    for( std::size_t i = 0; i < sizeof( values ) / sizeof( values[0] ); ++i )
+    {
+        EXPECT_EQ( strtod_( values[i] ), impl::parse< double >( values[i] ) ) << values[i];
+        if( std::fabs( strtod_( values[i] ) ) < std::numeric_limits< float >::max() ) { EXPECT_EQ( ::strtof( values[i], NULL ), impl::parse< float >( values[i] ) ) << values[i]; }
+    }
+    ::srand( 1 );
+    char buf[64];
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        comma::uint64 bits = ( comma::uint64( ::rand() ) << 40 ) ^ ( comma::uint64( ::rand() ) << 20 ) ^ comma::uint64( ::rand() );
+        double d;
+        ::memcpy( &d, &bits, sizeof( double ) );
+        if( std::isnan( d ) || std::isinf( d ) ) { continue; }
+        ::snprintf( buf, sizeof( buf ), "%.17g", d );
+        EXPECT_EQ( d, impl::parse< double >( buf ) ) << buf;
+        ::snprintf( buf, sizeof( buf ), "%.*f", int( i % 9 ), double( ::rand() ) / ( 1 + ::rand() % 1000 ) );
+        EXPECT_EQ( strtod_( buf ), impl::parse< double >( buf ) ) << buf;
+        EXPECT_EQ( ::strtof( buf, NULL ), impl::parse< float >( buf ) ) << buf;
+    }
+}
+
+TEST( csv, DISABLED_parse_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    std::vector< std::string > doubles;
+    std::vector< std::string > integers;
+    char buf[64];
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        ::snprintf( buf, sizeof( buf ), "%.*f", int( i % 7 ), double( ::rand() ) / 1000 );
+        doubles.push_back( buf );
+        ::snprintf( buf, sizeof( buf ), "%d", ::rand() - RAND_MAX / 2 );
+        integers.push_back( buf );
+    }
+    const unsigned int repeat = 20;
+    double sum = 0;
+    double parsed_sum = 0;
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < doubles.size(); ++i ) { sum += boost::lexical_cast< double >( doubles[i] ); } }
+    boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < doubles.size(); ++i ) { parsed_sum += impl::parse< double >( doubles[i] ); } }
+    boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "double: boost::lexical_cast: " << ( middle - start ).total_microseconds() * 1000 / ( repeat * doubles.size() ) << "ns"
+              << "; impl::parse: " << ( end - middle ).total_microseconds() * 1000 / ( repeat * doubles.size() ) << "ns per value" << std::endl;
+    comma::int64 total = 0;
+    comma::int64 parsed_total = 0;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < integers.size(); ++i ) { total += boost::lexical_cast< comma::int32 >( integers[i] ); } }
+    middle = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < integers.size(); ++i ) { parsed_total += impl::parse< comma::int32 >( integers[i] ); } }
+    end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "int32: boost::lexical_cast: " << ( middle - start ).total_microseconds() * 1000 / ( repeat * integers.size() ) << "ns"
+              << "; impl::parse: " << ( end - middle ).total_microseconds() * 1000 / ( repeat * integers.size() ) << "ns per value" << std::endl;
+    EXPECT_EQ( total, parsed_total );
+    EXPECT_EQ( sum, parsed_sum );
+}
+
+} } } // namespace comma { namespace csv { namespace parse_test {
@@ -0,0 +1,175 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <comma/base/types.h>
+#include <comma/csv/format.h>
+#include <comma/csv/impl/parse.h>
+#include <comma/csv/impl/print.h>
+
+namespace comma { namespace csv { namespace print_test {
+
+template < typename T > static std::string printed( T t ) { char buf[ impl::print_size ]; return std::string( buf, impl::print( buf, t ) ); }
+
+template < typename T > static std::string printed( T t, unsigned int precision ) { char buf[ impl::print_size ]; return std::string( buf, impl::print( buf, t, precision ) ); }
+
+template < typename T > static std::string streamed( T t, unsigned int precision ) { std::ostringstream oss; oss.precision( precision ); oss << t; return oss.str(); }
+
+TEST( csv, print_integer )
+{
+    EXPECT_EQ( "0", printed( 0 ) );
+    EXPECT_EQ( "7", printed( 7 ) );
+    EXPECT_EQ( "-7", printed( -7 ) );
+    EXPECT_EQ( "10", printed( 10 ) );
+    EXPECT_EQ( "100", printed( 100u ) );
+    EXPECT_EQ( "1234567890", printed( 1234567890 ) );
+    EXPECT_EQ( "1", printed( true ) );
+    EXPECT_EQ( "-128", printed( std::numeric_limits< signed char >::min() ) );
+    EXPECT_EQ( "255", printed( std::numeric_limits< unsigned char >::max() ) );
+    EXPECT_EQ( "-32768", printed( std::numeric_limits< comma::int16 >::min() ) );
+    EXPECT_EQ( "65535", printed( std::numeric_limits< comma::uint16 >::max() ) );
+    EXPECT_EQ( "-2147483648", printed( std::numeric_limits< comma::int32 >::min() ) );
+    EXPECT_EQ( "4294967295", printed( std::numeric_limits< comma::uint32 >::max() ) );
+    EXPECT_EQ( "-9223372036854775808", printed( std::numeric_limits< comma::int64 >::min() ) );
+    EXPECT_EQ( "9223372036854775807", printed( std::numeric_limits< comma::int64 >::max() ) );
+    EXPECT_EQ( "18446744073709551615", printed( std::numeric_limits< comma::uint64 >::max() ) );
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 10000; ++i )
+    {
+        comma::int64 v = ( comma::int64( ::rand() ) << 33 ) ^ ( comma::int64( ::rand() ) >> ( i % 31 ) );
+        if( i % 2 ) { v = -v; }
+        EXPECT_EQ( streamed( v, 6 ), printed( v ) );
+    }
+}
+
+TEST( csv, print_floating_point )
+{
+    EXPECT_EQ( "0", printed( 0.0, 6 ) );
+    EXPECT_EQ( "-0", printed( -0.0, 6 ) );
+    EXPECT_EQ( "1234.56", printed( 1234.56f, 6 ) );
+    EXPECT_EQ( "1234.123456789012", printed( 1234.123456789012, 16 ) );
+    EXPECT_EQ( "1e+06", printed( 1000000.0, 6 ) );
+    EXPECT_EQ( "100000", printed( 100000.0, 6 ) );
+    EXPECT_EQ( "1e+01", printed( 10.0, 1 ) );
+    EXPECT_EQ( "nan", printed( std::numeric_limits< double >::quiet_NaN(), 6 ) );
+    EXPECT_EQ( "inf", printed( std::numeric_limits< double >::infinity(), 6 ) );
+    EXPECT_EQ( "-inf", printed( -std::numeric_limits< float >::infinity(), 6 ) );
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        comma::uint64 bits = ( comma::uint64( ::rand() ) << 40 ) ^ ( comma::uint64( ::rand() ) << 20 ) ^ comma::uint64( ::rand() );
+        double d;
+        ::memcpy( &d, &bits, sizeof( double ) );
+        double r = double( ::rand() - RAND_MAX / 2 ) / ( 1 + ::rand() % 1000 );
+        unsigned int precision = i % 21;
+        EXPECT_EQ( streamed( d, precision ), printed( d, precision ) );
+        EXPECT_EQ( streamed( r, precision ), printed( r, precision ) );
+        EXPECT_EQ( streamed( float( r ), precision ), printed( float( r ), precision ) );
+        EXPECT_EQ( streamed( std::floor( r ), precision ), printed( std::floor( r ), precision ) );
+    }
+}
+
+TEST( csv, print_floating_point_shortest )
+{
+    EXPECT_EQ( "0.1", printed( 0.1, impl::print_shortest ) );
+    EXPECT_EQ( "0.1", printed( 0.1f, impl::print_shortest ) );
+    EXPECT_EQ( "0.30000000000000004", printed( 0.1 + 0.2, impl::print_shortest ) );
+    EXPECT_EQ( "1234.123456789012", printed( 1234.123456789012, impl::print_shortest ) );
+    EXPECT_EQ( "5e-324", printed( 4.9406564584124654e-324, impl::print_shortest ) );
+    EXPECT_EQ( "1.7976931348623157e+308", printed( std::numeric_limits< double >::max(), impl::print_shortest ) );
+    EXPECT_EQ( "123456789", printed( 123456789.0, impl::print_shortest ) );
+    EXPECT_EQ( "1e+15", printed( 1e15, impl::print_shortest ) );
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        comma::uint64 bits = ( comma::uint64( ::rand() ) << 40 ) ^ ( comma::uint64( ::rand() ) << 20 ) ^ comma::uint64( ::rand() );
+        double d;
+        ::memcpy( &d, &bits, sizeof( double ) );
+        if( std::isnan( d ) ) { continue; }
+        std::string s = printed( d, impl::print_shortest );
+        EXPECT_EQ( d, impl::parse< double >( s ) ) << s;
+        float f = float( double( ::rand() ) / ( 1 + ::rand() % 1000 ) );
+        s = printed( f, impl::print_shortest );
+        EXPECT_EQ( f, impl::parse< float >( s ) ) << s;
+    }
+}
+
+TEST( csv, print_format_bin_to_csv )
+{
+    comma::csv::format f( "b,ub,w,uw,i,ui,l,ul,c,f,d,s[4]" );
+    std::string bin = f.csv_to_bin( "-1,255,-300,60000,-70000,4000000000,-5000000000,18446744073709551615,x,0.5,0.1,abc" );
+    EXPECT_EQ( "-1,255,-300,60000,-70000,4000000000,-5000000000,18446744073709551615,x,0.5,0.1,abc", f.bin_to_csv( bin ) );
+    std::string csv = "junk";
+    f.bin_to_csv( &bin[0], csv, ';', impl::print_shortest );
+    EXPECT_EQ( "-1;255;-300;60000;-70000;4000000000;-5000000000;18446744073709551615;x;0.5;0.1;abc", csv );
+    comma::csv::format d( "d,d" );
+    bin = d.csv_to_bin( "0.30000000000000004,3.14159265358979" );
+    EXPECT_EQ( "0.3,3.14159265358979", d.bin_to_csv( bin ) );
+    EXPECT_EQ( "0.30000000000000004,3.14159265358979", d.bin_to_csv( bin, ',', impl::print_shortest ) );
+    EXPECT_EQ( "0.3,3.142", d.bin_to_csv( bin, ',', 4 ) );
+    EXPECT_EQ( "0.3,3", d.bin_to_csv( bin, ',', 0 ) ); // as std::ostream with precision 0
+}
+
+TEST( csv, DISABLED_print_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    std::vector< double > doubles;
+    std::vector< comma::int32 > integers;
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 100000; ++i )
+    {
+        doubles.push_back( double( ::rand() ) / ( 1 + ::rand() % 1000 ) );
+        integers.push_back( ::rand() - RAND_MAX / 2 );
+    }
+    const unsigned int repeat = 10;
+    std::size_t size = 0;
+    std::size_t printed_size = 0;
+    char buf[ impl::print_size ];
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < doubles.size(); ++i ) { std::ostringstream oss; oss.precision( 16 ); oss << doubles[i]; size += oss.str().size(); } }
+    boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < doubles.size(); ++i ) { printed_size += impl::print( buf, doubles[i], 16 ) - buf; } }
+    boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < doubles.size(); ++i ) { impl::print( buf, doubles[i], impl::print_shortest ); } }
+    boost::posix_time::ptime shortest = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "double: std::ostringstream: " << ( middle - start ).total_microseconds() * 1000 / ( repeat * doubles.size() ) << "ns"
+              << "; impl::print: " << ( end - middle ).total_microseconds() * 1000 / ( repeat * doubles.size() ) << "ns"
+              << "; impl::print shortest: " << ( shortest - end ).total_microseconds() * 1000 / ( repeat * doubles.size() ) << "ns per value" << std::endl;
+    EXPECT_EQ( size, printed_size );
+    size = printed_size = 0;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < integers.size(); ++i ) { std::ostringstream oss; oss << integers[i]; size += oss.str().size(); } }
+    middle = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < integers.size(); ++i ) { printed_size += impl::print( buf, integers[i] ) - buf; } }
+    end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "int32: std::ostringstream: " << ( middle - start ).total_microseconds() * 1000 / ( repeat * integers.size() ) << "ns"
+              << "; impl::print: " << ( end - middle ).total_microseconds() * 1000 / ( repeat * integers.size() ) << "ns per value" << std::endl;
+    EXPECT_EQ( size, printed_size );
+}
+
+} } } // namespace comma { namespace csv { namespace print_test {
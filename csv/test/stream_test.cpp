@@ -16,10 +16,14 @@
 // You should have received a copy of the GNU Lesser General Public
 // License along with comma. If not, see <http://www.gnu.org/licenses/>.
 
+#include <stdlib.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
+#include <fstream>
 #include <sstream>
 #include <vector>
 #include <boost/array.hpp>
+#include <boost/lexical_cast.hpp>
 //#include <google/profiler.h>
 #include <comma/base/types.h>
 #include <comma/csv/stream.h>
@@ -59,6 +63,257 @@ template <> struct traits< comma::csv::test::test_struct >
 
 namespace comma { namespace csv { namespace test {
 
+TEST( csv, ascii_input_stream )
+{
+    {
+        std::istringstream iss( "1,2\n\n3,4\r\n5,6" );
+        comma::csv::ascii_input_stream< test_struct > istream( iss );
+        const test_struct* s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 1u, s->x );
+        EXPECT_EQ( 2u, s->y );
+        EXPECT_EQ( 2u, istream.last().size() );
+        EXPECT_EQ( "1", istream.last()[0] );
+        s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 3u, s->x );
+        EXPECT_EQ( 4u, s->y );
+        EXPECT_EQ( "4", istream.last()[1] );
+        s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 5u, s->x );
+        EXPECT_EQ( 6u, s->y );
+        EXPECT_EQ( "6", istream.last_fields()[1].to_string() );
+        EXPECT_TRUE( istream.read() == NULL );
+        EXPECT_TRUE( iss.eof() );
+    }
+    {
+        std::string tail( 200000, 'a' ); // longer than the block size
+        std::istringstream iss( "1,2," + tail + "\n3,4,,\n" );
+        comma::csv::ascii_input_stream< test_struct > istream( iss, "x,y" );
+        const test_struct* s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 2u, s->y );
+        EXPECT_EQ( 3u, istream.last().size() );
+        EXPECT_EQ( tail, istream.last()[2] );
+        s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 3u, s->x );
+        EXPECT_EQ( 4u, istream.last().size() );
+        EXPECT_TRUE( istream.read() == NULL );
+    }
+    {
+        std::istringstream iss( "0,7\n" );
+        comma::csv::ascii_input_stream< test_struct > istream( iss, "y" );
+        const test_struct* s = istream.read();
+        EXPECT_TRUE( s != NULL );
+        EXPECT_EQ( 0u, s->y );
+    }
+}
+
+TEST( csv, ascii_input_stream_threads )
+{
+    std::ostringstream oss;
+    for( unsigned int i = 0; i < 50000; ++i ) { oss << i << "," << ( i * 2 ) << ( i % 3 == 0 ? "\r\n" : "\n" ); }
+    oss << "\n" << "50000,100000"; // empty line skipped, last line without end of line
+    {
+        std::istringstream iss( oss.str() );
+        comma::csv::ascii_input_stream< test_struct > istream( iss, "x,y" );
+        istream.threads( 4 );
+        for( unsigned int i = 0; i <= 50000; ++i )
+        {
+            const test_struct* s = istream.read();
+            ASSERT_TRUE( s != NULL );
+            EXPECT_EQ( i, s->x );
+            EXPECT_EQ( i * 2, s->y );
+            if( i % 10000 == 0 ) { EXPECT_EQ( boost::lexical_cast< std::string >( i * 2 ), istream.last()[1] ); }
+        }
+        EXPECT_TRUE( istream.read() == NULL );
+    }
+    {
+        std::istringstream iss( "1,2\n3,4\nblah,6\n7,8\n" );
+        comma::csv::ascii_input_stream< test_struct > istream( iss, "x,y" );
+        istream.threads( 2 );
+        EXPECT_EQ( 1u, istream.read()->x );
+        EXPECT_EQ( 3u, istream.read()->x );
+        EXPECT_THROW( istream.read(), comma::exception );
+    }
+}
+
+TEST( csv, ascii_stream_passthrough )
+{
+    std::istringstream iss( "1, 2.50 ,abc\r\n3,4,\"d,e\"\n" );
+    std::ostringstream oss;
+    comma::csv::ascii_input_stream< test_struct > istream( iss, "x" );
+    comma::csv::ascii_output_stream< test_struct > ostream( oss, ",y" );
+    const test_struct* s = istream.read();
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( "1, 2.50 ,abc", istream.last_line().to_string() );
+    ostream.write( test_struct( 0, 7 ), istream.last_fields() );
+    s = istream.read();
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( "3,4,\"d,e\"", istream.last_line().to_string() );
+    ostream.write( test_struct( 0, 8 ), istream.last_line() );
+    ostream.write( test_struct( 0, 9 ), std::string( "a,b" ) );
+    EXPECT_EQ( "1,7,abc\n3,8,\"d,e\"\na,9\n", oss.str() );
+}
+
+TEST( csv, ascii_input_stream_timeout )
+{
+    std::stringstream ss;
+    ss << "1,2\n3,";
+    comma::csv::ascii_input_stream< test_struct > istream( ss, "x,y" );
+    EXPECT_FALSE( istream.ready() );
+    boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 10 );
+    const test_struct* s = istream.read( deadline );
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( 1u, s->x );
+    EXPECT_EQ( 2u, s->y );
+    EXPECT_FALSE( istream.ready() );
+    deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 10 );
+    EXPECT_TRUE( istream.read( deadline ) == NULL ); // incomplete line
+    EXPECT_GE( boost::posix_time::microsec_clock::universal_time(), deadline );
+    ss << "4\n5,6\n";
+    s = istream.read( boost::posix_time::microsec_clock::universal_time() );
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( 3u, s->x );
+    EXPECT_EQ( 4u, s->y );
+    EXPECT_TRUE( istream.ready() );
+    EXPECT_EQ( 5u, istream.read()->x );
+}
+
+TEST( csv, binary_input_stream_timeout )
+{
+    std::string bin;
+    for( comma::uint32 i = 0; i < 4; ++i ) { bin.append( reinterpret_cast< const char* >( &i ), sizeof( comma::uint32 ) ); }
+    std::stringstream ss;
+    ss.write( &bin[0], 6 );
+    comma::csv::binary_input_stream< test_struct > istream( ss, "%ui%ui", "x,y" );
+    boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 10 );
+    EXPECT_TRUE( istream.read( deadline ) == NULL ); // incomplete record
+    ss.write( &bin[6], 10 );
+    const test_struct* s = istream.read( boost::posix_time::microsec_clock::universal_time() );
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( 0u, s->x );
+    EXPECT_EQ( 1u, s->y );
+    EXPECT_TRUE( istream.ready() );
+    s = istream.read( boost::posix_time::microsec_clock::universal_time() );
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( 2u, s->x );
+    EXPECT_EQ( 3u, s->y );
+    EXPECT_FALSE( istream.ready() );
+}
+
+TEST( csv, binary_input_stream_batch )
+{
+    std::string bin;
+    for( comma::uint32 i = 0; i < 10; ++i ) { bin.append( reinterpret_cast< const char* >( &i ), sizeof( comma::uint32 ) ); bin.append( 4, 0 ); }
+    std::istringstream iss( bin );
+    comma::csv::binary_input_stream< test_struct > istream( iss, "%ui%ui", "x" );
+    std::vector< test_struct > records( 4, test_struct( 7, 7 ) );
+    EXPECT_EQ( 4u, istream.read_batch( &records[0], 4 ) );
+    EXPECT_EQ( 4u, istream.last_batch_size() );
+    EXPECT_EQ( 0, ::memcmp( istream.last_batch(), &bin[0], 4 * 8 ) );
+    for( comma::uint32 i = 0; i < 4; ++i ) { EXPECT_EQ( i, records[i].x ); EXPECT_EQ( 0u, records[i].y ); }
+    EXPECT_EQ( 4u, istream.read_batch( &records[0], 4 ) );
+    EXPECT_EQ( 7u, records[3].x );
+    const test_struct* s = istream.read();
+    ASSERT_TRUE( s != NULL );
+    EXPECT_EQ( 8u, s->x );
+    EXPECT_EQ( 1u, istream.read_batch( &records[0], 4 ) );
+    EXPECT_EQ( 9u, records[0].x );
+    EXPECT_EQ( 0, ::memcmp( istream.last_batch(), &bin[ 9 * 8 ], 8 ) );
+    EXPECT_EQ( 0u, istream.read_batch( &records[0], 4 ) );
+}
+
+TEST( csv, binary_input_stream_mapped )
+{
+    char name[] = "/tmp/comma-csv-stream-test-XXXXXX";
+    int fd = ::mkstemp( name );
+    ASSERT_TRUE( fd >= 0 );
+    ::close( fd );
+    std::string bin;
+    for( comma::uint32 i = 0; i < 8; ++i ) { bin.append( reinterpret_cast< const char* >( &i ), sizeof( comma::uint32 ) ); }
+    { std::ofstream ofs( name ); ofs.write( &bin[0], 16 ); }
+    {
+        comma::io::mapped_ifstream ifs( name );
+        const comma::io::mapped_streambuf* mapped = dynamic_cast< const comma::io::mapped_streambuf* >( ifs.rdbuf() );
+        ASSERT_TRUE( mapped != NULL );
+        comma::csv::binary_input_stream< test_struct > istream( ifs, "%ui%ui", "x,y" );
+        const test_struct* s = istream.read();
+        ASSERT_TRUE( s != NULL );
+        EXPECT_EQ( 0u, s->x );
+        EXPECT_EQ( mapped->data() - 8, istream.last() ); // points into the mapping
+        EXPECT_TRUE( istream.ready() );
+        std::vector< test_struct > records( 4 );
+        EXPECT_EQ( 1u, istream.read_batch( &records[0], 4 ) );
+        EXPECT_EQ( 2u, records[0].x );
+        EXPECT_EQ( mapped->data() - 8, istream.last_batch() );
+        EXPECT_FALSE( istream.ready() );
+        EXPECT_TRUE( istream.read() == NULL );
+        { std::ofstream ofs( name, std::ios::app ); ofs.write( &bin[16], 16 ); } // file grows, e.g. still being recorded
+        EXPECT_EQ( 2u, istream.read_batch( &records[0], 4 ) );
+        EXPECT_EQ( 4u, records[0].x );
+        EXPECT_EQ( 7u, records[1].y );
+        { std::ofstream ofs( name, std::ios::app ); ofs.write( &bin[0], 3 ); }
+        EXPECT_THROW( istream.read(), comma::exception );
+    }
+    ::unlink( name );
+}
+
+TEST( csv, binary_output_stream_buffering )
+{
+    {
+        std::ostringstream oss;
+        comma::csv::binary_output_stream< test_struct > ostream( oss );
+        ostream.write( test_struct( 1, 2 ) );
+        EXPECT_EQ( 8u, oss.str().size() ); // writes through by default
+    }
+    {
+        std::ostringstream oss;
+        {
+            comma::csv::binary_output_stream< test_struct > ostream( oss );
+            ostream.policy( comma::csv::flush_policy( 20 ) ); // rounded down to 2 records
+            ostream.write( test_struct( 1, 2 ) );
+            EXPECT_EQ( 0u, oss.str().size() );
+            ostream.write( test_struct( 3, 4 ) );
+            EXPECT_EQ( 16u, oss.str().size() );
+            ostream.write( test_struct( 5, 6 ) );
+            EXPECT_EQ( 16u, oss.str().size() );
+            ostream.flush();
+            EXPECT_EQ( 24u, oss.str().size() );
+            ostream.write( test_struct( 7, 8 ) );
+        }
+        EXPECT_EQ( 32u, oss.str().size() ); // flushed on destruction
+        std::istringstream iss( oss.str() );
+        comma::csv::binary_input_stream< test_struct > istream( iss );
+        for( unsigned int i = 1; i < 8; i += 2 )
+        {
+            const test_struct* s = istream.read();
+            EXPECT_TRUE( s != NULL );
+            EXPECT_EQ( i, s->x );
+            EXPECT_EQ( i + 1, s->y );
+        }
+    }
+    {
+        std::ostringstream oss;
+        comma::csv::binary_output_stream< test_struct > ostream( oss );
+        ostream.policy( comma::csv::flush_policy( 1024, 3 ) );
+        ostream.write( test_struct( 1, 2 ) );
+        ostream.write( test_struct( 1, 2 ) );
+        EXPECT_EQ( 0u, oss.str().size() );
+        ostream.write( test_struct( 1, 2 ) );
+        EXPECT_EQ( 24u, oss.str().size() );
+    }
+    {
+        std::ostringstream oss;
+        comma::csv::binary_output_stream< test_struct > ostream( oss );
+        ostream.policy( comma::csv::flush_policy( 1024, 0, boost::posix_time::milliseconds( 0 ) ) );
+        ostream.write( test_struct( 1, 2 ) );
+        EXPECT_EQ( 8u, oss.str().size() );
+    }
+}
+
 TEST( csv, stream )
 {
 //	std::cerr << "ProfileStream(): start" << std::endl;
@@ -0,0 +1,292 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COMMA_IO_MAPPED_FILE_HEADER
+#define COMMA_IO_MAPPED_FILE_HEADER
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <fstream>
+#include <iostream>
+#include <boost/noncopyable.hpp>
+#include <comma/base/exception.h>
+#include <comma/io/file_descriptor.h>
+
+// all inline, since used by header-only csv streams, which do not link comma_io
+
+namespace comma { namespace io {
+
+/// read-only memory mapping of a window of a regular file from a given offset,
+/// advised for sequential reading (i.e. aggressive readahead)
+///
+/// the window is clamped to the file size at the time of mapping; if the file
+/// gets truncated while mapped (e.g. a log being rotated), reading past its
+/// new end raises SIGBUS, thus keep the window small for files that may shrink
+class mapped_file : public boost::noncopyable
+{
+    public:
+        /// default window size
+        enum { default_window = 16 * 1024 * 1024 };
+
+        /// constructor; the file descriptor is not owned and must stay open while mapped
+        mapped_file( file_descriptor fd, std::size_t offset = 0, std::size_t window = default_window );
+
+        /// destructor
+        ~mapped_file() { unmap_(); }
+
+        /// return true, if file descriptor refers to a regular file (i.e. can be mapped)
+        static bool regular( file_descriptor fd );
+
+        /// (re)map the window from given offset, up to the current end of file
+        void map( std::size_t offset );
+
+        /// return mapped data, i.e. file contents starting at offset()
+        const char* data() const { return data_; }
+
+        /// return number of mapped bytes
+        std::size_t size() const { return size_; }
+
+        /// return window size
+        std::size_t window() const { return window_; }
+
+        /// return offset in the file of the mapped data
+        std::size_t offset() const { return offset_; }
+
+        /// return current file size
+        std::size_t file_size() const;
+
+    private:
+        file_descriptor fd_;
+        void* map_;
+        std::size_t map_size_;
+        const char* data_;
+        std::size_t size_;
+        std::size_t offset_;
+        std::size_t window_;
+        void unmap_();
+};
+
+/// stream buffer reading a regular file through memory mapping, i.e. without copying it:
+/// the mapped window is readily available in the get area
+///
+/// once the window is read through, the next one gets mapped, clamped to the
+/// current file size; thus, if the file grows (e.g. a log still being recorded),
+/// the new data gets read and if it shrinks, reading ends at its new end
+class mapped_streambuf : public std::streambuf, public boost::noncopyable
+{
+    public:
+        /// constructor; the file descriptor is not owned and must stay open
+        mapped_streambuf( file_descriptor fd, std::size_t offset = 0, std::size_t window = mapped_file::default_window );
+
+        /// return unread data; valid till update() or underflow
+        const char* data() const { return gptr(); }
+
+        /// return number of bytes of unread data
+        std::size_t available() const { return egptr() - gptr(); }
+
+        /// mark given number of bytes (not greater than available()) as read
+        void consume( std::size_t n ) { setg( eback(), gptr() + n, egptr() ); }
+
+        /// map the window from the current position, if the file size has changed since
+        /// the last mapping or the window has been read through; return true, if more
+        /// data is available; invalidates pointers previously returned by data()
+        bool update();
+
+    protected:
+        int_type underflow();
+        std::streamsize showmanyc() { return available(); }
+        pos_type seekoff( off_type off, std::ios::seekdir way, std::ios::openmode which = std::ios::in );
+        pos_type seekpos( pos_type pos, std::ios::openmode which = std::ios::in );
+
+    private:
+        mapped_file file_;
+};
+
+/// input file stream that reads regular files through memory mapping
+/// and anything else (e.g. named pipes) as std::ifstream would
+class mapped_ifstream : public std::istream
+{
+    public:
+        /// constructor
+        mapped_ifstream( const char* name, std::ios::openmode mode = std::ios::in );
+
+        /// destructor
+        ~mapped_ifstream() { close(); }
+
+        /// return true, if file is open
+        bool is_open() const { return mapped_ || file_.is_open(); }
+
+        /// close file
+        void close();
+
+    private:
+        file_descriptor fd_;
+        mapped_streambuf* mapped_;
+        std::filebuf file_;
+};
+
+inline mapped_file::mapped_file( file_descriptor fd, std::size_t offset, std::size_t window )
+    : fd_( fd )
+    , map_( NULL )
+    , map_size_( 0 )
+    , data_( NULL )
+    , size_( 0 )
+    , offset_( offset )
+    , window_( window ? window : 1 )
+{
+    map( offset );
+}
+
+inline bool mapped_file::regular( file_descriptor fd )
+{
+    #ifndef WIN32
+    struct stat s;
+    return fd != invalid_file_descriptor && ::fstat( fd, &s ) == 0 && S_ISREG( s.st_mode );
+    #else
+    (void)fd;
+    return false;
+    #endif
+}
+
+inline std::size_t mapped_file::file_size() const
+{
+    #ifndef WIN32
+    struct stat s;
+    if( ::fstat( fd_, &s ) != 0 ) { COMMA_THROW( comma::exception, "failed to stat file descriptor " << fd_ ); }
+    return s.st_size;
+    #else
+    COMMA_THROW( comma::exception, "memory mapping: not implemented on windows" );
+    #endif
+}
+
+inline void mapped_file::map( std::size_t offset )
+{
+    #ifndef WIN32
+    std::size_t size = file_size();
+    unmap_();
+    offset_ = offset;
+    if( size <= offset ) { return; }
+    if( size - offset > window_ ) { size = offset + window_; }
+    static const std::size_t page_size = ::sysconf( _SC_PAGESIZE );
+    std::size_t aligned = offset - offset % page_size; // mapping offset must be a multiple of page size
+    void* m = ::mmap( NULL, size - aligned, PROT_READ, MAP_SHARED, fd_, aligned );
+    if( m == MAP_FAILED ) { COMMA_THROW( comma::exception, "failed to map file descriptor " << fd_ << " from offset " << offset ); }
+    ::madvise( m, size - aligned, MADV_SEQUENTIAL );
+    map_ = m;
+    map_size_ = size - aligned;
+    data_ = static_cast< const char* >( m ) + ( offset - aligned );
+    size_ = size - offset;
+    #else
+    (void)offset;
+    COMMA_THROW( comma::exception, "memory mapping: not implemented on windows" );
+    #endif
+}
+
+inline void mapped_file::unmap_()
+{
+    #ifndef WIN32
+    if( map_ ) { ::munmap( map_, map_size_ ); }
+    #endif
+    map_ = NULL;
+    map_size_ = 0;
+    data_ = NULL;
+    size_ = 0;
+}
+
+inline mapped_streambuf::mapped_streambuf( file_descriptor fd, std::size_t offset, std::size_t window ) : file_( fd, offset, window )
+{
+    char* begin = const_cast< char* >( file_.data() ); // the get area is never written to
+    setg( begin, begin, begin + file_.size() );
+}
+
+inline bool mapped_streambuf::update()
+{
+    std::size_t position = file_.offset() + ( gptr() - eback() );
+    std::size_t end = file_.offset() + file_.size();
+    if( file_.file_size() == end && file_.size() < file_.window() ) { return available() > 0; } // all the file is mapped
+    file_.map( position ); // remap from the current position, dropping the data already read
+    char* begin = const_cast< char* >( file_.data() );
+    setg( begin, begin, begin + file_.size() );
+    return available() > 0;
+}
+
+inline mapped_streambuf::pos_type mapped_streambuf::seekoff( off_type off, std::ios::seekdir way, std::ios::openmode which )
+{
+    off_type position = off;
+    if( way == std::ios::cur ) { position += file_.offset() + ( gptr() - eback() ); }
+    else if( way == std::ios::end ) { position += file_.file_size(); }
+    return seekpos( pos_type( position ), which );
+}
+
+inline mapped_streambuf::pos_type mapped_streambuf::seekpos( pos_type pos, std::ios::openmode which )
+{
+    off_type position = pos;
+    if( !( which & std::ios::in ) || position < 0 ) { return pos_type( off_type( -1 ) ); }
+    if( std::size_t( position ) < file_.offset() || std::size_t( position ) > file_.offset() + file_.size() ) // outside of the current mapping
+    {
+        file_.map( position );
+        char* begin = const_cast< char* >( file_.data() );
+        setg( begin, begin, begin + file_.size() );
+        return pos;
+    }
+    setg( eback(), eback() + ( position - file_.offset() ), egptr() );
+    return pos;
+}
+
+inline mapped_streambuf::int_type mapped_streambuf::underflow()
+{
+    if( gptr() < egptr() || update() ) { return traits_type::to_int_type( *gptr() ); }
+    return traits_type::eof();
+}
+
+inline mapped_ifstream::mapped_ifstream( const char* name, std::ios::openmode mode )
+    : std::istream( NULL )
+    , fd_( invalid_file_descriptor )
+    , mapped_( NULL )
+{
+    #ifndef WIN32
+    fd_ = ::open( name, O_RDONLY );
+    if( fd_ != invalid_file_descriptor && mapped_file::regular( fd_ ) )
+    {
+        mapped_ = new mapped_streambuf( fd_ );
+        rdbuf( mapped_ );
+        return;
+    }
+    if( fd_ != invalid_file_descriptor ) { ::close( fd_ ); fd_ = invalid_file_descriptor; }
+    #endif
+    rdbuf( &file_ );
+    if( !file_.open( name, mode | std::ios::in ) ) { setstate( std::ios::failbit ); }
+}
+
+inline void mapped_ifstream::close()
+{
+    if( mapped_ ) { rdbuf( &file_ ); delete mapped_; mapped_ = NULL; setstate( std::ios::eofbit ); }
+    #ifndef WIN32
+    if( fd_ != invalid_file_descriptor ) { ::close( fd_ ); fd_ = invalid_file_descriptor; }
+    #endif
+    if( file_.is_open() ) { file_.close(); }
+}
+
+} } // namespace comma { namespace io {
+
+#endif // COMMA_IO_MAPPED_FILE_HEADER
@@ -0,0 +1,232 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <comma/base/exception.h>
+#include <comma/io/prefetch.h>
+
+namespace comma { namespace io {
+
+/// state shared with the background thread
+struct prefetch_streambuf::state
+{
+    std::streambuf* source;
+    file_descriptor fd;
+    file_descriptor wait_fd; // if valid, wait for it to become readable before reading source
+    #ifndef WIN32
+    int wakeup[2]; // pipe to wake up the thread waiting for the source on shutdown
+    #endif
+    std::vector< std::vector< char > > buffers;
+    std::vector< std::size_t > sizes;
+    std::size_t head; // buffer being consumed or next to consume
+    std::size_t filled; // number of filled buffers, including the one being consumed
+    bool eof;
+    bool shutdown;
+    boost::mutex mutex;
+    boost::condition_variable filled_condition;
+    boost::condition_variable freed_condition;
+
+    state( std::streambuf* source, file_descriptor fd, file_descriptor wait_fd, std::size_t buffer_size, unsigned int count )
+        : source( source )
+        , fd( fd )
+        , wait_fd( wait_fd )
+        , buffers( count ? count : 1, std::vector< char >( buffer_size ? buffer_size : 1 ) )
+        , sizes( buffers.size(), 0 )
+        , head( 0 )
+        , filled( 0 )
+        , eof( false )
+        , shutdown( false )
+    {
+        #ifndef WIN32
+        if( ::pipe( wakeup ) != 0 ) { COMMA_THROW( comma::exception, "failed to create pipe" ); }
+        #endif
+    }
+
+    ~state()
+    {
+        #ifndef WIN32
+        ::close( wakeup[0] );
+        ::close( wakeup[1] );
+        #endif
+    }
+
+    bool wait() // wait till source is readable; return false on shutdown
+    {
+        #ifndef WIN32
+        if( wait_fd == invalid_file_descriptor ) { return true; }
+        if( source && source->in_avail() > 0 ) { return true; }
+        struct pollfd fds[2];
+        fds[0].fd = wait_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = wakeup[0];
+        fds[1].events = POLLIN;
+        while( ::poll( fds, 2, -1 ) < 0 ) { if( errno != EINTR ) { return true; } }
+        return !( fds[1].revents & POLLIN );
+        #else
+        return true;
+        #endif
+    }
+
+    void wake()
+    {
+        #ifndef WIN32
+        char c = 0;
+        if( ::write( wakeup[1], &c, 1 ) != 1 ) {} // nothing we can do
+        #endif
+    }
+
+    std::size_t read( char* buf, std::size_t size ) // read at least one byte, unless end of stream; return 0 on end of stream
+    {
+        if( !wait() ) { return 0; }
+        if( fd != invalid_file_descriptor )
+        {
+            while( true )
+            {
+                #ifdef WIN32
+                int count = ::_read( fd, buf, size );
+                #else
+                ssize_t count = ::read( fd, buf, size );
+                if( count < 0 && errno == EINTR ) { continue; }
+                #endif
+                return count > 0 ? count : 0;
+            }
+        }
+        std::streambuf::int_type c = source->sbumpc(); // block for a single character, which pulls whatever is available into the source buffer
+        if( std::streambuf::traits_type::eq_int_type( c, std::streambuf::traits_type::eof() ) ) { return 0; }
+        buf[0] = std::streambuf::traits_type::to_char_type( c );
+        std::streamsize available = source->in_avail();
+        std::size_t count = 1;
+        if( available > 0 ) { count += source->sgetn( buf + 1, std::min( std::size_t( available ), size - 1 ) ); }
+        return count;
+    }
+
+    void run()
+    {
+        while( true )
+        {
+            std::size_t tail;
+            {
+                boost::mutex::scoped_lock lock( mutex );
+                while( !shutdown && filled == buffers.size() ) { freed_condition.wait( lock ); }
+                if( shutdown ) { return; }
+                tail = ( head + filled ) % buffers.size(); // not touched by consumer until filled
+            }
+            std::size_t size = 0;
+            try { size = read( &buffers[tail][0], buffers[tail].size() ); }
+            catch( ... ) {} // treat as end of stream
+            {
+                boost::mutex::scoped_lock lock( mutex );
+                if( size == 0 ) { eof = true; }
+                else { sizes[tail] = size; ++filled; }
+            }
+            filled_condition.notify_all();
+            if( size == 0 ) { return; }
+        }
+    }
+};
+
+static void run( boost::shared_ptr< prefetch_streambuf::state > s ) { s->run(); }
+
+prefetch_streambuf::prefetch_streambuf( std::streambuf* source, std::size_t buffer_size, unsigned int buffers, file_descriptor fd )
+    : state_( new state( source, invalid_file_descriptor, fd, buffer_size, buffers ) )
+    , holding_( false )
+{
+    if( !source ) { COMMA_THROW( comma::exception, "expected source stream buffer, got null" ); }
+    setg( NULL, NULL, NULL );
+    thread_ = boost::thread( boost::bind( &run, state_ ) );
+}
+
+prefetch_streambuf::prefetch_streambuf( file_descriptor fd, std::size_t buffer_size, unsigned int buffers )
+    : state_( new state( NULL, fd, fd, buffer_size, buffers ) )
+    , holding_( false )
+{
+    if( fd == invalid_file_descriptor ) { COMMA_THROW( comma::exception, "expected valid file descriptor, got invalid" ); }
+    setg( NULL, NULL, NULL );
+    thread_ = boost::thread( boost::bind( &run, state_ ) );
+}
+
+prefetch_streambuf::~prefetch_streambuf()
+{
+    {
+        boost::mutex::scoped_lock lock( state_->mutex );
+        state_->shutdown = true;
+    }
+    state_->freed_condition.notify_all();
+    state_->wake();
+    thread_.join(); // never detach: the source is not owned and may get deleted as soon as we return
+}
+
+prefetch_streambuf::int_type prefetch_streambuf::underflow()
+{
+    if( gptr() < egptr() ) { return traits_type::to_int_type( *gptr() ); }
+    boost::mutex::scoped_lock lock( state_->mutex );
+    if( holding_ ) // release consumed buffer
+    {
+        state_->head = ( state_->head + 1 ) % state_->buffers.size();
+        --state_->filled;
+        holding_ = false;
+        setg( NULL, NULL, NULL );
+        state_->freed_condition.notify_all();
+    }
+    while( state_->filled == 0 && !state_->eof ) { state_->filled_condition.wait( lock ); }
+    if( state_->filled == 0 ) { return traits_type::eof(); }
+    holding_ = true;
+    char* begin = &state_->buffers[ state_->head ][0];
+    setg( begin, begin, begin + state_->sizes[ state_->head ] );
+    return traits_type::to_int_type( *gptr() );
+}
+
+std::streamsize prefetch_streambuf::showmanyc()
+{
+    boost::mutex::scoped_lock lock( state_->mutex );
+    std::streamsize size = 0;
+    std::size_t begin = holding_ ? 1 : 0;
+    for( std::size_t i = begin; i < state_->filled; ++i ) { size += state_->sizes[ ( state_->head + i ) % state_->buffers.size() ]; }
+    return size == 0 && state_->eof ? -1 : size;
+}
+
+prefetch_istream::prefetch_istream( std::istream& source, std::size_t buffer_size, unsigned int buffers, file_descriptor fd )
+    : std::istream( NULL )
+{
+    #ifndef WIN32
+    if( &source == &std::cin ) { buffer_.reset( new prefetch_streambuf( stdin_fd, buffer_size, buffers ) ); }
+    #endif
+    if( !buffer_ ) { buffer_.reset( new prefetch_streambuf( source.rdbuf(), buffer_size, buffers, fd ) ); }
+    rdbuf( buffer_.get() );
+}
+
+prefetch_istream::prefetch_istream( file_descriptor fd, std::size_t buffer_size, unsigned int buffers )
+    : std::istream( NULL )
+    , buffer_( new prefetch_streambuf( fd, buffer_size, buffers ) )
+{
+    rdbuf( buffer_.get() );
+}
+
+} } // namespace comma { namespace io {
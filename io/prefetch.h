@@ -0,0 +1,90 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COMMA_IO_PREFETCH_HEADER
+#define COMMA_IO_PREFETCH_HEADER
+
+#include <iostream>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <comma/io/file_descriptor.h>
+
+namespace comma { namespace io {
+
+/// stream buffer that reads its source ahead in a background thread
+/// into a ring of buffers, so that reading the source overlaps with
+/// processing the data already read
+///
+/// the source is read only by the background thread: do not read from it
+/// directly, while the prefetch buffer is in use
+///
+/// on destruction, the background thread is joined; if it is waiting for
+/// a file descriptor, it gets woken up; otherwise, destruction blocks till
+/// the pending read of the source returns, thus for sources that may block
+/// (e.g. sockets or pipes) pass their file descriptor
+class prefetch_streambuf : public std::streambuf, public boost::noncopyable
+{
+    public:
+        /// constructor: prefetch from stream buffer (e.g. std::cin.rdbuf() or a file stream buffer)
+        /// @param fd if valid, file descriptor of the source, which becomes readable when the source has data
+        prefetch_streambuf( std::streambuf* source, std::size_t buffer_size = 65536, unsigned int buffers = 2, file_descriptor fd = invalid_file_descriptor );
+
+        /// constructor: prefetch from file descriptor, e.g. stdin_fd
+        prefetch_streambuf( file_descriptor fd, std::size_t buffer_size = 65536, unsigned int buffers = 2 );
+
+        /// destructor
+        ~prefetch_streambuf();
+
+        struct state;
+
+    protected:
+        int_type underflow();
+        std::streamsize showmanyc();
+
+    private:
+        boost::shared_ptr< state > state_;
+        boost::thread thread_;
+        bool holding_;
+};
+
+/// input stream reading its source ahead in a background thread, e.g.
+///
+///     comma::io::prefetch_istream is( std::cin );
+///     comma::csv::input_stream< S > istream( is, csv );
+///
+/// @note if the source is std::cin, it is read directly by its file descriptor,
+///       since std::cin synchronised with stdio would be read one character at a time
+class prefetch_istream : public std::istream
+{
+    public:
+        /// constructor; the source stream is not owned
+        /// @param fd if valid, file descriptor of the source, see prefetch_streambuf
+        prefetch_istream( std::istream& source, std::size_t buffer_size = 65536, unsigned int buffers = 2, file_descriptor fd = invalid_file_descriptor );
+
+        /// constructor
+        prefetch_istream( file_descriptor fd, std::size_t buffer_size = 65536, unsigned int buffers = 2 );
+
+    private:
+        boost::scoped_ptr< prefetch_streambuf > buffer_;
+};
+
+} } // namespace comma { namespace io {
+
+#endif // COMMA_IO_PREFETCH_HEADER
@@ -39,6 +39,8 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <comma/base/exception.h>
 #include <comma/io/file_descriptor.h>
+#include <comma/io/mapped_file.h>
+#include <comma/io/prefetch.h>
 #include <comma/io/select.h>
 #include <comma/io/stream.h>
 #include <comma/string/string.h>
@@ -309,9 +311,62 @@ template class stream< std::istream >;
 template class stream< std::ostream >;
 //template class stream< std::iostream >;
 
-istream::istream( const std::string& name, mode::value mode, mode::blocking_value blocking ) : stream< std::istream >( name, mode, blocking ) {}
-istream::istream( std::istream* s, io::file_descriptor fd, mode::value mode, boost::function< void() > close ) : stream< std::istream >( s, fd, mode, mode::non_blocking, close ) {}
-istream::istream( std::istream* s, io::file_descriptor fd, mode::value mode, mode::blocking_value blocking, boost::function< void() > close ) : stream< std::istream >( s, fd, mode, blocking, close ) {}
+istream::istream( const std::string& name, mode::value mode, mode::blocking_value blocking ) : stream< std::istream >( name, mode, blocking ), source_( NULL ), buffer_( NULL ) {}
+istream::istream( std::istream* s, io::file_descriptor fd, mode::value mode, boost::function< void() > close ) : stream< std::istream >( s, fd, mode, mode::non_blocking, close ), source_( NULL ), buffer_( NULL ) {}
+istream::istream( std::istream* s, io::file_descriptor fd, mode::value mode, mode::blocking_value blocking, boost::function< void() > close ) : stream< std::istream >( s, fd, mode, blocking, close ), source_( NULL ), buffer_( NULL ) {}
+
+istream::~istream() { stop_prefetch_(); unmap_(); }
+
+void istream::prefetch( std::size_t buffer_size, unsigned int buffers )
+{
+    if( source_ ) { return; }
+    std::istream* s = stream< std::istream >::operator->();
+    if( !s ) { COMMA_THROW( comma::exception, "cannot prefetch " << name_ << ": not open yet" ); }
+    stream_ = new prefetch_istream( *s, buffer_size, buffers, name_.substr( 0, 4 ) == "zero" ? invalid_file_descriptor : fd_ ); // zeromq fd signals events, not data
+    source_ = s;
+    close_ = boost::bind( &istream::release_and_close_, this, close_ );
+}
+
+bool istream::map( std::size_t window )
+{
+    #ifndef WIN32
+    if( mapped_ ) { return true; }
+    if( source_ || !mapped_file::regular( fd_ ) ) { return false; }
+    std::istream* s = stream< std::istream >::operator->();
+    if( !s || impl::traits< std::istream >::is_standard( s ) ) { return false; }
+    std::streamoff offset = s->tellg();
+    if( offset < 0 ) { return false; }
+    mapped_.reset( new mapped_streambuf( fd_, offset, window ) );
+    buffer_ = s->rdbuf( mapped_.get() );
+    close_ = boost::bind( &istream::release_and_close_, this, close_ );
+    return true;
+    #else
+    (void)window;
+    return false;
+    #endif
+}
+
+void istream::unmap_() // switch stream back to its own buffer before the file gets closed
+{
+    if( !mapped_ ) { return; }
+    stream_->rdbuf( buffer_ );
+    mapped_.reset();
+}
+
+void istream::stop_prefetch_() // join prefetching thread before the source gets closed or deleted
+{
+    if( !source_ ) { return; }
+    delete stream_;
+    stream_ = source_;
+    source_ = NULL;
+}
+
+void istream::release_and_close_( boost::function< void() > close )
+{
+    stop_prefetch_();
+    unmap_();
+    if( close ) { close(); }
+}
 ostream::ostream( const std::string& name, mode::value mode, mode::blocking_value blocking ) : stream< std::ostream >( name, mode, blocking ) {}
 ostream::ostream( std::ostream* s, io::file_descriptor fd, mode::value mode, boost::function< void() > close ) : stream< std::ostream >( s, fd, mode, mode::non_blocking, close ) {}
 ostream::ostream( std::ostream* s, io::file_descriptor fd, mode::value mode, mode::blocking_value blocking, boost::function< void() > close ) : stream< std::ostream >( s, fd, mode, blocking, close ) {}
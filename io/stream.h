@@ -23,7 +23,9 @@
 #include <string>
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <comma/io/file_descriptor.h>
+#include <comma/io/mapped_file.h>
 
 namespace comma { namespace io {
 
@@ -92,6 +94,26 @@ struct istream : public stream< std::istream >
     istream( const std::string& name, mode::value mode = mode::ascii, mode::blocking_value blocking = mode::blocking );
     istream( std::istream* s, io::file_descriptor fd, mode::value mode, boost::function< void() > close );
     istream( std::istream* s, io::file_descriptor fd, mode::value mode, mode::blocking_value blocking, boost::function< void() > close );
+    ~istream();
+
+    /// read the stream ahead in a background thread (see prefetch_istream); call before reading
+    /// @note select on fd() does not account for the data already read ahead,
+    ///       check rdbuf()->in_avail() first
+    void prefetch( std::size_t buffer_size = 65536, unsigned int buffers = 2 );
+
+    /// read regular file through memory mapping (see mapped_streambuf), e.g. for
+    /// recorded logs; return false, if not a regular file or already prefetching
+    /// @note only map files that are not truncated while being read, since
+    ///       reading past the new end of a truncated mapped file raises SIGBUS
+    bool map( std::size_t window = mapped_file::default_window );
+
+    private:
+        std::istream* source_;
+        boost::scoped_ptr< mapped_streambuf > mapped_;
+        std::streambuf* buffer_; // stream buffer replaced by mapping
+        void stop_prefetch_();
+        void unmap_();
+        void release_and_close_( boost::function< void() > close );
 };
 
 /// output stream owner
@@ -0,0 +1,151 @@
+// This file is part of comma, a generic and flexible library
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#ifndef WIN32
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+#include <fstream>
+#include <string>
+#include <comma/io/mapped_file.h>
+#include <comma/io/stream.h>
+
+#ifndef WIN32
+
+TEST( io, mapped_ifstream )
+{
+    char name[] = "/tmp/comma-io-mapped-file-test-XXXXXX";
+    int fd = ::mkstemp( name );
+    ASSERT_TRUE( fd >= 0 );
+    ::close( fd );
+    { std::ofstream ofs( name ); ofs << "hello" << std::endl << "world" << std::endl; }
+    {
+        comma::io::mapped_ifstream ifs( name );
+        EXPECT_TRUE( ifs.is_open() );
+        EXPECT_TRUE( dynamic_cast< comma::io::mapped_streambuf* >( ifs.rdbuf() ) != NULL );
+        EXPECT_EQ( 12, ifs.rdbuf()->in_avail() );
+        std::string line;
+        std::getline( ifs, line );
+        EXPECT_EQ( "hello", line );
+        std::getline( ifs, line );
+        EXPECT_EQ( "world", line );
+        EXPECT_EQ( 0, ifs.rdbuf()->in_avail() );
+        { std::ofstream ofs( name, std::ios::app ); ofs << "again" << std::endl; }
+        std::getline( ifs, line );
+        EXPECT_TRUE( ifs.good() );
+        EXPECT_EQ( "again", line );
+        std::getline( ifs, line );
+        EXPECT_TRUE( ifs.eof() );
+    }
+    {
+        int fd = ::open( name, O_RDONLY );
+        {
+            comma::io::mapped_streambuf mapped( fd, 6 );
+            EXPECT_EQ( 12u, mapped.available() );
+            EXPECT_EQ( "world", std::string( mapped.data(), 5 ) );
+            mapped.consume( 6 );
+            EXPECT_EQ( "again", std::string( mapped.data(), 5 ) );
+        }
+        {
+            comma::io::mapped_streambuf mapped( fd, 0 );
+            std::istream is( &mapped );
+            std::string line;
+            is.seekg( 12 );
+            std::getline( is, line );
+            EXPECT_EQ( "again", line );
+            is.seekg( 6 );
+            std::getline( is, line );
+            EXPECT_EQ( "world", line );
+            EXPECT_EQ( 12, is.tellg() );
+        }
+        ::close( fd );
+    }
+    {
+        comma::io::mapped_ifstream ifs( "/dev/null" ); // not a regular file: read as usual
+        EXPECT_TRUE( ifs.is_open() );
+        EXPECT_TRUE( dynamic_cast< comma::io::mapped_streambuf* >( ifs.rdbuf() ) == NULL );
+        std::string line;
+        std::getline( ifs, line );
+        EXPECT_TRUE( ifs.eof() );
+    }
+    {
+        comma::io::mapped_ifstream ifs( "/no/such/file" );
+        EXPECT_FALSE( ifs.is_open() );
+        EXPECT_TRUE( ifs.fail() );
+    }
+    ::unlink( name );
+}
+
+TEST( io, mapped_streambuf_window )
+{
+    char name[] = "/tmp/comma-io-mapped-file-test-XXXXXX";
+    int fd = ::mkstemp( name );
+    ASSERT_TRUE( fd >= 0 );
+    std::string data( 3 * ::sysconf( _SC_PAGESIZE ) + 100, 0 );
+    for( unsigned int i = 0; i < data.size(); ++i ) { data[i] = 'a' + i % 26; }
+    ASSERT_EQ( int( data.size() ), ::write( fd, &data[0], data.size() ) );
+    {
+        comma::io::mapped_streambuf mapped( fd, 10, 1000 ); // windows not aligned to pages
+        std::istream is( &mapped );
+        std::string s( data.size(), 0 );
+        is.read( &s[0], s.size() );
+        EXPECT_EQ( int( data.size() - 10 ), is.gcount() );
+        EXPECT_EQ( data.substr( 10 ), s.substr( 0, is.gcount() ) );
+    }
+    {
+        comma::io::mapped_streambuf mapped( fd, 0, 1000 );
+        EXPECT_EQ( 1000u, mapped.available() );
+        mapped.consume( 900 );
+        ASSERT_EQ( 0, ::ftruncate( fd, 950 ) ); // file shrinks, e.g. log rotated
+        EXPECT_TRUE( mapped.update() ); // the window is clamped to the new file size, rather than reading past it
+        EXPECT_EQ( 50u, mapped.available() );
+        EXPECT_EQ( data.substr( 900, 50 ), std::string( mapped.data(), 50 ) );
+        mapped.consume( 50 );
+        EXPECT_FALSE( mapped.update() );
+    }
+    ::close( fd );
+    ::unlink( name );
+}
+
+TEST( io, istream_map )
+{
+    char name[] = "/tmp/comma-io-mapped-file-test-XXXXXX";
+    int fd = ::mkstemp( name );
+    ASSERT_TRUE( fd >= 0 );
+    ::close( fd );
+    { std::ofstream ofs( name ); ofs << "hello" << std::endl << "world" << std::endl; }
+    {
+        comma::io::istream is( name );
+        EXPECT_TRUE( dynamic_cast< comma::io::mapped_streambuf* >( is->rdbuf() ) == NULL ); // not mapped, unless asked
+        EXPECT_TRUE( is.map() );
+        EXPECT_TRUE( dynamic_cast< comma::io::mapped_streambuf* >( is->rdbuf() ) != NULL );
+        std::string line;
+        std::getline( *is, line );
+        EXPECT_EQ( "hello", line );
+        is.close();
+        EXPECT_TRUE( dynamic_cast< comma::io::mapped_streambuf* >( is->rdbuf() ) == NULL );
+    }
+    {
+        comma::io::istream is( "/dev/null" );
+        EXPECT_FALSE( is.map() );
+    }
+    ::unlink( name );
+}
+
+#endif // #ifndef WIN32
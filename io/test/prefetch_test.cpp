@@ -0,0 +1,110 @@
+// This file is part of comma, a generic and flexible library
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <comma/io/prefetch.h>
+
+TEST( io, prefetch_istream )
+{
+    std::ostringstream oss;
+    for( unsigned int i = 0; i < 1000; ++i ) { oss << "line " << i << std::endl; }
+    std::istringstream source( oss.str() );
+    comma::io::prefetch_istream is( source, 7, 3 ); // small buffers, lines spanning them
+    for( unsigned int i = 0; i < 1000; ++i )
+    {
+        std::string line;
+        std::getline( is, line );
+        EXPECT_EQ( "line " + boost::lexical_cast< std::string >( i ), line );
+    }
+    std::string line;
+    std::getline( is, line );
+    EXPECT_TRUE( is.eof() );
+    EXPECT_TRUE( line.empty() );
+}
+
+TEST( io, prefetch_istream_read )
+{
+    std::string data( 100000, 0 );
+    for( unsigned int i = 0; i < data.size(); ++i ) { data[i] = i % 251; }
+    std::istringstream source( data );
+    comma::io::prefetch_istream is( source, 4096, 2 );
+    std::string result( data.size() + 1, 0 );
+    is.read( &result[0], result.size() );
+    EXPECT_EQ( data.size(), std::size_t( is.gcount() ) );
+    EXPECT_EQ( data, result.substr( 0, data.size() ) );
+}
+
+#ifndef WIN32
+
+static void write_slowly( int fd )
+{
+    for( unsigned int i = 0; i < 5; ++i )
+    {
+        std::string s = boost::lexical_cast< std::string >( i ) + "\n";
+        if( ::write( fd, &s[0], s.size() ) != int( s.size() ) ) { break; }
+        boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+    }
+    ::close( fd );
+}
+
+TEST( io, prefetch_istream_pipe )
+{
+    int fds[2];
+    ASSERT_EQ( 0, ::pipe( fds ) );
+    boost::thread writer( boost::bind( &write_slowly, fds[1] ) );
+    {
+        comma::io::prefetch_istream is( fds[0] );
+        for( unsigned int i = 0; i < 5; ++i ) // each line is available as soon as written, without waiting for a full buffer
+        {
+            std::string line;
+            std::getline( is, line );
+            EXPECT_EQ( boost::lexical_cast< std::string >( i ), line );
+        }
+        std::string line;
+        std::getline( is, line );
+        EXPECT_TRUE( is.eof() );
+    }
+    writer.join();
+    ::close( fds[0] );
+}
+
+TEST( io, prefetch_istream_destroy_while_waiting )
+{
+    int fds[2];
+    ASSERT_EQ( 0, ::pipe( fds ) );
+    {
+        std::ifstream source( ( "/dev/fd/" + boost::lexical_cast< std::string >( fds[0] ) ).c_str() );
+        comma::io::prefetch_istream is( source, 65536, 2, fds[0] );
+        boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) ); // let the thread block on the idle pipe
+    } // joins the thread without waiting for data
+    EXPECT_EQ( 2, ::write( fds[1], "0\n", 2 ) ); // the pipe has not been read by the stopped thread
+    char buf[2];
+    EXPECT_EQ( 2, ::read( fds[0], buf, 2 ) );
+    ::close( fds[0] );
+    ::close( fds[1] );
+}
+
+#endif // #ifndef WIN32
@@ -0,0 +1,157 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef COMMA_MATH_DIGEST_H_
+#define COMMA_MATH_DIGEST_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/math/constants/constants.hpp>
+#include <comma/base/exception.h>
+
+namespace comma { namespace math {
+
+/// t-digest: mergeable sketch of a distribution for approximate quantiles in bounded memory
+///
+/// values are kept as centroids (mean and weight), small at the tails and larger
+/// in the middle of the distribution, about compression of them, plus a buffer
+/// of less than compression pushed values, i.e. memory does not depend on the number
+/// of values; as long as no more than compression values have been pushed, quantiles are exact
+///
+/// see: T.Dunning, O.Ertl, Computing extremely accurate quantiles using t-digests, 2019
+class digest
+{
+    public:
+        /// constructor
+        /// @param compression number of centroids to keep: the greater, the more accurate
+        digest( std::size_t compression = 100 ) : compression_( compression ), weight_( 0 )
+        {
+            if( compression_ < 2 ) { COMMA_THROW( comma::exception, "expected compression of at least 2, got " << compression_ ); }
+        }
+
+        /// add value
+        void push( double x, double weight = 1 )
+        {
+            if( weight_ == 0 ) { min_ = max_ = x; }
+            else if( x < min_ ) { min_ = x; }
+            else if( x > max_ ) { max_ = x; }
+            buffer_.push_back( centroid( x, weight ) );
+            weight_ += weight;
+            if( buffer_.size() >= compression_ ) { compress_(); }
+        }
+
+        /// add values of another digest
+        void merge( const digest& rhs )
+        {
+            if( rhs.weight_ == 0 ) { return; }
+            if( weight_ == 0 ) { min_ = rhs.min_; max_ = rhs.max_; }
+            else { min_ = std::min( min_, rhs.min_ ); max_ = std::max( max_, rhs.max_ ); }
+            buffer_.insert( buffer_.end(), rhs.centroids_.begin(), rhs.centroids_.end() );
+            buffer_.insert( buffer_.end(), rhs.buffer_.begin(), rhs.buffer_.end() );
+            weight_ += rhs.weight_;
+            if( buffer_.size() >= compression_ ) { compress_(); }
+        }
+
+        /// return quantile q in [0, 1], interpolated linearly between values, as numpy.percentile() does
+        double quantile( double q ) const
+        {
+            if( weight_ == 0 ) { COMMA_THROW( comma::exception, "quantile of empty digest" ); }
+            if( q < 0 || q > 1 ) { COMMA_THROW( comma::exception, "expected quantile in [0, 1], got " << q ); }
+            if( !buffer_.empty() ) { compress_(); }
+            double t = q * ( weight_ - 1 ) + 0.5; // centroid of weight 1 at index i is centred at i + 0.5
+            double c = centroids_[0].weight / 2; // centre of current centroid
+            if( t < c ) { return min_ + ( centroids_[0].mean - min_ ) * ( t - 0.5 ) / ( c - 0.5 ); } // first centroid is heavier than 1
+            for( std::size_t i = 0; i + 1 < centroids_.size(); ++i )
+            {
+                double n = c + ( centroids_[i].weight + centroids_[ i + 1 ].weight ) / 2;
+                if( t <= n ) { return centroids_[i].mean + ( centroids_[ i + 1 ].mean - centroids_[i].mean ) * ( t - c ) / ( n - c ); }
+                c = n;
+            }
+            double e = weight_ - 0.5;
+            return t >= e ? max_ : centroids_.back().mean + ( max_ - centroids_.back().mean ) * ( t - c ) / ( e - c );
+        }
+
+        /// return total weight, i.e. number of values, if all weights are 1
+        double weight() const { return weight_; }
+
+        /// return true, if no values
+        bool empty() const { return weight_ == 0; }
+
+        /// return minimum value
+        double min() const { return min_; }
+
+        /// return maximum value
+        double max() const { return max_; }
+
+        /// return compression
+        std::size_t compression() const { return compression_; }
+
+        /// return current number of centroids; for diagnostics and testing
+        std::size_t size() const { return centroids_.size() + buffer_.size(); }
+
+    private:
+        struct centroid
+        {
+            double mean;
+            double weight;
+            centroid() {}
+            centroid( double mean, double weight ) : mean( mean ), weight( weight ) {}
+            bool operator<( const centroid& rhs ) const { return mean < rhs.mean; }
+        };
+        std::size_t compression_;
+        double weight_;
+        double min_;
+        double max_;
+        mutable std::vector< centroid > centroids_; // sorted by mean
+        mutable std::vector< centroid > buffer_;
+
+        // scale function k( q ) = compression / pi * asin( 2q - 1 ), which limits a centroid to a unit of k
+        double k_( double q ) const { return compression_ / boost::math::constants::pi< double >() * std::asin( 2 * std::min( q, 1.0 ) - 1 ); }
+        double q_( double k ) const { return k >= compression_ / 2.0 ? 1 : ( std::sin( k * boost::math::constants::pi< double >() / compression_ ) + 1 ) / 2; }
+
+        void compress_() const
+        {
+            buffer_.insert( buffer_.end(), centroids_.begin(), centroids_.end() );
+            std::sort( buffer_.begin(), buffer_.end() );
+            centroids_.clear();
+            if( weight_ <= compression_ ) { centroids_.swap( buffer_ ); return; } // small enough to keep all values exactly
+            centroids_.push_back( buffer_[0] );
+            double w = 0; // weight of centroids before the current one
+            double limit = weight_ * q_( k_( 0 ) + 1 );
+            for( std::size_t i = 1; i < buffer_.size(); ++i )
+            {
+                centroid& c = centroids_.back();
+                if( w + c.weight + buffer_[i].weight <= limit )
+                {
+                    c.weight += buffer_[i].weight;
+                    c.mean += ( buffer_[i].mean - c.mean ) * buffer_[i].weight / c.weight;
+                    continue;
+                }
+                w += c.weight;
+                limit = weight_ * q_( k_( w / weight_ ) + 1 );
+                centroids_.push_back( buffer_[i] );
+            }
+            buffer_.clear();
+        }
+};
+
+} } // namespace comma { namespace math {
+
+#endif // COMMA_MATH_DIGEST_H_
@@ -0,0 +1,212 @@
+// This file is part of comma, a generic and flexible library 
+// for robotics research.
+//
+// Copyright (C) 2011 The University of Sydney
+//
+// comma is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// comma is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License 
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with comma. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <gtest/gtest.h>
+#include <comma/base/types.h>
+#include <comma/math/digest.h>
+
+namespace comma { namespace math {
+
+static double exact_quantile( std::vector< double > v, double q ) // as numpy.percentile
+{
+    std::sort( v.begin(), v.end() );
+    double i = q * ( v.size() - 1 );
+    std::size_t j = static_cast< std::size_t >( i );
+    return j + 1 < v.size() ? v[j] + ( v[ j + 1 ] - v[j] ) * ( i - j ) : v[j];
+}
+
+// rank error of x: distance from q to the range of ranks x occupies in sorted v
+static double rank_error( const std::vector< double >& sorted, double x, double q )
+{
+    double lower = double( std::lower_bound( sorted.begin(), sorted.end(), x ) - sorted.begin() ) / sorted.size();
+    double upper = double( std::upper_bound( sorted.begin(), sorted.end(), x ) - sorted.begin() ) / sorted.size();
+    return q < lower ? lower - q : q > upper ? q - upper : 0;
+}
+
+TEST( digest, exact )
+{
+    boost::mt19937 generator( 1 );
+    boost::normal_distribution<> distribution;
+    boost::variate_generator< boost::mt19937&, boost::normal_distribution<> > random( generator, distribution );
+    for( std::size_t size = 1; size <= 100; ++size )
+    {
+        digest d( 100 );
+        std::vector< double > v;
+        for( std::size_t i = 0; i < size; ++i ) { v.push_back( random() ); d.push( v.back() ); }
+        for( double q = 0; q <= 1; q += 0.05 ) { EXPECT_NEAR( exact_quantile( v, q ), d.quantile( q ), 1e-12 ); }
+    }
+    digest d;
+    d.push( 1 ); d.push( 2 ); d.push( 3 ); d.push( 4 );
+    EXPECT_DOUBLE_EQ( 2.5, d.quantile( 0.5 ) );
+    EXPECT_DOUBLE_EQ( 1, d.quantile( 0 ) );
+    EXPECT_DOUBLE_EQ( 4, d.quantile( 1 ) );
+    EXPECT_DOUBLE_EQ( 1.75, d.quantile( 0.25 ) );
+    EXPECT_THROW( d.quantile( 1.5 ), comma::exception );
+    EXPECT_THROW( digest().quantile( 0.5 ), comma::exception );
+}
+
+template < typename T >
+static void test_accuracy( T min, T max, std::size_t compression, double tolerance )
+{
+    boost::mt19937 generator( 1 );
+    boost::uniform_int< comma::int64 > distribution( 0, 1000000 );
+    boost::variate_generator< boost::mt19937&, boost::uniform_int< comma::int64 > > random( generator, distribution );
+    std::vector< double > v;
+    digest d( compression );
+    digest halves[2] = { digest( compression ), digest( compression ) };
+    for( std::size_t i = 0; i < 100000; ++i )
+    {
+        double r = double( random() ) / 1000000;
+        T t = static_cast< T >( min + r * r * ( double( max ) - min ) ); // skewed towards min
+        v.push_back( static_cast< double >( t ) );
+        d.push( v.back() );
+        halves[ i % 2 ].push( v.back() );
+    }
+    halves[0].merge( halves[1] );
+    EXPECT_LE( d.size(), 3 * compression );
+    EXPECT_LE( halves[0].size(), 3 * compression );
+    EXPECT_EQ( 100000, d.weight() );
+    EXPECT_EQ( 100000, halves[0].weight() );
+    std::sort( v.begin(), v.end() );
+    EXPECT_EQ( v.front(), d.quantile( 0 ) );
+    EXPECT_EQ( v.back(), d.quantile( 1 ) );
+    double qs[] = { 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999 };
+    for( unsigned int i = 0; i < sizeof( qs ) / sizeof( qs[0] ); ++i )
+    {
+        double q = qs[i];
+        double expected = tolerance * std::max( 0.1, 4 * q * ( 1 - q ) ) + 1e-4; // more accurate at the tails
+        double x = d.quantile( q );
+        double y = halves[0].quantile( q );
+        if( std::numeric_limits< T >::is_integer ) { x = std::floor( x + 0.5 ); y = std::floor( y + 0.5 ); } // interpolated between repeated integers
+        EXPECT_LE( rank_error( v, x, q ), expected );
+        EXPECT_LE( rank_error( v, y, q ), expected );
+    }
+}
+
+template < typename T >
+static void test_accuracy( T min, T max )
+{
+    test_accuracy< T >( min, max, 100, 0.003 );
+    test_accuracy< T >( min, max, 400, 0.001 );
+}
+
+TEST( digest, accuracy )
+{
+    test_accuracy< char >( -128, 127 );
+    test_accuracy< unsigned char >( 0, 255 );
+    test_accuracy< comma::int16 >( -30000, 30000 );
+    test_accuracy< comma::uint16 >( 0, 60000 );
+    test_accuracy< comma::int32 >( -2000000000, 2000000000 );
+    test_accuracy< comma::uint32 >( 0, 4000000000u );
+    test_accuracy< comma::int64 >( -1000000000000LL, 1000000000000LL );
+    test_accuracy< comma::uint64 >( 0, 1000000000000ULL );
+    test_accuracy< float >( -1e6f, 1e6f );
+    test_accuracy< double >( -1e-3, 1e9 );
+    test_accuracy< comma::int64 >( 1400000000000000LL, 1400086400000000LL ); // one day of timestamps in microseconds, as time is aggregated
+}
+
+TEST( digest, merge )
+{
+    digest d;
+    digest empty;
+    d.merge( empty );
+    EXPECT_TRUE( d.empty() );
+    digest a;
+    a.push( 3 ); a.push( 1 );
+    digest b;
+    b.push( 2 ); b.push( 4 );
+    d.merge( a );
+    d.merge( b );
+    EXPECT_EQ( 4, d.weight() );
+    EXPECT_EQ( 1, d.min() );
+    EXPECT_EQ( 4, d.max() );
+    EXPECT_DOUBLE_EQ( 2.5, d.quantile( 0.5 ) );
+    EXPECT_DOUBLE_EQ( 1.75, d.quantile( 0.25 ) );
+}
+
+TEST( digest, bounded_size )
+{
+    boost::mt19937 generator( 1 );
+    boost::normal_distribution<> distribution;
+    boost::variate_generator< boost::mt19937&, boost::normal_distribution<> > random( generator, distribution );
+    digest d( 50 );
+    digest merged( 50 );
+    for( std::size_t i = 0; i < 1000000; ++i )
+    {
+        d.push( random() );
+        ASSERT_LE( d.size(), 150u );
+        if( i % 100000 == 99999 ) { merged.merge( d ); ASSERT_LE( merged.size(), 150u ); }
+    }
+    EXPECT_NEAR( 0, d.quantile( 0.5 ), 0.01 );
+    EXPECT_NEAR( 0, merged.quantile( 0.5 ), 0.01 );
+    EXPECT_NEAR( 1.2816, d.quantile( 0.9 ), 0.02 );
+}
+
+template < typename T >
+static void benchmark( const char* name, T min, T max )
+{
+    const std::size_t ids = 1000;
+    const std::size_t size = 2000000;
+    boost::mt19937 generator( 1 );
+    boost::uniform_int< comma::int64 > distribution( 0, 1000000 );
+    boost::variate_generator< boost::mt19937&, boost::uniform_int< comma::int64 > > random( generator, distribution );
+    std::vector< T > values( size );
+    for( std::size_t i = 0; i < size; ++i ) { values[i] = static_cast< T >( min + double( random() ) / 1000000 * ( double( max ) - min ) ); }
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    std::vector< digest > digests( ids, digest( 100 ) );
+    for( std::size_t i = 0; i < size; ++i ) { digests[ i % ids ].push( static_cast< double >( values[i] ) ); }
+    double sum = 0;
+    for( std::size_t i = 0; i < ids; ++i ) { sum += digests[i].quantile( 0.9 ); }
+    boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+    std::vector< std::vector< double > > blocks( ids ); // sort-based: keep all the values, as external tools do
+    for( std::size_t i = 0; i < size; ++i ) { blocks[ i % ids ].push_back( static_cast< double >( values[i] ) ); }
+    double exact_sum = 0;
+    for( std::size_t i = 0; i < ids; ++i ) { exact_sum += exact_quantile( blocks[i], 0.9 ); }
+    boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << name << ": digest: " << ( middle - start ).total_microseconds() * 1000 / size << "ns"
+              << "; sort: " << ( end - middle ).total_microseconds() * 1000 / size << "ns per value" << std::endl;
+    EXPECT_NEAR( exact_sum / ids, sum / ids, ( double( max ) - min ) * 0.01 );
+}
+
+TEST( digest, DISABLED_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    benchmark< char >( "char", -128, 127 );
+    benchmark< unsigned char >( "uint8", 0, 255 );
+    benchmark< comma::int16 >( "int16", -30000, 30000 );
+    benchmark< comma::uint16 >( "uint16", 0, 60000 );
+    benchmark< comma::int32 >( "int32", -2000000000, 2000000000 );
+    benchmark< comma::uint32 >( "uint32", 0, 4000000000u );
+    benchmark< comma::int64 >( "int64", -1000000000000LL, 1000000000000LL );
+    benchmark< comma::uint64 >( "uint64", 0, 1000000000000ULL );
+    benchmark< float >( "float", -1e6f, 1e6f );
+    benchmark< double >( "double", -1e-3, 1e9 );
+    benchmark< comma::int64 >( "time", 1400000000000000LL, 1400086400000000LL ); // microseconds, as time is aggregated
+}
+
+} } // namespace comma { namespace math {
@@ -15,8 +15,15 @@
 // You should have received a copy of the GNU Lesser General Public
 // License along with comma. If not, see <http://www.gnu.org/licenses/>.
 
+#include <string.h>
 #include <comma/string/split.h>
 
+#if defined( __GNUC__ ) && defined( __SSE2__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define COMMA_STRING_SPLIT_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
 namespace comma {
 
 static bool is_separator( char c, const char* separators )
@@ -25,6 +32,74 @@ static bool is_separator( char c, const char* separators )
     return false;
 }
 
+static const char* find_separator_scalar( const char* begin, const char* end, const char* separators )
+{
+    for( ; begin < end && !is_separator( *begin, separators ); ++begin );
+    return begin;
+}
+
+#ifdef COMMA_STRING_SPLIT_SIMD
+
+enum { max_simd_separators = 8 };
+
+static const char* find_separator_sse2( const char* begin, const char* end, const char* separators, std::size_t size )
+{
+    __m128i s[ max_simd_separators ];
+    for( std::size_t i = 0; i < size; ++i ) { s[i] = _mm_set1_epi8( separators[i] ); }
+    for( ; end - begin >= 16; begin += 16 )
+    {
+        __m128i chunk = _mm_loadu_si128( reinterpret_cast< const __m128i* >( begin ) );
+        __m128i m = _mm_cmpeq_epi8( chunk, s[0] );
+        for( std::size_t i = 1; i < size; ++i ) { m = _mm_or_si128( m, _mm_cmpeq_epi8( chunk, s[i] ) ); }
+        int mask = _mm_movemask_epi8( m );
+        if( mask ) { return begin + __builtin_ctz( mask ); }
+    }
+    return find_separator_scalar( begin, end, separators );
+}
+
+__attribute__(( target( "avx2" ) ))
+static const char* find_separator_avx2( const char* begin, const char* end, const char* separators, std::size_t size )
+{
+    __m256i s[ max_simd_separators ];
+    for( std::size_t i = 0; i < size; ++i ) { s[i] = _mm256_set1_epi8( separators[i] ); }
+    for( ; end - begin >= 32; begin += 32 )
+    {
+        __m256i chunk = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( begin ) );
+        __m256i m = _mm256_cmpeq_epi8( chunk, s[0] );
+        for( std::size_t i = 1; i < size; ++i ) { m = _mm256_or_si256( m, _mm256_cmpeq_epi8( chunk, s[i] ) ); }
+        unsigned int mask = _mm256_movemask_epi8( m );
+        if( mask ) { return begin + __builtin_ctz( mask ); }
+    }
+    return find_separator_sse2( begin, end, separators, size );
+}
+
+typedef const char* ( *find_separator_function )( const char*, const char*, const char*, std::size_t );
+
+static find_separator_function find_separator_simd()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) ? &find_separator_avx2 : &find_separator_sse2;
+}
+
+#endif // #ifdef COMMA_STRING_SPLIT_SIMD
+
+const char* find_separator( const char* begin, const char* end, const char* separators )
+{
+    if( begin >= end ) { return end; }
+    if( separators[0] == 0 ) { return end; }
+    if( separators[1] == 0 ) // glibc memchr is vectorised already
+    {
+        const char* p = static_cast< const char* >( ::memchr( begin, separators[0], end - begin ) );
+        return p ? p : end;
+    }
+    #ifdef COMMA_STRING_SPLIT_SIMD
+    std::size_t size = ::strlen( separators );
+    static const find_separator_function find = find_separator_simd(); // initialised on first use, since split may be called during static initialisation
+    if( size <= max_simd_separators ) { return find( begin, end, separators, size ); }
+    #endif
+    return find_separator_scalar( begin, end, separators );
+}
+
 std::vector< std::string > split( const std::string& s, char separator )
 {
     char separators[] = { separator, 0 };
@@ -34,21 +109,33 @@ std::vector< std::string > split( const std::string& s, char separator )
 std::vector< std::string > split( const std::string& s, const char* separators )
 {
     std::vector< std::string > v;
-    const char* begin( &s[0] );
+    const char* begin( s.data() );
     const char* end( begin + s.length() );
-    v.push_back( std::string() );
-    for( const char* p = begin; p < end; ++p )
+    while( true )
     {
-        if( is_separator( *p, separators ) )
-        {
-            v.push_back( std::string() );
-        }
-        else
-        {
-            v.back() += *p;
-        }
+        const char* p = find_separator( begin, end, separators );
+        v.push_back( std::string( begin, p ) );
+        if( p == end ) { return v; }
+        begin = p + 1;
     }
-    return v;
+}
+
+std::size_t split( const char* begin, const char* end, const char* separators, std::vector< span >& tokens )
+{
+    tokens.clear();
+    while( true )
+    {
+        const char* p = find_separator( begin, end, separators );
+        tokens.push_back( span( begin, p ) );
+        if( p == end ) { return tokens.size(); }
+        begin = p + 1;
+    }
+}
+
+std::size_t split( const char* begin, const char* end, char separator, std::vector< span >& tokens )
+{
+    char separators[] = { separator, 0 };
+    return split( begin, end, separators, tokens );
 }
 
 } // namespace comma {
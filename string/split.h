@@ -18,17 +18,59 @@
 #ifndef COMMA_STRING_SPLIT_H_
 #define COMMA_STRING_SPLIT_H_
 
+#include <cstddef>
+#include <iostream>
 #include <string>
 #include <vector>
 
 namespace comma {
 
+/// non-owning view of a token in a string; valid as long as the string
+struct span
+{
+    const char* data;
+    std::size_t size;
+    span() : data( NULL ), size( 0 ) {}
+    span( const char* data, std::size_t size ) : data( data ), size( size ) {}
+    span( const char* begin, const char* end ) : data( begin ), size( end - begin ) {}
+    bool empty() const { return size == 0; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+    std::string to_string() const { return std::string( data, size ); }
+};
+
+inline bool operator==( const span& lhs, const span& rhs ) { return lhs.size == rhs.size && std::string::traits_type::compare( lhs.data, rhs.data, lhs.size ) == 0; }
+inline bool operator==( const span& lhs, const std::string& rhs ) { return lhs == span( rhs.data(), rhs.size() ); }
+inline bool operator==( const std::string& lhs, const span& rhs ) { return rhs == lhs; }
+inline bool operator!=( const span& lhs, const span& rhs ) { return !( lhs == rhs ); }
+inline bool operator!=( const span& lhs, const std::string& rhs ) { return !( lhs == rhs ); }
+inline bool operator!=( const std::string& lhs, const span& rhs ) { return !( lhs == rhs ); }
+inline std::ostream& operator<<( std::ostream& os, const span& s ) { os.write( s.data, s.size ); return os; }
+
+/// return pointer to the first of given separators in [begin, end) or end, if none
+/// uses memchr for a single separator, otherwise SSE2 or AVX2, whichever the cpu supports
+const char* find_separator( const char* begin, const char* end, const char* separators );
+
 /// split string into tokens (a quick implementation); always contains at least one element
 std::vector< std::string > split( const std::string& s, const char* separators = " " );
 
 /// split string into tokens (a quick implementation); always contains at least one element
 std::vector< std::string > split( const std::string& s, char separator );
 
+/// split [begin, end) into views of tokens without copying them;
+/// reuses the capacity of tokens, i.e. does not allocate, once warmed up
+/// @return number of tokens, always at least one
+std::size_t split( const char* begin, const char* end, const char* separators, std::vector< span >& tokens );
+
+/// split [begin, end) into views of tokens without copying them
+std::size_t split( const char* begin, const char* end, char separator, std::vector< span >& tokens );
+
+/// split string into views of tokens without copying them; tokens are valid as long as the string is
+inline std::size_t split( const std::string& s, const char* separators, std::vector< span >& tokens ) { return split( s.data(), s.data() + s.size(), separators, tokens ); }
+
+/// split string into views of tokens without copying them; tokens are valid as long as the string is
+inline std::size_t split( const std::string& s, char separator, std::vector< span >& tokens ) { return split( s.data(), s.data() + s.size(), separator, tokens ); }
+
 } // namespace comma {
 
 #endif // COMMA_STRING_SPLIT_H_
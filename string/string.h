@@ -40,14 +40,62 @@ std::string join( const A& a, std::size_t size, char delimiter );
 template < typename A >
 inline std::string join( const A& a, char delimiter ) { return join( a, a.size(), delimiter ); }
 
+/// append array elements joined with given delimiter to a string, e.g. to reuse its buffer; return the string
+/// @note strings and spans are appended directly, elements of other types are output to std::ostringstream
 template < typename A >
-inline std::string join( const A& a, std::size_t size, char delimiter )
+std::string& join( const A& a, std::size_t size, char delimiter, std::string& s );
+
+/// append array elements joined with given delimiter to a string; return the string
+template < typename A >
+inline std::string& join( const A& a, char delimiter, std::string& s ) { return join( a, a.size(), delimiter, s ); }
+
+namespace impl {
+
+inline std::size_t join_size_( const std::string& t ) { return t.size(); }
+inline std::size_t join_size_( const span& t ) { return t.size; }
+inline std::size_t join_size_( const char* t ) { return std::string::traits_type::length( t ); }
+inline void join_append_( std::string& s, const std::string& t ) { s += t; }
+inline void join_append_( std::string& s, const span& t ) { s.append( t.data, t.size ); }
+inline void join_append_( std::string& s, const char* t ) { s += t; }
+
+template < typename A >
+inline void join_strings_( const A& a, std::size_t size, char delimiter, std::string& s )
+{
+    std::size_t length = s.size() + size - 1;
+    for( std::size_t i = 0; i < size; ++i ) { length += join_size_( a[i] ); }
+    s.reserve( length );
+    join_append_( s, a[0] );
+    for( std::size_t i = 1; i < size; ++i ) { s += delimiter; join_append_( s, a[i] ); }
+}
+
+template < typename A, typename T >
+inline void join_( const A& a, std::size_t size, char delimiter, std::string& s, const T* )
 {
-    if( size == 0 ) { return ""; }
     std::ostringstream oss;
     oss << a[0];
     for( std::size_t i = 1; i < size; ++i ) { oss << delimiter << a[i]; }
-    return oss.str();
+    s += oss.str();
+}
+
+template < typename A > inline void join_( const A& a, std::size_t size, char delimiter, std::string& s, const std::string* ) { join_strings_( a, size, delimiter, s ); }
+template < typename A > inline void join_( const A& a, std::size_t size, char delimiter, std::string& s, const span* ) { join_strings_( a, size, delimiter, s ); }
+template < typename A > inline void join_( const A& a, std::size_t size, char delimiter, std::string& s, const char* const* ) { join_strings_( a, size, delimiter, s ); }
+
+} // namespace impl {
+
+template < typename A >
+inline std::string& join( const A& a, std::size_t size, char delimiter, std::string& s )
+{
+    if( size > 0 ) { impl::join_( a, size, delimiter, s, &a[0] ); }
+    return s;
+}
+
+template < typename A >
+inline std::string join( const A& a, std::size_t size, char delimiter )
+{
+    std::string s;
+    join( a, size, delimiter, s );
+    return s;
 }
 
 template < typename It >
@@ -15,8 +15,11 @@
 // You should have received a copy of the GNU Lesser General Public
 // License along with comma. If not, see <http://www.gnu.org/licenses/>.
 
+#include <stdlib.h>
+#include <sstream>
 #include <comma/string/string.h>
 #include <gtest/gtest.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace comma {
 
@@ -65,6 +68,134 @@ TEST( string, split )
     }
 }
 
+TEST( string, split_spans )
+{
+    std::vector< span > v;
+    EXPECT_EQ( 1u, split( "", ",", v ) );
+    EXPECT_TRUE( v[0].empty() );
+    std::string s = "hello:world:/moon";
+    EXPECT_EQ( 4u, split( s, ":/", v ) );
+    EXPECT_EQ( "hello", v[0] );
+    EXPECT_EQ( "world", v[1] );
+    EXPECT_TRUE( v[2].empty() );
+    EXPECT_EQ( "moon", v[3] );
+    EXPECT_EQ( s.data() + 13, v[3].data ); // views into the string
+    EXPECT_EQ( 2u, split( s, 'w', v ) );
+    EXPECT_EQ( "hello:", v[0] );
+    std::string long_line; // long enough for vectorised scanning
+    std::vector< std::string > expected;
+    for( unsigned int i = 0; i < 200; ++i )
+    {
+        std::string token( i % 37, 'a' + i % 26 );
+        expected.push_back( token );
+        long_line += token;
+        if( i + 1 < 200 ) { long_line += ",;|"[ i % 3 ]; }
+    }
+    for( unsigned int k = 0; k < 2; ++k )
+    {
+        EXPECT_EQ( 200u, split( long_line, k == 0 ? ",;|" : "|;,#$%&!", v ) );
+        for( unsigned int i = 0; i < 200; ++i ) { EXPECT_EQ( expected[i], v[i] ); }
+    }
+    EXPECT_EQ( expected, split( long_line, ",;|" ) );
+    EXPECT_EQ( long_line.data() + long_line.size(), find_separator( long_line.data(), long_line.data() + long_line.size(), "#" ) );
+    EXPECT_EQ( long_line.data() + long_line.size(), find_separator( long_line.data(), long_line.data() + long_line.size(), "#$" ) );
+}
+
+TEST( string, join )
+{
+    std::vector< std::string > v;
+    EXPECT_EQ( "", join( v, ',' ) );
+    v.push_back( "a" );
+    EXPECT_EQ( "a", join( v, ',' ) );
+    v.push_back( "" );
+    v.push_back( "bc" );
+    EXPECT_EQ( "a,,bc", join( v, ',' ) );
+    std::string s = "x=";
+    EXPECT_EQ( "x=a;;bc", join( v, ';', s ) );
+    EXPECT_EQ( "x=a;;bc", s );
+    std::vector< span > spans;
+    split( "1,22,333", ',', spans );
+    s.clear();
+    EXPECT_EQ( "1 22 333", join( spans, ' ', s ) );
+    const char* c[] = { "p", "q" };
+    EXPECT_EQ( "p/q", join( c, 2, '/' ) );
+    std::vector< double > d( 2, 0.5 );
+    d[1] = 1.0 / 3;
+    EXPECT_EQ( "0.5,0.333333", join( d, ',' ) );
+    s = "d:";
+    EXPECT_EQ( "d:0.5,0.333333", join( d, ',', s ) );
+}
+
+static std::vector< std::string > split_by_character( const std::string& s, const char* separators ) // split implementation before vectorisation
+{
+    std::vector< std::string > v;
+    v.push_back( std::string() );
+    for( const char* p = s.data(); p < s.data() + s.size(); ++p )
+    {
+        bool is_separator = false;
+        for( const char* q = separators; *q && !is_separator; ++q ) { is_separator = *p == *q; }
+        if( is_separator ) { v.push_back( std::string() ); } else { v.back() += *p; }
+    }
+    return v;
+}
+
+static std::string join_with_ostringstream( const std::vector< std::string >& v, char delimiter ) // join implementation before buffer-appending join
+{
+    std::ostringstream oss;
+    oss << v[0];
+    for( std::size_t i = 1; i < v.size(); ++i ) { oss << delimiter << v[i]; }
+    return oss.str();
+}
+
+TEST( string, DISABLED_split_join_benchmark ) // run with --gtest_also_run_disabled_tests
+{
+    std::vector< std::string > lines;
+    ::srand( 1 );
+    for( unsigned int i = 0; i < 10000; ++i )
+    {
+        std::ostringstream oss;
+        oss.precision( 16 );
+        for( unsigned int k = 0; k < 12; ++k ) { oss << ( k ? "," : "" ) << double( ::rand() ) / ( 1 + ::rand() % 1000 ); }
+        lines.push_back( oss.str() );
+    }
+    const unsigned int repeat = 10;
+    std::size_t count[5] = { 0, 0, 0, 0, 0 };
+    std::vector< span > spans;
+    std::string buffer;
+    boost::posix_time::ptime t[6];
+    t[0] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[0] += split_by_character( lines[i], "," ).size(); } }
+    t[1] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[1] += split( lines[i], ',' ).size(); } }
+    t[2] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[2] += split( lines[i], ',', spans ); } }
+    t[3] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[3] += split( lines[i], ",;", spans ); } }
+    t[4] = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "split per line: by character: " << ( t[1] - t[0] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns"
+              << "; split: " << ( t[2] - t[1] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns"
+              << "; split into spans: " << ( t[3] - t[2] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns"
+              << "; split into spans by two separators: " << ( t[4] - t[3] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns" << std::endl;
+    EXPECT_EQ( count[0], count[1] );
+    EXPECT_EQ( count[0], count[2] );
+    EXPECT_EQ( count[0], count[3] );
+    std::vector< std::vector< std::string > > tokens( lines.size() );
+    for( std::size_t i = 0; i < lines.size(); ++i ) { tokens[i] = split( lines[i], ',' ); }
+    count[0] = count[1] = count[2] = 0;
+    t[0] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[0] += join_with_ostringstream( tokens[i], ',' ).size(); } }
+    t[1] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { count[1] += join( tokens[i], ',' ).size(); } }
+    t[2] = boost::posix_time::microsec_clock::universal_time();
+    for( unsigned int k = 0; k < repeat; ++k ) { for( std::size_t i = 0; i < lines.size(); ++i ) { buffer.clear(); count[2] += join( tokens[i], ',', buffer ).size(); } }
+    t[3] = boost::posix_time::microsec_clock::universal_time();
+    std::cerr << "join per line: std::ostringstream: " << ( t[1] - t[0] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns"
+              << "; join: " << ( t[2] - t[1] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns"
+              << "; join into buffer: " << ( t[3] - t[2] ).total_microseconds() * 1000 / ( repeat * lines.size() ) << "ns" << std::endl;
+    EXPECT_EQ( count[0], count[1] );
+    EXPECT_EQ( count[0], count[2] );
+}
+
 TEST( string, strip )
 {
     EXPECT_EQ( strip( "", ";" ), "" );